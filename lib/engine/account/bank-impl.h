@@ -124,7 +124,20 @@ namespace Ekiga
      */
     void remove_account (boost::shared_ptr<AccountType> account);
 
+    /** Start adding and removing accounts in bulk: until the matching
+     * commit_accounts_update, they are notified all at once by
+     * accounts_changed.
+     */
+    void begin_accounts_update ();
+
+    void commit_accounts_update ();
+
     DynamicObjectStore<AccountType> accounts;
+
+  private:
+
+    void on_accounts_changed (const typename DynamicObjectStore<AccountType>::objects_list& added,
+			      const typename DynamicObjectStore<AccountType>::objects_list& removed);
   };
 
 /**
@@ -143,6 +156,7 @@ Ekiga::BankImpl<AccountType>::BankImpl ()
   accounts.object_added.connect (boost::bind (boost::ref (account_added), _1));
   accounts.object_removed.connect (boost::bind (boost::ref (account_removed), _1));
   accounts.object_updated.connect (boost::bind (boost::ref (account_updated), _1));
+  accounts.objects_changed.connect (boost::bind (&Ekiga::BankImpl<AccountType>::on_accounts_changed, this, _1, _2));
 }
 
 
@@ -208,4 +222,32 @@ Ekiga::BankImpl<AccountType>::remove_account (boost::shared_ptr<AccountType> acc
   accounts.remove_object (account);
 }
 
+
+template<typename AccountType>
+void
+Ekiga::BankImpl<AccountType>::begin_accounts_update ()
+{
+  accounts.begin_bulk ();
+}
+
+
+template<typename AccountType>
+void
+Ekiga::BankImpl<AccountType>::commit_accounts_update ()
+{
+  accounts.commit_bulk ();
+}
+
+
+template<typename AccountType>
+void
+Ekiga::BankImpl<AccountType>::on_accounts_changed (const typename DynamicObjectStore<AccountType>::objects_list& added,
+						   const typename DynamicObjectStore<AccountType>::objects_list& removed)
+{
+  std::list<AccountPtr> added_accounts (added.begin (), added.end ());
+  std::list<AccountPtr> removed_accounts (removed.begin (), removed.end ());
+
+  accounts_changed (added_accounts, removed_accounts);
+}
+
 #endif
@@ -77,6 +77,14 @@ namespace Ekiga
     /** This signal is emitted when a account has been updated.
      */
     boost::signals2::signal<void(AccountPtr)> account_updated;
+
+    /** This signal is emitted when accounts have been added and removed
+     * in bulk, instead of account_added and account_removed for each of
+     * them: what listens to those must listen to this one too.
+     * @param The added accounts, in the order they were added
+     * @param The removed accounts
+     */
+    boost::signals2::signal<void(const std::list<AccountPtr>&, const std::list<AccountPtr>&)> accounts_changed;
   };
 
   /**
@@ -34,40 +34,128 @@
  *
  */
 
+#include <glib.h>
+
 #include "actor.h"
 #include "runtime.h"
 
 using namespace Ekiga;
 
 
+Actor::ActionsUpdate::ActionsUpdate (Actor & _actor): actor (_actor)
+{
+  actor.begin_actions_update ();
+}
+
+
+Actor::ActionsUpdate::~ActionsUpdate ()
+{
+  actor.commit_actions_update ();
+}
+
+
+Actor::Actor (): update_depth (0)
+{
+}
+
+
+Actor::~Actor ()
+{
+  for (actions_index_type::iterator it = actions_index.begin ();
+       it != actions_index.end ();
+       ++it) {
+    it->second.enabled_conn.disconnect ();
+    it->second.disabled_conn.disconnect ();
+  }
+}
+
+
+void
+Actor::begin_actions_update ()
+{
+  update_depth++;
+}
+
+
+void
+Actor::commit_actions_update ()
+{
+  g_return_if_fail (update_depth > 0);
+
+  update_depth--;
+  if (update_depth > 0 || pending_changes.empty ())
+    return;
+
+  /* One main loop action for the whole batch, whatever its size */
+  changes_type changes;
+  changes.swap (pending_changes);
+  Ekiga::Runtime::run_in_main (boost::bind (&Actor::notify_actions_changes, this, changes), 0, "actor-actions");
+}
+
+
+void
+Actor::notify_actions_changes (const changes_type & changes)
+{
+  for (changes_type::const_iterator it = changes.begin ();
+       it != changes.end ();
+       ++it) {
+    if (it->second)
+      action_added (it->first);
+    else
+      action_removed (it->first);
+  }
+
+  actions_changed ();
+}
+
+
 void
 Actor::add_action (ActionPtr action)
 {
-  remove_action (action->get_name ()); // Remove any other action with the same name.
+  const std::string name = action->get_name ();
+
+  begin_actions_update ();
 
-  actions.push_back (action);
+  actions_index_type::iterator entry = actions_index.find (name);
+  if (entry != actions_index.end ())
+    erase_action (entry); // Remove any other action with the same name.
 
-  conns.add (action->enabled.connect (boost::bind (boost::ref (action_enabled), action->get_name ())));
-  conns.add (action->disabled.connect (boost::bind (boost::ref (action_disabled), action->get_name ())));
+  ActionEntry& added = actions_index[name];
+  added.iter = actions.insert (actions.end (), action);
+  added.enabled_conn = action->enabled.connect (boost::bind (boost::ref (action_enabled), name));
+  added.disabled_conn = action->disabled.connect (boost::bind (boost::ref (action_disabled), name));
+  pending_changes.push_back (std::make_pair (name, true));
 
-  Ekiga::Runtime::run_in_main (boost::bind (boost::ref(action_added), action->get_name ()));
+  commit_actions_update ();
 }
 
 
 bool
 Actor::remove_action (const std::string & name)
 {
-  ActionPtr a = get_action (name);
-  if (!a)
+  actions_index_type::iterator entry = actions_index.find (name);
+  if (entry == actions_index.end ())
     return false;
 
-  Ekiga::Runtime::run_in_main (boost::bind (boost::ref(action_removed), name));
-  actions.remove (a);
+  begin_actions_update ();
+  erase_action (entry);
+  commit_actions_update ();
 
   return true;
 }
 
 
+void
+Actor::erase_action (actions_index_type::iterator entry)
+{
+  entry->second.enabled_conn.disconnect ();
+  entry->second.disabled_conn.disconnect ();
+  actions.erase (entry->second.iter);
+  pending_changes.push_back (std::make_pair (entry->first, false));
+  actions_index.erase (entry);
+}
+
+
 bool
 Actor::enable_action (const std::string & name)
 {
@@ -97,23 +185,21 @@ Actor::disable_action (const std::string & name)
 ActionPtr
 Actor::get_action (const std::string & name)
 {
-  for (iterator it = begin (); it != end () ; ++it) {
-    if ((*it)->get_name () == name) {
-      return (*it);
-    }
-  }
+  actions_index_type::const_iterator entry = actions_index.find (name);
+  if (entry == actions_index.end ())
+    return ActionPtr ();
 
-  return ActionPtr ();
+  return *entry->second.iter;
 }
 
 
 void
 Actor::remove_actions ()
 {
-  for (iterator it = begin (); it != end () ; ++it) {
-    action_removed ((*it)->get_name ());
-  }
-  actions.clear ();
+  begin_actions_update ();
+  while (!actions.empty ())
+    erase_action (actions_index.find (actions.front ()->get_name ()));
+  commit_actions_update ();
 }
 
 
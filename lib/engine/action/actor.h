@@ -44,6 +44,9 @@
 #include "form-request.h"
 
 #include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
 
 namespace Ekiga {
 
@@ -58,6 +61,11 @@ namespace Ekiga {
    * An Actor can register actions through the add_action method.
    * It can remove them using the remove_action and remove_actions methods.
    *
+   * Actions are indexed by name, and changes are notified from the main
+   * loop. Changes made between begin_actions_update and
+   * commit_actions_update (or during the life of an ActionsUpdate) are
+   * notified together, followed by a single actions_changed, so that
+   * menus are only rebuilt once.
    */
   class Actor
   {
@@ -67,6 +75,10 @@ namespace Ekiga {
     typedef std::list < ActionPtr >::const_iterator const_iterator;
     typedef std::list < ActionPtr >::iterator iterator;
 
+    Actor ();
+
+    virtual ~Actor ();
+
     /**
      * Those signals are emitted when an Action is enabled/disabled
      * in the ActionMap.
@@ -83,6 +95,14 @@ namespace Ekiga {
     boost::signals2::signal<void(const std::string &)> action_removed;
 
 
+    /**
+     * This signal is emitted once after a series of Actions have been
+     * added/removed, after the corresponding action_added and
+     * action_removed signals.
+     */
+    boost::signals2::signal<void(void)> actions_changed;
+
+
     /** Returns an iterator to the first Action of the collection
      */
     iterator begin ();
@@ -104,6 +124,37 @@ namespace Ekiga {
     ChainOfResponsibility<FormRequestPtr> questions;
 
   protected:
+    /** Groups the additions and removals of Actions done during its
+     * lifetime into a single notification.
+     */
+    class ActionsUpdate
+    {
+    public:
+      ActionsUpdate (Actor & _actor);
+      ~ActionsUpdate ();
+
+    private:
+      ActionsUpdate (const ActionsUpdate &);
+      ActionsUpdate & operator= (const ActionsUpdate &);
+
+      Actor & actor;
+    };
+
+
+    /** Start grouping the additions and removals of Actions.
+     *
+     * Calls can be nested, the notification is only sent by the
+     * outermost commit_actions_update.
+     */
+    void begin_actions_update ();
+
+
+    /** Notify the additions and removals of Actions done since the
+     * matching begin_actions_update.
+     */
+    void commit_actions_update ();
+
+
     /** Add an action to the given Actor.
      *
      * Actions that are not "added" using this method will not be usable
@@ -155,12 +206,32 @@ namespace Ekiga {
 
   private:
 
+    struct ActionEntry
+    {
+      iterator iter;
+      boost::signals2::connection enabled_conn;
+      boost::signals2::connection disabled_conn;
+    };
+    typedef boost::unordered_map<std::string, ActionEntry> actions_index_type;
+
+    /* An Action name, and whether it was added (true) or removed (false) */
+    typedef std::vector< std::pair<std::string, bool> > changes_type;
+
+    void erase_action (actions_index_type::iterator entry);
+
+    void notify_actions_changes (const changes_type & changes);
+
     /**
      * This is the Actor ActionStore.
-     * It contains all actions supported by the current Actor.
+     * It contains all actions supported by the current Actor, in the order
+     * they were added, and an index of them by name.
      */
-    Ekiga::scoped_connections conns;
-    std::list< ActionPtr > actions; // FIXME: Use a RefLister here.
+    std::list< ActionPtr > actions;
+    actions_index_type actions_index;
+
+    /* The changes not notified yet, and the begin_actions_update depth */
+    changes_type pending_changes;
+    unsigned update_depth;
   };
   typedef boost::shared_ptr< Actor > ActorPtr;
 
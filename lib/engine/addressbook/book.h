@@ -37,6 +37,7 @@
 
 #include "contact.h"
 #include "actor.h"
+#include "light-signal.h"
 
 namespace Ekiga {
 
@@ -94,17 +95,17 @@ namespace Ekiga {
 
     /** This signal is emitted when a Contact has been added to the Book.
      */
-    boost::signals2::signal<void(ContactPtr)> contact_added;
+    light_signal<void(ContactPtr)> contact_added;
 
 
     /** This signal is emitted when a Contact has been removed from the Book.
      */
-    boost::signals2::signal<void(ContactPtr)> contact_removed;
+    light_signal<void(ContactPtr)> contact_removed;
 
 
     /** This signal is emitted when a Contact has been updated in the Book.
      */
-    boost::signals2::signal<void(ContactPtr)> contact_updated;
+    light_signal<void(ContactPtr)> contact_updated;
   };
 
 };
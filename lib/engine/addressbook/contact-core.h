@@ -105,7 +105,7 @@ namespace Ekiga
     /** This signal is emitted when a Ekiga::Source has been
      * added to the ContactCore Service.
      */
-    boost::signals2::signal<void(SourcePtr)> source_added;
+    light_signal<void(SourcePtr)> source_added;
 
 
     /** This chain allows the core to present forms to the user
@@ -38,6 +38,7 @@
 
 #include "book.h"
 #include "actor.h"
+#include "light-signal.h"
 
 namespace Ekiga {
 
@@ -65,17 +66,17 @@ namespace Ekiga {
 
     /** This signal is emitted when a Book has been added to the Source.
      */
-    boost::signals2::signal<void(BookPtr)> book_added;
+    light_signal<void(BookPtr)> book_added;
 
 
     /** This signal is emitted when a Book has been updated in the Source.
      */
-    boost::signals2::signal<void(BookPtr)> book_updated;
+    light_signal<void(BookPtr)> book_updated;
 
 
     /** This signal is emitted when a Book has been removed in the Source.
      */
-    boost::signals2::signal<void(BookPtr)> book_removed;
+    light_signal<void(BookPtr)> book_removed;
   };
 };
 
@@ -0,0 +1,119 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         audioinput-capture.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Implementation of a thread draining the current
+ *                          audio input device into a lock-free ring.
+ *
+ */
+
+#include "audioinput-capture.h"
+#include "audioinput-core.h"
+
+using namespace Ekiga;
+
+AudioCaptureThread::AudioCaptureThread (AudioInputCore& _audio_input_core)
+: AudioStreamThread ("AudioCaptureThread"),
+  read_timeout (0),
+  audio_input_core (_audio_input_core)
+{
+}
+
+AudioCaptureThread::~AudioCaptureThread ()
+{
+  quit ();
+}
+
+void AudioCaptureThread::start_capture (unsigned _chunk_size,
+                                        unsigned ring_size,
+                                        unsigned timeout)
+{
+  PWaitAndSignal m(read_mutex);
+
+  stop_capture ();
+
+  PTRACE(4, "AudioCaptureThread\tStarting capture with " << _chunk_size << "/" << ring_size << " bytes");
+
+  read_timeout = timeout;
+  start (_chunk_size, ring_size);
+}
+
+void AudioCaptureThread::stop_capture ()
+{
+  if (!is_capturing ())
+    return;
+
+  stop ();
+
+  PTRACE(4, "AudioCaptureThread\tStopped capture, " << get_overruns () << " overruns, "
+         << get_underruns () << " underruns");
+}
+
+void AudioCaptureThread::read (char* data,
+                               unsigned size,
+                               unsigned & bytes_read)
+{
+  PWaitAndSignal m(read_mutex);
+
+  bytes_read = ring.read (data, size);
+
+  while (bytes_read < size) {
+
+    if (!data_available.Wait (read_timeout)) {
+
+      /* The producer is stalled (device switch, fallback...) :
+       * keep the stream going with silence */
+      memset (data + bytes_read, 0, size - bytes_read);
+      bytes_read = size;
+      g_atomic_int_inc (&underruns);
+      break;
+    }
+    bytes_read += ring.read (data + bytes_read, size - bytes_read);
+  }
+}
+
+void AudioCaptureThread::process_chunk ()
+{
+  unsigned bytes_read = 0;
+
+  audio_input_core.capture_frame_data (chunk, chunk_size, bytes_read);
+
+  if (bytes_read == 0) {
+
+    Current()->Sleep (10);
+    return;
+  }
+
+  /* The consumer is late : only the read side may move the read
+   * position, so whatever does not fit is dropped */
+  if (ring.write (chunk, bytes_read) < bytes_read)
+    g_atomic_int_inc (&overruns);
+
+  data_available.Signal ();
+}
@@ -0,0 +1,98 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         audioinput-capture.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Declaration of a thread draining the current
+ *                          audio input device into a lock-free ring.
+ *
+ */
+
+#ifndef __AUDIOINPUT_CAPTURE_H__
+#define __AUDIOINPUT_CAPTURE_H__
+
+#include "audio-stream-thread.h"
+
+namespace Ekiga
+{
+  class AudioInputCore;
+
+  /** Capture thread of the AudioInputCore
+   * While capturing, the thread reads chunks from the AudioInputCore
+   * (and thus from the current AudioInputManager) and pushes them into a
+   * single-producer/single-consumer ring. The streaming thread then only
+   * copies out of that ring, so that it never waits on the core mutex :
+   * device switches and fallbacks only ever stall the capture thread.
+   */
+  class AudioCaptureThread : public AudioStreamThread
+  {
+    PCLASSINFO(AudioCaptureThread, AudioStreamThread);
+
+  public:
+    AudioCaptureThread (Ekiga::AudioInputCore& _audio_input_core);
+    ~AudioCaptureThread ();
+
+    /** Start draining the device
+     * Must not be called with the core mutex held. Waits for a read ()
+     * in progress to return before the ring is resized.
+     * @param chunk_size the number of bytes read from the device at once.
+     * @param ring_size the capacity of the ring in bytes.
+     * @param timeout how long read () waits for data before returning silence (ms).
+     */
+    void start_capture (unsigned chunk_size, unsigned ring_size, unsigned timeout);
+
+    /** Stop draining the device, and wait for the thread to be idle
+     * Must not be called with the core mutex held.
+     */
+    void stop_capture ();
+
+    bool is_capturing () const
+      { return is_running (); }
+
+    /** Copy one buffer out of the ring
+     * Blocks until enough data is available. If the producer stalls for
+     * longer than the timeout, the missing bytes are filled with silence.
+     * @param data a pointer to the buffer that is to be filled.
+     * @param size the number of bytes to be read.
+     * @param bytes_read number of bytes actually read.
+     */
+    void read (char* data, unsigned size, unsigned & bytes_read);
+
+  protected:
+    void process_chunk ();
+
+    unsigned read_timeout;
+
+    /* held by read () : keeps the streaming thread out of the ring while
+     * start_capture () resizes it */
+    PMutex read_mutex;
+
+    Ekiga::AudioInputCore& audio_input_core;
+  };
+};
+#endif
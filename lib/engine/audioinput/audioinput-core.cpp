@@ -38,13 +38,16 @@
 #include <iostream>
 #endif
 
+#include <algorithm>
 #include <math.h>
+#include <string.h>
 
 #include <glib/gi18n.h>
 
 #include "config.h"
 
 #include "ekiga-settings.h"
+#include "audio-dsp.h"
 
 #include "audioinput-core.h"
 
@@ -89,14 +92,24 @@ AudioInputCore::AudioInputCore (Ekiga::ServiceCore& _core):
   average_level = 0;
   calculate_average = false;
   yield = false;
+  device_unchecked = false;
+  converted_offset = 0;
+
+  capture_thread = new AudioCaptureThread (*this);
 
   notification_core = core.get<Ekiga::NotificationCore> ("notification-core");
   audio_device_settings = g_settings_new (AUDIO_DEVICES_SCHEMA);
   audio_device_settings_signal = 0;
+  threaded_capture = g_settings_get_boolean (audio_device_settings, "enable-capture-thread");
+  native_samplerate = g_settings_get_int (audio_device_settings, "input-sample-rate");
+  native_channels = g_settings_get_int (audio_device_settings, "input-channels");
 }
 
 AudioInputCore::~AudioInputCore ()
 {
+  /* The capture thread needs the core mutex to stop */
+  delete capture_thread;
+
   PWaitAndSignal m(core_mutex);
 
   for (std::set<AudioInputManager*>::iterator iter = managers.begin ();
@@ -117,10 +130,32 @@ AudioInputCore::setup ()
 {
   PWaitAndSignal m(core_mutex);
   gchar* audio_device = NULL;
+  AudioInputDevice device;
+  bool detecting = false;
 
   audio_device = g_settings_get_string (audio_device_settings, "input-device");
+  threaded_capture = g_settings_get_boolean (audio_device_settings, "enable-capture-thread");
+  native_samplerate = g_settings_get_int (audio_device_settings, "input-sample-rate");
+  native_channels = g_settings_get_int (audio_device_settings, "input-channels");
 
-  set_device (audio_device);
+  for (std::set<AudioInputManager*>::const_iterator iter = managers.begin ();
+       iter != managers.end ();
+       ++iter)
+    detecting = detecting || (*iter)->detecting_devices ();
+
+  if (detecting && strchr (audio_device, '(') && strchr (audio_device, '/'))
+    device.SetFromString (audio_device);
+
+  if ( !device.type.empty () && !device.name.empty ()) {
+
+    /* Don't wait for the devices to be known : take the configured one
+     * right away, and check it later */
+    PTRACE(4, "AudioInputCore\tDevices still being detected, using " << device << " unchecked");
+    device_unchecked = true;
+    internal_set_device (device);
+  }
+  else
+    set_device (audio_device);
 
   if (audio_device_settings_signal == 0) {
 
@@ -141,6 +176,7 @@ AudioInputCore::add_manager (AudioInputManager& manager)
   manager.device_error.connect   (boost::bind (boost::ref(device_error), boost::ref(manager), _1, _2));
   manager.device_opened.connect  (boost::bind (boost::ref(device_opened), boost::ref(manager), _1, _2));
   manager.device_closed.connect  (boost::bind (boost::ref(device_closed), boost::ref(manager), _1));
+  manager.devices_detected.connect (boost::bind (&AudioInputCore::on_devices_detected, this));
 }
 
 
@@ -194,6 +230,17 @@ AudioInputCore::get_devices (std::vector<AudioInputDevice>& devices)
 
 }
 
+void
+AudioInputCore::refresh_devices ()
+{
+  PWaitAndSignal m(core_mutex);
+
+  for (std::set<AudioInputManager*>::const_iterator iter = managers.begin ();
+       iter != managers.end ();
+       ++iter)
+    (*iter)->refresh_devices ();
+}
+
 void
 AudioInputCore::set_device (const std::string& device_string)
 {
@@ -335,7 +382,7 @@ AudioInputCore::start_preview (unsigned channels,
   preview_config.num_buffers = 5;
 
   if (current_manager)
-    current_manager->set_buffer_size(preview_config.buffer_size, preview_config.num_buffers);
+    current_manager->set_buffer_size (capture_converter.get_input_size (preview_config.buffer_size), preview_config.num_buffers);
 
   average_level = 0;
 }
@@ -363,15 +410,21 @@ AudioInputCore::set_stream_buffer_size (unsigned buffer_size,
 					unsigned num_buffers)
 {
   yield = true;
-  PWaitAndSignal m(core_mutex);
+  core_mutex.Wait ();
 
   PTRACE(4, "AudioInputCore\tSetting stream buffer size " << num_buffers << "/" << buffer_size);
 
   if (current_manager)
-    current_manager->set_buffer_size(buffer_size, num_buffers);
+    current_manager->set_buffer_size(capture_converter.get_input_size (buffer_size), num_buffers);
 
   stream_config.buffer_size = buffer_size;
   stream_config.num_buffers = num_buffers;
+  core_mutex.Signal ();
+
+  /* OPAL tells its buffer size after start_stream : capture in chunks of
+   * that size from now on */
+  if (capture_thread->is_capturing ())
+    internal_start_capture ();
 }
 
 void
@@ -380,7 +433,7 @@ AudioInputCore::start_stream (unsigned channels,
 			      unsigned bits_per_sample)
 {
   yield = true;
-  PWaitAndSignal m(core_mutex);
+  core_mutex.Wait ();
 
   PTRACE(4, "AudioInputCore\tStarting stream " << channels << "x" << samplerate << "/" << bits_per_sample);
 
@@ -397,12 +450,20 @@ AudioInputCore::start_stream (unsigned channels,
   stream_config.bits_per_sample = bits_per_sample;
 
   average_level = 0;
+  core_mutex.Signal ();
+
+  if (threaded_capture)
+    internal_start_capture ();
 }
 
 void
 AudioInputCore::stop_stream ()
 {
   yield = true;
+
+  /* The capture thread needs the core mutex to stop */
+  capture_thread->stop_capture ();
+
   PWaitAndSignal m(core_mutex);
 
   PTRACE(4, "AudioInputCore\tStopping Stream");
@@ -422,6 +483,20 @@ void
 AudioInputCore::get_frame_data (char* data,
 				unsigned size,
 				unsigned& bytes_read)
+{
+  if (capture_thread->is_capturing ())
+    capture_thread->read (data, size, bytes_read);
+  else
+    capture_frame_data (data, size, bytes_read);
+
+  if (calculate_average)
+    calculate_average_level((const short*) data, bytes_read);
+}
+
+void
+AudioInputCore::capture_frame_data (char* data,
+				    unsigned size,
+				    unsigned& bytes_read)
 {
   if (yield) {
     yield = false;
@@ -431,14 +506,10 @@ AudioInputCore::get_frame_data (char* data,
 
   if (current_manager) {
 
-    if (!current_manager->get_frame_data(data, size, bytes_read)) {
-
-      internal_close();
-      internal_set_fallback();
-      internal_open(stream_config.channels, stream_config.samplerate, stream_config.bits_per_sample);
-      if (current_manager)
-        current_manager->get_frame_data(data, size, bytes_read); // the default device must always return true
-    }
+    if (capture_converter.is_identity ())
+      internal_read (data, size, bytes_read);
+    else
+      internal_read_converted (data, size, bytes_read);
 
     PWaitAndSignal m_vol(volume_mutex);
     if (desired_volume != current_volume) {
@@ -447,9 +518,71 @@ AudioInputCore::get_frame_data (char* data,
       current_volume = desired_volume;
     }
   }
+}
 
-  if (calculate_average)
-    calculate_average_level((const short*) data, bytes_read);
+void
+AudioInputCore::internal_read (char* data,
+			       unsigned size,
+			       unsigned& bytes_read)
+{
+  if (!current_manager->get_frame_data(data, size, bytes_read)) {
+
+    internal_close();
+    internal_set_fallback();
+    internal_open(stream_config.channels, stream_config.samplerate, stream_config.bits_per_sample);
+    if (current_manager)
+      current_manager->get_frame_data(data, size, bytes_read); // the default device must always return true
+  }
+}
+
+void
+AudioInputCore::internal_read_converted (char* data,
+					 unsigned size,
+					 unsigned& bytes_read)
+{
+  unsigned device_bytes_read = 0;
+
+  while (converted_buffer.size () - converted_offset < size && current_manager) {
+
+    device_buffer.resize (capture_converter.get_input_size (size - (converted_buffer.size () - converted_offset)));
+    device_bytes_read = 0;
+    internal_read (&device_buffer[0], device_buffer.size (), device_bytes_read);
+    if (device_bytes_read == 0)
+      break;
+
+    capture_converter.convert (&device_buffer[0], device_bytes_read, converted_buffer);
+  }
+
+  bytes_read = std::min (size, (unsigned) (converted_buffer.size () - converted_offset));
+  if (bytes_read > 0) {
+
+    memcpy (data, &converted_buffer[converted_offset], bytes_read);
+    converted_offset += bytes_read;
+  }
+
+  /* what was read is only dropped from the front once it is at least half
+   * of the buffer, so what remains is seldom moved */
+  if (converted_offset == converted_buffer.size ()) {
+
+    converted_buffer.clear ();
+    converted_offset = 0;
+  }
+  else if (converted_offset >= converted_buffer.size () / 2) {
+
+    converted_buffer.erase (converted_buffer.begin (), converted_buffer.begin () + converted_offset);
+    converted_offset = 0;
+  }
+}
+
+bool
+AudioInputCore::get_device_latency (unsigned & latency)
+{
+  PWaitAndSignal m(core_mutex);
+
+  if (!current_manager)
+    return false;
+
+  return current_manager->get_latency (latency);
 }
 
 void
@@ -466,6 +599,38 @@ AudioInputCore::on_set_device (const AudioInputDevice& device)
   g_settings_set_string (audio_device_settings, "input-device", device.GetString ().c_str ());
 }
 
+void
+AudioInputCore::on_devices_detected ()
+{
+  Ekiga::Runtime::run_in_main (boost::bind (&AudioInputCore::check_device, this));
+}
+
+void
+AudioInputCore::check_device ()
+{
+  PWaitAndSignal m(core_mutex);
+  std::vector<AudioInputDevice> devices;
+  gchar* audio_device = NULL;
+
+  if (!device_unchecked)
+    return;
+
+  device_unchecked = false;
+
+  get_devices (devices);
+  if (std::find (devices.begin (), devices.end (), current_device) != devices.end ()) {
+
+    PTRACE(4, "AudioInputCore\tChecked device " << current_device);
+    return;
+  }
+
+  /* it isn't there after all : pick another one the usual way */
+  PTRACE(1, "AudioInputCore\tDevice " << current_device << " wasn't detected");
+  audio_device = g_settings_get_string (audio_device_settings, "input-device");
+  set_device (audio_device);
+  g_free (audio_device);
+}
+
 void
 AudioInputCore::internal_set_device(const AudioInputDevice& device)
 {
@@ -483,7 +648,7 @@ AudioInputCore::internal_set_device(const AudioInputDevice& device)
     if ((preview_config.buffer_size > 0) && (preview_config.num_buffers > 0 ) ) {
 
       if (current_manager)
-        current_manager->set_buffer_size (preview_config.buffer_size, preview_config.num_buffers);
+        current_manager->set_buffer_size (capture_converter.get_input_size (preview_config.buffer_size), preview_config.num_buffers);
     }
   }
 
@@ -494,7 +659,7 @@ AudioInputCore::internal_set_device(const AudioInputDevice& device)
     if ((stream_config.buffer_size > 0) && (stream_config.num_buffers > 0 ) ) {
 
       if (current_manager)
-        current_manager->set_buffer_size (stream_config.buffer_size, stream_config.num_buffers);
+        current_manager->set_buffer_size (capture_converter.get_input_size (stream_config.buffer_size), stream_config.num_buffers);
     }
   }
 }
@@ -540,14 +705,24 @@ AudioInputCore::internal_open (unsigned channels,
 			       unsigned samplerate,
 			       unsigned bits_per_sample)
 {
-  PTRACE(4, "AudioInputCore\tOpening device with " << channels << "-" << samplerate << "/" << bits_per_sample );
+  // Let the device run in its own format if we know it,
+  // and convert to what was asked ourselves
+  unsigned device_channels = (native_channels > 0) ? native_channels : channels;
+  unsigned device_samplerate = (native_samplerate > 0) ? native_samplerate : samplerate;
+
+  capture_converter.setup (device_channels, device_samplerate, bits_per_sample,
+                           channels, samplerate, bits_per_sample);
+  converted_buffer.clear ();
+  converted_offset = 0;
 
-  if (current_manager && !current_manager->open(channels, samplerate, bits_per_sample)) {
+  PTRACE(4, "AudioInputCore\tOpening device with " << device_channels << "-" << device_samplerate << "/" << bits_per_sample );
+
+  if (current_manager && !current_manager->open(device_channels, device_samplerate, bits_per_sample)) {
 
     internal_set_fallback();
 
     if (current_manager)
-      current_manager->open(channels, samplerate, bits_per_sample);
+      current_manager->open(device_channels, device_samplerate, bits_per_sample);
   }
 }
 
@@ -560,21 +735,35 @@ AudioInputCore::internal_close ()
 }
 
 void
-AudioInputCore::calculate_average_level (const short* buffer,
-					 unsigned size)
+AudioInputCore::internal_start_capture ()
 {
-  int sum = 0;
-  unsigned csize = 0;
+  unsigned bytes_per_ms = 0;
+  unsigned chunk_size = 0;
 
-  while (csize < (size>>1) ) {
+  core_mutex.Wait ();
+  bytes_per_ms = stream_config.samplerate * stream_config.channels * stream_config.bits_per_sample / 8 / 1000;
+  chunk_size = stream_config.buffer_size;
+  core_mutex.Signal ();
 
-    if (*buffer < 0)
-      sum -= *buffer++;
-    else
-      sum += *buffer++;
+  if (bytes_per_ms == 0)
+    return;
 
-    csize++;
-  }
+  // OPAL did not tell us how it reads, default to 20ms chunks
+  if (chunk_size == 0)
+    chunk_size = 20 * bytes_per_ms;
+
+  // The ring holds a few chunks, and read() waits for two chunks
+  // before it starts feeding silence
+  capture_thread->start_capture (chunk_size, 8 * chunk_size,
+                                 std::max (2 * chunk_size / bytes_per_ms, (unsigned) 20));
+}
+
+void
+AudioInputCore::calculate_average_level (const short* buffer,
+					 unsigned size)
+{
+  /* size is in bytes, and so is the scale of that historical formula */
+  guint64 sum = AudioDSP::abs_sum (buffer, size >> 1);
 
   average_level = log10 (9.0*sum/size/32767+1)*1.0;
 }
@@ -40,6 +40,8 @@
 #include "runtime.h"
 
 #include "audioinput-manager.h"
+#include "audioinput-capture.h"
+#include "audio-converter.h"
 #include "notification-core.h"
 #include "hal-core.h"
 
@@ -95,6 +97,16 @@ namespace Ekiga
    * back due to a removed device, and the respective device is re-added to the system,
    * it will be automatically activated.
    *
+   * In streaming mode, and unless disabled in the settings, the devices are
+   * drained by a dedicated capture thread (see AudioCaptureThread) into a
+   * lock-free ring. get_frame_data() then only copies from that ring, so that
+   * the audio streaming thread is never blocked by UI calls or device switches.
+   *
+   * If the native format of the device is configured, the device is opened
+   * in that format whatever the stream asks for, and the core converts
+   * (resamples, downmixes) the frames itself with an AudioConverter, instead
+   * of leaving that to the audio server.
+   *
    * The audio input core can also be used in a preview mode, where it starts a separate
    * thread (represented by the AudioPreviewManager), which grabs frames from the audio
    * input core and passes them to the audio output core. This can be used for audio device
@@ -161,6 +173,11 @@ namespace Ekiga
       void get_devices(std::vector <std::string> & devices);
       void get_devices(std::vector <AudioInputDevice> & devices);
 
+      /** Make the managers detect their devices again
+       * To be called when a device was added or removed.
+       */
+      void refresh_devices ();
+
       /** Set a specific device
        * This functions sets the current audio input device.
        * It can also be used while in a stream or in preview mode,
@@ -244,6 +261,15 @@ namespace Ekiga
        */
       void get_frame_data (char *data, unsigned size, unsigned & bytes_read);
 
+      /** Get one audio buffer directly from the current manager.
+       * This is what get_frame_data() does when no capture thread is used,
+       * and what the capture thread does to fill its ring.
+       * @param data a pointer to the buffer that is to be filled. The memory has to be allocated already.
+       * @param size the number of bytes to be read
+       * @param bytes_read number of bytes actually read.
+       */
+      void capture_frame_data (char *data, unsigned size, unsigned & bytes_read);
+
       /** Set the volume of the next opportunity
        * Sets the volume to the specified value the next time
        * get_frame_data() is called.
@@ -263,6 +289,12 @@ namespace Ekiga
        */
       float get_average_level () { return average_level; }
 
+      /** Get the latency of the current device, as reported by its manager
+       * @param latency the latency in ms.
+       * @return false if the device is not opened or its latency is not known.
+       */
+      bool get_device_latency (unsigned & latency);
+
 
       /*** VidInput Related Signals ***/
 
@@ -288,6 +320,8 @@ namespace Ekiga
 
   private:
       void on_set_device (const AudioInputDevice & device);
+      void on_devices_detected ();
+      void check_device ();
 
       void internal_set_device(const AudioInputDevice & device);
       void internal_set_manager (const AudioInputDevice & device);
@@ -295,9 +329,13 @@ namespace Ekiga
 
       void internal_open (unsigned channels, unsigned samplerate, unsigned bits_per_sample);
       void internal_close();
+      void internal_read (char *data, unsigned size, unsigned & bytes_read);
+      void internal_read_converted (char *data, unsigned size, unsigned & bytes_read);
 
       void calculate_average_level (const short *buffer, unsigned size);
 
+      void internal_start_capture ();
+
   private:
 
       typedef struct DeviceConfig {
@@ -328,6 +366,20 @@ namespace Ekiga
       bool calculate_average;
       bool yield;
 
+      /* the configured device was picked before the managers knew their
+       * devices : check it once they do */
+      bool device_unchecked;
+
+      AudioCaptureThread* capture_thread;
+      bool threaded_capture;
+
+      unsigned native_channels;
+      unsigned native_samplerate;
+      AudioConverter capture_converter;
+      std::vector<char> device_buffer;
+      std::vector<char> converted_buffer;
+      unsigned converted_offset; // what was already read from converted_buffer
+
       Ekiga::ServiceCore & core;
       boost::shared_ptr<Ekiga::NotificationCore> notification_core;
 
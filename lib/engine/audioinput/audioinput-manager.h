@@ -79,6 +79,18 @@ namespace Ekiga
        */
       virtual void get_devices (std::vector <AudioInputDevice> & devices) = 0;
 
+      /** Forget the devices detected so far, if they are cached.
+       * Called when a device was added or removed, before get_devices().
+       */
+      virtual void refresh_devices () {};
+
+      /** Returns true while the devices are detected in the background :
+       * get_devices() would wait until it is done, and set_device() accepts
+       * any device of the manager meanwhile. devices_detected is emitted
+       * when it is over.
+       */
+      virtual bool detecting_devices () { return false; }
+
       /** Set the current device.
        * Must be called before opening the device.
        * In case a different device of the same manager was opened before, it must be 
@@ -129,6 +141,13 @@ namespace Ekiga
        */
       virtual void set_volume (unsigned /*volume*/) {};
 
+      /** Get the latency of the current device.
+       * Requires the device to be opened.
+       * @param latency returns how long a sample takes from the device to get_frame_data() (ms).
+       * @return false if the manager does not know it.
+       */
+      virtual bool get_latency (unsigned & /*latency*/) { return false; };
+
       /** Returns true if a specific device is supported by the manager.
        * If the device specified by source and device_name is supported by the manager, true
        * is returned and an AudioOutputDevice structure filled with the respective details.
@@ -160,6 +179,11 @@ namespace Ekiga
        */
       boost::signals2::signal<void(AudioInputDevice, AudioInputErrorCodes)> device_error;
 
+      /** This signal is emitted, from any thread, when the devices were
+       * detected in the background.
+       */
+      boost::signals2::signal<void(void)> devices_detected;
+
 
   protected:  
       typedef struct ManagerState {
@@ -40,6 +40,7 @@
 
 #include <algorithm>
 #include <math.h>
+#include <string.h>
 
 #include <glib/gi18n.h>
 #include <boost/algorithm/string.hpp>
@@ -48,6 +49,7 @@
 #include "audiooutput-manager.h"
 
 #include "ekiga-settings.h"
+#include "audio-dsp.h"
 
 using namespace Ekiga;
 
@@ -91,6 +93,7 @@ AudioOutputCore::AudioOutputCore (Ekiga::ServiceCore& core)
   PWaitAndSignal m_vol(volume_mutex);
 
   audio_event_scheduler = new AudioEventScheduler (*this);
+  playout_thread = new AudioPlayoutThread (*this);
 
   current_primary_config.active = false;
   current_primary_config.channels = 0;
@@ -107,16 +110,22 @@ AudioOutputCore::AudioOutputCore (Ekiga::ServiceCore& core)
   average_level = 0;
   calculate_average = false;
   yield = false;
+  device_unchecked[primary] = false;
+  device_unchecked[secondary] = false;
 
   notification_core = core.get<Ekiga::NotificationCore> ("notification-core");
   sound_events_settings = g_settings_new (SOUND_EVENTS_SCHEMA);
   audio_device_settings = g_settings_new (AUDIO_DEVICES_SCHEMA);
   audio_device_settings_signals[primary] = 0;
   audio_device_settings_signals[secondary] = 0;
+  threaded_playout = g_settings_get_boolean (audio_device_settings, "enable-playout-thread");
 }
 
 AudioOutputCore::~AudioOutputCore ()
 {
+  /* The playout thread needs the core mutex to stop */
+  delete playout_thread;
+
   PWaitAndSignal m_pri(core_mutex[primary]);
   PWaitAndSignal m_sec(core_mutex[secondary]);
 
@@ -166,18 +175,38 @@ AudioOutputCore::setup_audio_device (AudioOutputPS device_idx)
   bool found = false;
   bool found_preferred1 = false;
   bool found_preferred2 = false;
+  bool detecting = false;
 
   gchar* audio_device = NULL;
 
  
-  if (device_idx == primary)
+  if (device_idx == primary) {
+
     audio_device = g_settings_get_string (audio_device_settings, "output-device");
+    threaded_playout = g_settings_get_boolean (audio_device_settings, "enable-playout-thread");
+  }
   else
     audio_device = g_settings_get_string (sound_events_settings, "output-device");
 
-  get_devices (devices);
+  for (std::set<AudioOutputManager*>::const_iterator iter = managers.begin ();
+       iter != managers.end ();
+       ++iter)
+    detecting = detecting || (*iter)->detecting_devices ();
+
+  device_unchecked[device_idx] = (detecting && audio_device != NULL
+                                  && strchr (audio_device, '(') && strchr (audio_device, '/'));
+
+  if (device_unchecked[device_idx]) {
+
+    /* Don't wait for the devices to be known : take the configured one
+     * right away, and check it later */
+    PTRACE(4, "AudioOutputCore\tDevices still being detected, using " << audio_device << " unchecked");
+    found = true;
+  }
+  else
+    get_devices (devices);
 
-  if (audio_device != NULL) {
+  if (audio_device != NULL && !found) {
 
     for (std::vector<AudioOutputDevice>::iterator it = devices.begin ();
          it < devices.end ();
@@ -302,6 +331,7 @@ AudioOutputCore::add_manager (AudioOutputManager& manager)
   manager.device_error.connect (boost::bind (boost::ref(device_error), boost::ref(manager), _1, _2, _3));
   manager.device_opened.connect (boost::bind (boost::ref(device_opened), boost::ref(manager), _1, _2, _3));
   manager.device_closed.connect (boost::bind (boost::ref(device_closed), boost::ref(manager), _1, _2));
+  manager.devices_detected.connect (boost::bind (&AudioOutputCore::on_devices_detected, this));
 }
 
 void
@@ -338,12 +368,12 @@ AudioOutputCore::play_event (const std::string& event_name)
   audio_event_scheduler->add_event_to_queue(event_name, false, 0, 0);
 }
 
-void
+unsigned
 AudioOutputCore::start_play_event (const std::string& event_name,
                                    unsigned interval,
                                    unsigned repetitions)
 {
-  audio_event_scheduler->add_event_to_queue(event_name, false, interval, repetitions);
+  return audio_event_scheduler->add_event_to_queue(event_name, false, interval, repetitions);
 }
 
 void
@@ -352,6 +382,12 @@ AudioOutputCore::stop_play_event (const std::string& event_name)
   audio_event_scheduler->remove_event_from_queue(event_name);
 }
 
+void
+AudioOutputCore::cancel_play_event (unsigned handle)
+{
+  audio_event_scheduler->cancel_event(handle);
+}
+
 void
 AudioOutputCore::get_devices (std::vector<std::string>& devices)
 {
@@ -391,6 +427,18 @@ AudioOutputCore::get_devices (std::vector <AudioOutputDevice>& devices)
 
 }
 
+void
+AudioOutputCore::refresh_devices ()
+{
+  PWaitAndSignal m_pri(core_mutex[primary]);
+  PWaitAndSignal m_sec(core_mutex[secondary]);
+
+  for (std::set<AudioOutputManager*>::const_iterator iter = managers.begin ();
+       iter != managers.end ();
+       ++iter)
+    (*iter)->refresh_devices ();
+}
+
 void
 AudioOutputCore::set_device(AudioOutputPS ps,
                             const AudioOutputDevice& device)
@@ -492,11 +540,12 @@ AudioOutputCore::start (unsigned channels,
                         unsigned bits_per_sample)
 {
   yield = true;
-  PWaitAndSignal m_pri(core_mutex[primary]);
+  core_mutex[primary].Wait ();
 
   if (current_primary_config.active) {
 
     PTRACE(1, "AudioOutputCore\tTrying to start output device although already started");
+    core_mutex[primary].Signal ();
     return;
   }
 
@@ -509,14 +558,24 @@ AudioOutputCore::start (unsigned channels,
   current_primary_config.bits_per_sample = bits_per_sample;
   current_primary_config.buffer_size = 0;
   current_primary_config.num_buffers = 0;
+  mixer.start (channels, samplerate, bits_per_sample);
+  core_mutex[primary].Signal ();
+
+  if (threaded_playout)
+    internal_start_playout ();
 }
 
 void
 AudioOutputCore::stop()
 {
   yield = true;
+
+  /* The playout thread needs the core mutex to stop */
+  playout_thread->stop_playout ();
+
   PWaitAndSignal m_pri(core_mutex[primary]);
 
+  mixer.stop ();
   average_level = 0;
   internal_close(primary);
 
@@ -541,6 +600,20 @@ void
 AudioOutputCore::set_frame_data (const char* data,
                                  unsigned size,
                                  unsigned& bytes_written)
+{
+  if (playout_thread->is_playing ())
+    playout_thread->write (data, size, bytes_written);
+  else
+    playout_frame_data (data, size, bytes_written);
+
+  if (calculate_average)
+    calculate_average_level((const short*) data, bytes_written);
+}
+
+void
+AudioOutputCore::playout_frame_data (const char* data,
+                                     unsigned size,
+                                     unsigned& bytes_written)
 {
   if (yield) {
 
@@ -549,6 +622,13 @@ AudioOutputCore::set_frame_data (const char* data,
   }
   PWaitAndSignal m_pri(core_mutex[primary]);
 
+  if (mixer.is_mixing ()) {
+
+    mix_buffer.assign (data, data + size);
+    mixer.mix (&mix_buffer[0], size);
+    data = &mix_buffer[0];
+  }
+
   if (current_manager[primary]) {
 
     if (!current_manager[primary]->set_frame_data(primary, data, size, bytes_written)) {
@@ -567,9 +647,38 @@ AudioOutputCore::set_frame_data (const char* data,
       current_primary_volume = desired_primary_volume;
     }
   }
+}
 
-  if (calculate_average)
-    calculate_average_level((const short*) data, bytes_written);
+void
+AudioOutputCore::get_playout_stats (unsigned & fill_level,
+                                    unsigned & ring_size,
+                                    unsigned & underruns,
+                                    unsigned & overruns) const
+{
+  fill_level = 0;
+  ring_size = 0;
+  underruns = 0;
+  overruns = 0;
+
+  if (!playout_thread->is_playing ())
+    return;
+
+  fill_level = playout_thread->get_fill_level ();
+  ring_size = playout_thread->get_ring_size ();
+  underruns = playout_thread->get_underruns ();
+  overruns = playout_thread->get_overruns ();
+}
+
+bool
+AudioOutputCore::get_device_latency (AudioOutputPS ps,
+                                     unsigned & latency)
+{
+  PWaitAndSignal m(core_mutex[ps]);
+
+  if (!current_manager[ps])
+    return false;
+
+  return current_manager[ps]->get_latency (ps, latency);
 }
 
 void
@@ -588,8 +697,14 @@ AudioOutputCore::play_buffer(AudioOutputPS ps,
                              unsigned long len,
                              unsigned channels,
                              unsigned sample_rate,
-                             unsigned bps)
+                             unsigned bps,
+                             float gain)
 {
+  // Mix the sound in the stream if there is one,
+  // rather than opening a second device
+  if (mixer.add_source (buffer, len, channels, sample_rate, bps, gain))
+    return;
+
   switch (ps) {
 
     case primary:
@@ -623,7 +738,7 @@ AudioOutputCore::play_buffer(AudioOutputPS ps,
         } else {
           core_mutex[secondary].Signal();
           PTRACE(1, "AudioOutputCore\tNo secondary audiooutput device defined, trying primary");
-          play_buffer(primary, buffer, len, channels, sample_rate, bps);
+          play_buffer(primary, buffer, len, channels, sample_rate, bps, gain);
         }
 
       break;
@@ -639,6 +754,55 @@ AudioOutputCore::on_set_device (const AudioOutputDevice& device)
   g_settings_set_string (audio_device_settings, "output-device", device.GetString ().c_str ());
 }
 
+void
+AudioOutputCore::on_devices_detected ()
+{
+  Ekiga::Runtime::run_in_main (boost::bind (&AudioOutputCore::check_devices, this));
+}
+
+void
+AudioOutputCore::check_devices ()
+{
+  PWaitAndSignal m_pri(core_mutex[primary]);
+  PWaitAndSignal m_sec(core_mutex[secondary]);
+  std::vector<AudioOutputDevice> devices;
+  gchar* audio_device = NULL;
+
+  if (!device_unchecked[primary] && !device_unchecked[secondary])
+    return;
+
+  get_devices (devices);
+
+  for (unsigned ii = primary; ii <= secondary; ii++) {
+
+    AudioOutputPS ps = (AudioOutputPS) ii;
+    bool found = false;
+
+    if (!device_unchecked[ps])
+      continue;
+
+    device_unchecked[ps] = false;
+
+    audio_device = g_settings_get_string ((ps == primary)?audio_device_settings:sound_events_settings,
+                                          "output-device");
+    for (std::vector<AudioOutputDevice>::iterator it = devices.begin ();
+         it < devices.end () && !found;
+         ++it)
+      found = (audio_device != NULL && (*it).GetString () == audio_device);
+    g_free (audio_device);
+
+    if (found) {
+
+      PTRACE(4, "AudioOutputCore\tChecked device[" << ps << "]");
+      continue;
+    }
+
+    /* it isn't there after all : pick another one the usual way */
+    PTRACE(1, "AudioOutputCore\tDevice[" << ps << "] wasn't detected");
+    setup_audio_device (ps);
+  }
+}
+
 void
 AudioOutputCore::internal_set_primary_device(const AudioOutputDevice& device)
 {
@@ -779,21 +943,32 @@ AudioOutputCore::internal_play(AudioOutputPS ps,
 }
 
 void
-AudioOutputCore::calculate_average_level (const short*buffer,
-                                          unsigned size)
+AudioOutputCore::internal_start_playout ()
 {
-  int sum = 0;
-  unsigned csize = 0;
+  unsigned bytes_per_ms = 0;
+  unsigned chunk_size = 0;
 
-  while (csize < (size>>1) ) {
+  core_mutex[primary].Wait ();
+  bytes_per_ms = current_primary_config.samplerate * current_primary_config.channels
+    * current_primary_config.bits_per_sample / 8 / 1000;
+  core_mutex[primary].Signal ();
 
-    if (*buffer < 0)
-      sum -= *buffer++;
-    else
-      sum += *buffer++;
+  if (bytes_per_ms == 0)
+    return;
 
-    csize++;
-  }
+  // Feed the device with 20ms chunks, and keep at most 4 of them
+  // waiting, which bounds the latency added by the ring
+  chunk_size = 20 * bytes_per_ms;
+  playout_thread->start_playout (chunk_size, 4 * chunk_size,
+                                 2 * chunk_size / bytes_per_ms);
+}
+
+void
+AudioOutputCore::calculate_average_level (const short*buffer,
+                                          unsigned size)
+{
+  /* size is in bytes, and so is the scale of that historical formula */
+  guint64 sum = AudioDSP::abs_sum (buffer, size >> 1);
 
   average_level = log10 (9.0*sum/size/32767+1)*1.0;
 }
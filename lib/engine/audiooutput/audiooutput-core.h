@@ -43,6 +43,8 @@
 
 #include "audiooutput-manager.h"
 #include "audiooutput-scheduler.h"
+#include "audiooutput-playout.h"
+#include "audiooutput-mixer.h"
 
 #include <ptlib.h>
 #include <gio/gio.h>
@@ -95,7 +97,15 @@ namespace Ekiga
    * back due to a removed device, and the respective device is re-added to the system,
    * it will be automatically activated.
    *
-
+   * Unless disabled in the settings, the frames of the audio streaming thread
+   * are not written directly to the primary device : they are queued in a
+   * lock-free ring which a dedicated playout thread (see AudioPlayoutThread)
+   * drains into the device, so that device changes and sound events never
+   * block the streaming thread.
+   *
+   * While the primary device is streaming, sound events are mixed into the
+   * stream (see AudioMixer) instead of being played on a device of their own.
+   * They only get their own device when the primary device is idle.
    */
   class AudioOutputCore
     : public Service
@@ -155,6 +165,11 @@ namespace Ekiga
       void get_devices(std::vector <std::string> & devices);
       void get_devices(std::vector <AudioOutputDevice> & devices);
 
+      /** Make the managers detect their devices again
+       * To be called when a device was added or removed.
+       */
+      void refresh_devices ();
+
       /** Set a specific device
        * This function sets the current primary or secondary audio output device. This function can
        * also be used while in a stream or in preview mode. In that case the old
@@ -239,16 +254,24 @@ namespace Ekiga
        * @param event_name the name of the event.
        * @param interval the interval of the repetitions in ms.
        * @param repetitions the maximum number of repetitions.
+       * @return a handle to give to cancel_play_event.
        */
-      void start_play_event (const std::string & event_name, unsigned interval, unsigned repetitions);
+      unsigned start_play_event (const std::string & event_name, unsigned interval, unsigned repetitions);
 
       /** Stop playing a sound specified by an event name
        * Stop playing sound associated to the event specified by its name.
+       * If that event was started several times, only the oldest one is stopped.
        * If the sound is currently playing, it will not be cut short.
        * @param event_name the name of the event.
        */
       void stop_play_event (const std::string & event_name);
 
+      /** Stop playing a sound started with start_play_event
+       * If the sound is currently playing, it will not be cut short.
+       * @param handle the value start_play_event returned.
+       */
+      void cancel_play_event (unsigned handle);
+
       /** Play a sound event buffer
        * This function is called by the Scheduler in order to play an already loaded sound.
        * @param ps whether to play the sound on the primary or secondary device.
@@ -257,9 +280,21 @@ namespace Ekiga
        * @param channels the number of channels.
        * @param sample_rate the samplerate.
        * @param bps bits per sample.
+       * @param gain the gain to apply to the sound when it is mixed in the stream.
        */
       void play_buffer(AudioOutputPS ps, const char* buffer, unsigned long len,
-                       unsigned channels, unsigned sample_rate, unsigned bps);
+                       unsigned channels, unsigned sample_rate, unsigned bps,
+                       float gain = 1.0f);
+
+      /** Get the format sound events are mixed in
+       * This function is called by the Scheduler, so that it can convert its
+       * sounds once for the stream, instead of each time they are played.
+       * @param channels the number of channels of the stream.
+       * @param sample_rate the samplerate of the stream (16 bits samples).
+       * @return false if the primary device isn't streaming.
+       */
+      bool get_mix_format (unsigned & channels, unsigned & sample_rate)
+        { return mixer.get_format (channels, sample_rate); }
 
 
       /*** Stream Management ***/
@@ -295,6 +330,32 @@ namespace Ekiga
        */
       void set_frame_data (const char *data, unsigned size, unsigned & bytes_written);
 
+     /** Set one audio buffer directly in the current primary manager.
+       * This is what set_frame_data() does when no playout thread is used,
+       * and what the playout thread does to empty its ring.
+       * @param data a pointer to the buffer that is to be written to the device.
+       * @param size the number of bytes to be written.
+       * @param bytes_written number of bytes actually written.
+       */
+      void playout_frame_data (const char *data, unsigned size, unsigned & bytes_written);
+
+      /** Get the state of the playout ring
+       * All values are zero if no playout thread is running.
+       * @param fill_level the number of bytes waiting to be played.
+       * @param ring_size the maximum number of bytes waiting in the ring.
+       * @param underruns how many times the device was fed with silence.
+       * @param overruns how many times incoming frames were dropped.
+       */
+      void get_playout_stats (unsigned & fill_level, unsigned & ring_size,
+                              unsigned & underruns, unsigned & overruns) const;
+
+      /** Get the latency of the current device, as reported by its manager
+       * @param ps whether the primary or secondary device is meant.
+       * @param latency the latency in ms.
+       * @return false if the device is not opened or its latency is not known.
+       */
+      bool get_device_latency (AudioOutputPS ps, unsigned & latency);
+
      /** Set the volume of the next opportunity
        * Sets the volume to the specified value the next time
        * get_frame_data() is called.
@@ -341,6 +402,8 @@ namespace Ekiga
 
   private:
       void on_set_device (const AudioOutputDevice & device);
+      void on_devices_detected ();
+      void check_devices ();
 
       void internal_set_primary_device (const AudioOutputDevice & device);
       void internal_set_manager (AudioOutputPS ps, const AudioOutputDevice & device);
@@ -353,6 +416,8 @@ namespace Ekiga
 
       void calculate_average_level (const short *buffer, unsigned size);
 
+      void internal_start_playout ();
+
       std::set<AudioOutputManager *> managers;
 
       typedef struct DeviceConfig {
@@ -376,11 +441,20 @@ namespace Ekiga
       PMutex volume_mutex;
 
       AudioEventScheduler* audio_event_scheduler;
+      AudioPlayoutThread* playout_thread;
+      bool threaded_playout;
+
+      AudioMixer mixer;
+      std::vector<char> mix_buffer;
 
       float average_level;
       bool calculate_average;
       bool yield;
 
+      /* the configured devices were picked before the managers knew their
+       * devices : check them once they do */
+      bool device_unchecked[2];
+
       boost::shared_ptr<Ekiga::NotificationCore> notification_core;
 
       GSettings *sound_events_settings;
@@ -0,0 +1,165 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         audiooutput-mixer.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Implementation of a mixer adding sound events
+ *                          to the primary audio stream.
+ *
+ */
+
+#include <algorithm>
+
+#include "audiooutput-mixer.h"
+#include "audio-converter.h"
+#include "audio-dsp.h"
+
+using namespace Ekiga;
+
+AudioMixer::AudioMixer ()
+{
+  sources_count = 0;
+  started = 0;
+  channels = 0;
+  samplerate = 0;
+  bits_per_sample = 0;
+}
+
+void
+AudioMixer::start (unsigned _channels,
+                   unsigned _samplerate,
+                   unsigned _bits_per_sample)
+{
+  PWaitAndSignal m(sources_mutex);
+
+  channels = _channels;
+  samplerate = _samplerate;
+  bits_per_sample = _bits_per_sample;
+
+  // Only 16 bits streams are mixed, others get their own device
+  g_atomic_int_set (&started, (bits_per_sample == 16) ? 1 : 0);
+}
+
+void
+AudioMixer::stop ()
+{
+  PWaitAndSignal m(sources_mutex);
+
+  g_atomic_int_set (&started, 0);
+  sources.clear ();
+  g_atomic_int_set (&sources_count, 0);
+}
+
+bool
+AudioMixer::get_format (unsigned& _channels,
+                        unsigned& _samplerate)
+{
+  PWaitAndSignal m(sources_mutex);
+
+  if (!g_atomic_int_get (&started))
+    return false;
+
+  _channels = channels;
+  _samplerate = samplerate;
+
+  return true;
+}
+
+bool
+AudioMixer::add_source (const char* buffer,
+                        unsigned long len,
+                        unsigned _channels,
+                        unsigned sample_rate,
+                        unsigned bps,
+                        float gain)
+{
+  AudioConverter converter;
+  std::vector<char> data;
+  unsigned stream_channels = 0;
+  unsigned stream_samplerate = 0;
+
+  if (!g_atomic_int_get (&started))
+    return false;
+
+  if (bps != 8 && bps != 16)
+    return false;
+
+  sources_mutex.Wait ();
+  stream_channels = channels;
+  stream_samplerate = samplerate;
+  sources_mutex.Signal ();
+
+  /* The conversion is done here, in the caller thread,
+   * not in the streaming thread */
+  converter.setup (_channels, sample_rate, bps, stream_channels, stream_samplerate, 16);
+  converter.convert (buffer, len, data);
+  if (data.empty ())
+    return true;
+
+  PWaitAndSignal m(sources_mutex);
+
+  // The stream was stopped or restarted in another format meanwhile
+  if (!g_atomic_int_get (&started)
+      || channels != stream_channels || samplerate != stream_samplerate)
+    return false;
+
+  PTRACE(4, "AudioMixer\tMixing " << data.size () << " bytes in the stream");
+  sources.push_back (Source ());
+  sources.back ().data.swap (data);
+  sources.back ().position = 0;
+  sources.back ().gain = gain;
+  g_atomic_int_inc (&sources_count);
+
+  return true;
+}
+
+void
+AudioMixer::mix (char* data,
+                 unsigned size)
+{
+  PWaitAndSignal m(sources_mutex);
+
+  std::list<Source>::iterator iter = sources.begin ();
+
+  while (iter != sources.end ()) {
+
+    unsigned len = (unsigned) std::min ((size_t) size, iter->data.size () - iter->position);
+
+    AudioDSP::mix ((short*) data, (const short*) &iter->data[iter->position], len / 2, iter->gain);
+    iter->position += len;
+
+    if (iter->position >= iter->data.size ()) {
+
+      iter = sources.erase (iter);
+      g_atomic_int_add (&sources_count, -1);
+    }
+    else
+      ++iter;
+  }
+}
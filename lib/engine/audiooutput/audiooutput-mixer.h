@@ -0,0 +1,121 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         audiooutput-mixer.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Declaration of a mixer adding sound events
+ *                          to the primary audio stream.
+ *
+ */
+
+#ifndef __AUDIOOUTPUT_MIXER_H__
+#define __AUDIOOUTPUT_MIXER_H__
+
+#include <list>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include <glib.h>
+#include <ptlib.h>
+
+namespace Ekiga
+{
+  /** Mixer of the AudioOutputCore
+   * While the primary device is streaming, sound events are not played on
+   * their own device : they are converted to the format of the stream, and
+   * added to it, sample by sample, right before it is written to the device.
+   * Each source has its own gain, and the sum saturates instead of wrapping.
+   */
+  class AudioMixer : public boost::noncopyable
+  {
+  public:
+    AudioMixer ();
+
+    /** Start accepting sources
+     * @param channels the number of channels of the stream.
+     * @param samplerate the samplerate of the stream.
+     * @param bits_per_sample the number of bits per sample of the stream.
+     */
+    void start (unsigned channels, unsigned samplerate, unsigned bits_per_sample);
+
+    /** Stop accepting sources, and drop those which were not finished
+     */
+    void stop ();
+
+    /** Add a sound to the stream
+     * @param buffer pointer to the sound in raw format.
+     * @param len the length in bytes of the sound.
+     * @param channels the number of channels.
+     * @param sample_rate the samplerate.
+     * @param bps bits per sample.
+     * @param gain the gain to apply to the sound.
+     * @return false if the mixer is stopped : the sound should then be played
+     * on a device of its own.
+     */
+    bool add_source (const char* buffer, unsigned long len,
+                     unsigned channels, unsigned sample_rate, unsigned bps,
+                     float gain);
+
+    /** Get the format of the stream
+     * Sources already in that format (16 bits) are added without conversion.
+     * @param channels the number of channels of the stream.
+     * @param samplerate the samplerate of the stream.
+     * @return false if the mixer is stopped.
+     */
+    bool get_format (unsigned& channels, unsigned& samplerate);
+
+    /** Returns true if some source still has data to mix
+     */
+    bool is_mixing () const
+      { return g_atomic_int_get (&sources_count) > 0; }
+
+    /** Add the pending sources to one buffer of the stream
+     * @param data the stream buffer.
+     * @param size its size in bytes.
+     */
+    void mix (char* data, unsigned size);
+
+  private:
+    typedef struct Source {
+      std::vector<char> data;
+      unsigned long position;
+      float gain;
+    } Source;
+
+    PMutex sources_mutex;
+    std::list<Source> sources;
+    volatile gint sources_count;
+    volatile gint started;
+
+    unsigned channels;
+    unsigned samplerate;
+    unsigned bits_per_sample;
+  };
+};
+#endif
@@ -0,0 +1,134 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         audiooutput-playout.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Implementation of a thread feeding the current
+ *                          audio output device from a lock-free ring.
+ *
+ */
+
+#include <algorithm>
+
+#include "audiooutput-playout.h"
+#include "audiooutput-core.h"
+
+using namespace Ekiga;
+
+AudioPlayoutThread::AudioPlayoutThread (AudioOutputCore& _audio_output_core)
+: AudioStreamThread ("AudioPlayoutThread"),
+  max_fill (0),
+  chunk_duration (0),
+  write_timeout (0),
+  audio_output_core (_audio_output_core)
+{
+}
+
+AudioPlayoutThread::~AudioPlayoutThread ()
+{
+  quit ();
+}
+
+void AudioPlayoutThread::start_playout (unsigned _chunk_size,
+                                        unsigned ring_size,
+                                        unsigned timeout)
+{
+  stop_playout ();
+
+  PTRACE(4, "AudioPlayoutThread\tStarting playout with " << _chunk_size << "/" << ring_size << " bytes");
+
+  chunk_duration = timeout / 2;
+  write_timeout = timeout;
+  max_fill = ring_size;
+  start (_chunk_size, ring_size);
+}
+
+void AudioPlayoutThread::stop_playout ()
+{
+  if (!is_playing ())
+    return;
+
+  stop ();
+
+  PTRACE(4, "AudioPlayoutThread\tStopped playout, " << get_overruns () << " overruns, "
+         << get_underruns () << " underruns");
+}
+
+void AudioPlayoutThread::write (const char* data,
+                                unsigned size,
+                                unsigned & bytes_written)
+{
+  unsigned fill = 0;
+
+  bytes_written = 0;
+
+  for (;;) {
+
+    /* The ring capacity is a power of two : stick to the
+     * requested depth so that latency stays bounded */
+    fill = ring.readable ();
+    if (fill < max_fill)
+      bytes_written += ring.write (data + bytes_written,
+                                   std::min (max_fill - fill, size - bytes_written));
+    data_available.Signal ();
+
+    if (bytes_written >= size)
+      break;
+
+    if (!space_available.Wait (write_timeout)) {
+
+      /* The device is stalled (reopening, fallback...) :
+       * drop what does not fit rather than block the stream */
+      g_atomic_int_inc (&overruns);
+      break;
+    }
+  }
+}
+
+void AudioPlayoutThread::process_chunk ()
+{
+  unsigned len = 0;
+  unsigned bytes_written = 0;
+
+  len = ring.read (chunk, chunk_size);
+  if (len < chunk_size && data_available.Wait (chunk_duration))
+    len += ring.read (chunk + len, chunk_size - len);
+  space_available.Signal ();
+
+  /* The streaming thread is late : keep the device fed */
+  if (len < chunk_size) {
+
+    memset (chunk + len, 0, chunk_size - len);
+    g_atomic_int_inc (&underruns);
+  }
+
+  audio_output_core.playout_frame_data (chunk, chunk_size, bytes_written);
+
+  if (bytes_written == 0)
+    Current()->Sleep (chunk_duration);
+}
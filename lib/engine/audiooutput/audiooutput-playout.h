@@ -0,0 +1,109 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         audiooutput-playout.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Declaration of a thread feeding the current
+ *                          audio output device from a lock-free ring.
+ *
+ */
+
+
+#ifndef __AUDIOOUTPUT_PLAYOUT_H__
+#define __AUDIOOUTPUT_PLAYOUT_H__
+
+#include "audio-stream-thread.h"
+
+namespace Ekiga
+{
+  class AudioOutputCore;
+
+  /** Playout thread of the AudioOutputCore
+   * The audio streaming thread only pushes its frames into a
+   * single-producer/single-consumer ring, while this thread pops them and
+   * writes them to the primary device through the AudioOutputCore. Device
+   * reopening, fallback and sound event playback thus only ever stall this
+   * thread, never the streaming thread.
+   */
+  class AudioPlayoutThread : public AudioStreamThread
+  {
+    PCLASSINFO(AudioPlayoutThread, AudioStreamThread);
+
+  public:
+    AudioPlayoutThread (Ekiga::AudioOutputCore& _audio_output_core);
+    ~AudioPlayoutThread ();
+
+    /** Start feeding the device
+     * Must not be called with the core mutex held.
+     * @param chunk_size the number of bytes written to the device at once.
+     * @param ring_size the capacity of the ring in bytes.
+     * @param timeout how long write () waits for room before dropping data (ms).
+     */
+    void start_playout (unsigned chunk_size, unsigned ring_size, unsigned timeout);
+
+    /** Stop feeding the device, and wait for the thread to be idle
+     * Must not be called with the core mutex held.
+     */
+    void stop_playout ();
+
+    bool is_playing () const
+      { return is_running (); }
+
+    /** Copy one buffer into the ring
+     * Blocks while the ring is full, which paces the streaming thread on
+     * the device. If the device stalls for longer than the timeout, what
+     * does not fit is dropped.
+     * @param data a pointer to the buffer that is to be played.
+     * @param size the number of bytes to be written.
+     * @param bytes_written number of bytes actually written.
+     */
+    void write (const char* data, unsigned size, unsigned & bytes_written);
+
+    /** Returns the number of bytes waiting in the ring
+     */
+    unsigned get_fill_level () const
+      { return ring.readable (); }
+
+    /** Returns the maximum number of bytes waiting in the ring
+     */
+    unsigned get_ring_size () const
+      { return max_fill; }
+
+  protected:
+    void process_chunk ();
+
+    PSyncPoint space_available;
+
+    unsigned max_fill;
+    unsigned chunk_duration;
+    unsigned write_timeout;
+
+    Ekiga::AudioOutputCore& audio_output_core;
+  };
+};
+#endif
@@ -33,13 +33,26 @@
  *
  */
 
+#include <algorithm>
+#include <functional>
+
+#include <glib/gstdio.h>
+
 #include "audiooutput-scheduler.h"
 #include "audiooutput-core.h"
+#include "audio-converter.h"
 #include "config.h"
 #ifdef WIN32
 #include "platform/winpaths.h"
 #endif
 
+/* Bounds of the sound cache : sounds, and conversions per sound */
+#define MAX_CACHED_SOUNDS 32
+#define MAX_CONVERTED_FORMATS 2
+
+/* How often a cached sound file is checked for changes when played (ms) */
+#define STALE_CHECK_INTERVAL 10000
+
 using namespace Ekiga;
 
 AudioEventScheduler::AudioEventScheduler (AudioOutputCore& _audio_output_core)
@@ -47,6 +60,8 @@ AudioEventScheduler::AudioEventScheduler (AudioOutputCore& _audio_output_core)
   audio_output_core (_audio_output_core)
 {
   end_thread = false;
+  next_handle = 1;
+  sound_uses = 0;
   // Since windows does not like to restart a thread that
   // was never started, we do so here
   this->Resume ();
@@ -72,36 +87,34 @@ void AudioEventScheduler::Main ()
   PWaitAndSignal m(thread_ended);
 
   std::vector <AudioEvent> pending_event_list;
-  unsigned idle_time = 65535;
+  gint64 idle_time = -1;
   AudioEvent event;
-  char* buffer = NULL;
-  unsigned long buffer_len = 0;
-  unsigned channels, sample_rate, bps;
+  boost::shared_ptr<AudioSound> sound;
   AudioOutputPS ps;
 
   thread_created.Signal ();
 
   while (!end_thread) {
 
-    if (idle_time == 65535)
+    if (idle_time < 0)
       run_thread.Wait ();
-    else
-      run_thread.Wait (idle_time);
+    else if (idle_time > 0)
+      run_thread.Wait (PTimeInterval (idle_time));
 
     if (end_thread)
       break;
-      
+
+    preload_sounds ();
+
     get_pending_event_list(pending_event_list);
     PTRACE(4, "AEScheduler\tChecking pending list with " << pending_event_list.size() << " elements");
 
     while (pending_event_list.size() > 0) {
       event = *(pending_event_list.begin()); pending_event_list.erase(pending_event_list.begin());
-      load_wav(event.name, event.is_file_name, buffer, buffer_len, channels, sample_rate, bps, ps);
-      if (buffer) {
-         audio_output_core.play_buffer (ps, buffer, buffer_len, channels, sample_rate, bps);
-        free (buffer);
-        buffer = NULL;
-      }
+      sound = load_wav(event.name, event.is_file_name, ps);
+      if (sound && !sound->data.empty ())
+        play_sound (ps, *sound);
+      sound.reset ();
       Current()->Sleep (10);
     }
     idle_time = get_time_to_next_event();
@@ -112,72 +125,97 @@ void AudioEventScheduler::get_pending_event_list (std::vector<AudioEvent> & pend
 {
   PWaitAndSignal m(event_list_mutex);
 
-  AudioEvent event;
-  std::vector <AudioEvent> new_event_list;
-  unsigned long time = get_time_ms();
+  gint64 time = get_time_ms();
 
   pending_event_list.clear();
 
-  while (event_list.size() > 0) {
+  while (!event_heap.empty () && event_heap.front ().first <= time) {
+
+    unsigned handle = event_heap.front ().second;
+    std::map<unsigned, AudioEvent>::iterator iter = event_list.find (handle);
+
+    std::pop_heap (event_heap.begin (), event_heap.end (), std::greater<EventDeadline> ());
+    event_heap.pop_back ();
+
+    if (iter == event_list.end ())
+      continue; // cancelled
 
-    event = *(event_list.begin()); event_list.erase(event_list.begin());
+    AudioEvent& event = iter->second;
+    pending_event_list.push_back(event);
 
     if (event.interval == 0) {
-      pending_event_list.push_back(event);
+      event_list.erase (iter);
+      continue;
     }
-    else {
-      if (event.time <= time) {
-        pending_event_list.push_back(event);
-        event.repetitions--; 
-        if (event.repetitions > 0) {
-          event.time = time + event.interval;
-          new_event_list.push_back(event);
-        }
-      }
-      else {
-        new_event_list.push_back(event);
-      }
+
+    event.repetitions--;
+    if (event.repetitions > 0) {
+      // Keep the period stable, unless we are really late
+      event.time += event.interval;
+      if (event.time < time)
+        event.time = time + event.interval;
+      schedule_event (handle, event.time);
     }
+    else
+      event_list.erase (iter);
   }
-
-  event_list = new_event_list;
 }
 
-unsigned long AudioEventScheduler::get_time_ms()
+gint64 AudioEventScheduler::get_time_ms()
 {
-  GTimeVal time_val;
-  g_get_current_time(&time_val);
-  return (time_val.tv_sec * 1000 + (unsigned long) (time_val.tv_usec / 1000) );
+  return g_get_monotonic_time () / 1000;
 }
 
-unsigned AudioEventScheduler::get_time_to_next_event()
+gint64 AudioEventScheduler::get_time_to_next_event()
 {
   PWaitAndSignal m(event_list_mutex);
-  unsigned long time = get_time_ms();
-  unsigned min_time = 65535;
 
-  for (std::vector<AudioEvent>::iterator iter = event_list.begin ();
-       iter !=event_list.end ();
-       iter++) {
+  // Drop the entries of cancelled events first
+  while (!event_heap.empty ()
+         && event_list.find (event_heap.front ().second) == event_list.end ()) {
+    std::pop_heap (event_heap.begin (), event_heap.end (), std::greater<EventDeadline> ());
+    event_heap.pop_back ();
+  }
+
+  if (event_heap.empty ())
+    return -1;
+
+  return std::max (event_heap.front ().first - get_time_ms(), (gint64) 0);
+}
 
-    if ( (iter->interval > 0) && ((iter->time - time) < min_time) )
-      min_time = iter->time - time;
+void AudioEventScheduler::schedule_event(unsigned handle, gint64 time)
+{
+  // Too many stale entries : rebuild the heap from the live events
+  if (event_heap.size () > 2 * event_list.size () + 16) {
+    event_heap.clear ();
+    for (std::map<unsigned, AudioEvent>::iterator iter = event_list.begin ();
+         iter != event_list.end ();
+         iter++)
+      if (iter->first != handle)
+        event_heap.push_back (EventDeadline (iter->second.time, iter->first));
+    std::make_heap (event_heap.begin (), event_heap.end (), std::greater<EventDeadline> ());
   }
-  return min_time;
+
+  event_heap.push_back (EventDeadline (time, handle));
+  std::push_heap (event_heap.begin (), event_heap.end (), std::greater<EventDeadline> ());
 }
 
-void AudioEventScheduler::add_event_to_queue(const std::string & name, bool is_file_name, unsigned interval, unsigned repetitions)
+unsigned AudioEventScheduler::add_event_to_queue(const std::string & name, bool is_file_name, unsigned interval, unsigned repetitions)
 {
   PTRACE(4, "AEScheduler\tAdding Event " << name << " " << interval << "/" << repetitions << " to queue");
   PWaitAndSignal m(event_list_mutex);
   AudioEvent event;
+  unsigned handle = next_handle++;
   event.name = name;
   event.is_file_name = is_file_name;
   event.interval = interval;
   event.repetitions = repetitions;
   event.time = get_time_ms();
-  event_list.push_back(event);
+  event_list[handle] = event;
+  schedule_event (handle, event.time);
   run_thread.Signal();
+
+  return handle;
 }
 
 void AudioEventScheduler::remove_event_from_queue(const std::string & name)
@@ -185,69 +223,233 @@ void AudioEventScheduler::remove_event_from_queue(const std::string & name)
   PTRACE(4, "AEScheduler\tRemoving Event " << name << " from queue");
   PWaitAndSignal m(event_list_mutex);
 
-  bool found = false;
-  std::vector<AudioEvent>::iterator iter;
-
-  for (iter = event_list.begin ();
-       iter != event_list.end () ;
+  // Only the oldest event of that name goes, as handles grow with time
+  for (std::map<unsigned, AudioEvent>::iterator iter = event_list.begin ();
+       iter != event_list.end ();
        iter++) {
 
-      if ( (iter->name == name) ) { 
-        found = true;
-        break;
-      }
+    if (iter->second.name == name) {
+      event_list.erase (iter);
+      break;
+    }
   }
+}
 
-  if (found) {
-    event_list.erase(iter);
-  }
+void AudioEventScheduler::cancel_event(unsigned handle)
+{
+  PTRACE(4, "AEScheduler\tCancelling Event " << handle);
+  PWaitAndSignal m(event_list_mutex);
+
+  event_list.erase (handle);
 }
 
-void AudioEventScheduler::load_wav(const std::string & event_name, bool is_file_name, char* & buffer, unsigned long & len, unsigned & channels, unsigned & sample_rate, unsigned & bps, AudioOutputPS & ps)
+boost::shared_ptr<AudioSound> AudioEventScheduler::load_wav(const std::string & event_name, bool is_file_name, AudioOutputPS & ps)
 {
-  PWAVFile* wav = NULL;
+  boost::shared_ptr<AudioSound> sound;
   std::string file_name;
-
-  len = 0;
-  buffer = NULL;
+  SoundKey key;
 
   // Shall we also try event name as file name?
   if (is_file_name) {
     file_name = event_name;
     ps = primary;
+    key = SoundKey ("", file_name);
   }
-  else 
+  else {
     if (!get_file_name(event_name, file_name, ps)) // if this event is disabled
-      return;
+      return sound;
+    key = SoundKey (event_name, file_name);
+  }
+
+  {
+    PWaitAndSignal m(sound_cache_mutex);
+    std::map<SoundKey, boost::shared_ptr<AudioSound> >::iterator iter = sound_cache.find (key);
+    if (iter != sound_cache.end ()) {
+
+      if (!is_stale (*iter->second)) {
+
+        iter->second->last_used = ++sound_uses;
+        return iter->second;
+      }
+
+      PTRACE(4, "AEScheduler\t" << file_name << " changed, reloading it");
+      sound_cache.erase (iter);
+    }
+  }
 
   PTRACE(4, "AEScheduler\tTrying to load " << file_name << " for event " << event_name);
+  sound = read_wav (file_name);
+
+  if (sound) {
+    PWaitAndSignal m(sound_cache_mutex);
+    sound->last_used = ++sound_uses;
+    sound_cache[key] = sound;
+    trim_sound_cache ();
+  }
+
+  return sound;
+}
+
+boost::shared_ptr<AudioSound> AudioEventScheduler::read_wav(const std::string & file_name)
+{
+  boost::shared_ptr<AudioSound> sound;
+  PWAVFile* wav = NULL;
+
+  std::string path = file_name;
+
   wav = new PWAVFile (file_name.c_str(), PFile::ReadOnly);
 
   if (!wav->IsValid ()) {
      /* it isn't a full path to a file : add our default path */
- 
+
     delete wav;
     wav = NULL;
- 
+
     gchar* filename = g_build_filename (DATA_DIR, "sounds", PACKAGE_NAME, file_name.c_str(), NULL);
-    PTRACE(4, "AEScheduler\tTrying to load " << filename << " for event " << event_name);
+    PTRACE(4, "AEScheduler\tTrying to load " << filename);
 
     wav = new PWAVFile (filename, PFile::ReadOnly);
+    path = filename;
     g_free (filename);
   }
-  
+
   if (wav->IsValid ()) {
-    len = wav->GetLength();
-    channels = wav->GetChannels ();
-    sample_rate = wav->GetSampleRate ();
-    bps = wav->GetSampleSize ();
-
-    buffer = (char*) malloc (len);
-    memset(buffer, 127, len);
-    wav->Read(buffer, len);
+    sound = boost::shared_ptr<AudioSound> (new AudioSound);
+    sound->file_name = file_name;
+    sound->channels = wav->GetChannels ();
+    sound->sample_rate = wav->GetSampleRate ();
+    sound->bps = wav->GetSampleSize ();
+    sound->path = path;
+    sound->mtime = 0;
+    sound->size = 0;
+    sound->last_used = 0;
+    sound->checked = get_time_ms ();
+
+    GStatBuf info;
+    if (g_stat (path.c_str (), &info) == 0) {
+      sound->mtime = info.st_mtime;
+      sound->size = info.st_size;
+    }
+
+    sound->data.resize (wav->GetLength ());
+    if (!sound->data.empty () && wav->Read (&sound->data[0], sound->data.size ()))
+      sound->data.resize (wav->GetLastReadCount ());
+    else
+      sound->data.clear ();
   }
 
   delete wav;
+
+  return sound;
+}
+
+bool AudioEventScheduler::is_stale(AudioSound & sound)
+{
+  GStatBuf info;
+  gint64 now = get_time_ms ();
+
+  // Called with sound_cache_mutex held : don't hit the disk on every play
+  if (now - sound.checked < STALE_CHECK_INTERVAL)
+    return false;
+  sound.checked = now;
+
+  if (g_stat (sound.path.c_str (), &info) != 0)
+    return true;
+
+  return (info.st_mtime != sound.mtime || info.st_size != sound.size);
+}
+
+void AudioEventScheduler::trim_sound_cache()
+{
+  // Called with sound_cache_mutex held
+  while (sound_cache.size () > MAX_CACHED_SOUNDS) {
+
+    std::map<SoundKey, boost::shared_ptr<AudioSound> >::iterator oldest = sound_cache.begin ();
+
+    for (std::map<SoundKey, boost::shared_ptr<AudioSound> >::iterator iter = sound_cache.begin ();
+         iter != sound_cache.end ();
+         iter++)
+      if (iter->second->last_used < oldest->second->last_used)
+        oldest = iter;
+
+    PTRACE(4, "AEScheduler\tDropping " << oldest->second->file_name << " from the sound cache");
+    sound_cache.erase (oldest);
+  }
+}
+
+void AudioEventScheduler::play_sound(AudioOutputPS ps, AudioSound & sound)
+{
+  unsigned channels = 0;
+  unsigned sample_rate = 0;
+
+  /* Only the scheduler thread touches the conversions of a sound,
+   * so they need no lock */
+  if ((sound.bps == 8 || sound.bps == 16)
+      && audio_output_core.get_mix_format (channels, sample_rate)) {
+
+    AudioFormat format (channels, sample_rate);
+    std::map<AudioFormat, std::vector<char> >::iterator iter = sound.converted.find (format);
+
+    if (iter == sound.converted.end ()) {
+
+      AudioConverter converter;
+
+      if (sound.converted.size () >= MAX_CONVERTED_FORMATS)
+        sound.converted.clear ();
+
+      PTRACE(4, "AEScheduler\tConverting " << sound.file_name << " to " << channels << "x" << sample_rate);
+      iter = sound.converted.insert (std::make_pair (format, std::vector<char> ())).first;
+      converter.setup (sound.channels, sound.sample_rate, sound.bps, channels, sample_rate, 16);
+      converter.convert (&sound.data[0], sound.data.size (), iter->second);
+    }
+
+    // If the stream changed meanwhile, the mixer converts it again
+    if (!iter->second.empty ()) {
+
+      audio_output_core.play_buffer (ps, &iter->second[0], iter->second.size (),
+                                     channels, sample_rate, 16);
+      return;
+    }
+  }
+
+  audio_output_core.play_buffer (ps, &sound.data[0], sound.data.size (),
+                                 sound.channels, sound.sample_rate, sound.bps);
+}
+
+void AudioEventScheduler::preload_sounds()
+{
+  std::vector<std::string> events;
+  AudioOutputPS ps;
+
+  {
+    PWaitAndSignal m(sound_cache_mutex);
+    events.swap (preload_list);
+  }
+
+  for (std::vector<std::string>::iterator iter = events.begin ();
+       iter != events.end ();
+       iter++)
+    load_wav (*iter, false, ps);
+}
+
+void AudioEventScheduler::invalidate_sounds(const std::string & event_name)
+{
+  PWaitAndSignal m(sound_cache_mutex);
+
+  std::map<SoundKey, boost::shared_ptr<AudioSound> >::iterator iter = sound_cache.lower_bound (SoundKey (event_name, ""));
+
+  while (iter != sound_cache.end () && iter->first.first == event_name)
+    sound_cache.erase (iter++);
+}
+
+void AudioEventScheduler::recheck_sounds(const std::string & event_name)
+{
+  PWaitAndSignal m(sound_cache_mutex);
+
+  std::map<SoundKey, boost::shared_ptr<AudioSound> >::iterator iter = sound_cache.lower_bound (SoundKey (event_name, ""));
+
+  for ( ; iter != sound_cache.end () && iter->first.first == event_name; iter++)
+    iter->second->checked = 0;
 }
 
 
@@ -279,15 +481,17 @@ bool AudioEventScheduler::get_file_name(const std::string & event_name, std::str
 
 void AudioEventScheduler::set_file_name(const std::string & event_name, const std::string & file_name,  AudioOutputPS ps, bool enabled)
 {
-  PWaitAndSignal m(event_file_list_mutex);
+  event_file_list_mutex.Wait ();
 
   bool found = false;
+  bool changed = true;
 
   for (std::vector<EventFileName>::iterator iter = event_file_list.begin ();
        iter != event_file_list.end ();
        iter++) {
 
     if (iter->event_name == event_name) {
+      changed = (iter->file_name != file_name);
       iter->file_name = file_name;
       iter->enabled = enabled;
       iter->ps = ps;
@@ -304,4 +508,19 @@ void AudioEventScheduler::set_file_name(const std::string & event_name, const st
     event_file_name.ps = secondary;
     event_file_list.push_back(event_file_name);
   }
+
+  event_file_list_mutex.Signal ();
+
+  if (changed)
+    invalidate_sounds (event_name);
+  else
+    recheck_sounds (event_name);
+
+  // Decode the sound in the scheduler thread now,
+  // so that playing it later needs no disk access
+  if (enabled) {
+    PWaitAndSignal m(sound_cache_mutex);
+    preload_list.push_back (event_name);
+    run_thread.Signal ();
+  }
 }
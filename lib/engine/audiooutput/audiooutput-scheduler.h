@@ -42,6 +42,8 @@
 
 #include <glib.h>
 #include <vector>
+#include <map>
+#include <boost/smart_ptr.hpp>
 #include <ptlib.h>
 #include <ptclib/pwavfile.h>
 
@@ -54,7 +56,7 @@ namespace Ekiga
     bool is_file_name;
     unsigned interval;
     unsigned repetitions;
-    unsigned long time;
+    gint64 time;  // deadline, on the monotonic clock (ms)
   } AudioEvent;
 
   typedef struct EventFileName {
@@ -64,6 +66,23 @@ namespace Ekiga
     AudioOutputPS ps;
   } EventFileName;
 
+  /* A sound file, decoded once and kept in memory, along with its
+   * conversions to the formats of the streams it was mixed in */
+  typedef std::pair<unsigned, unsigned> AudioFormat; // channels, sample rate
+  typedef struct AudioSound {
+    std::string file_name;
+    std::vector<char> data;
+    unsigned channels;
+    unsigned sample_rate;
+    unsigned bps;
+    std::map<AudioFormat, std::vector<char> > converted;
+    std::string path;  // the file actually read
+    gint64 mtime;
+    gint64 size;
+    guint64 last_used;
+    gint64 checked;  // when the file was last checked for changes (ms)
+  } AudioSound;
+
   class AudioEventScheduler : public PThread
   {
     PCLASSINFO(AudioEventScheduler, PThread);
@@ -72,17 +91,28 @@ namespace Ekiga
     AudioEventScheduler(Ekiga::AudioOutputCore& _audio_output_core);
     ~AudioEventScheduler();
     void quit ();
-    void add_event_to_queue(const std::string & name, bool is_file_name, unsigned interval, unsigned repetitions);
+    /* Returns a handle which can be given to cancel_event */
+    unsigned add_event_to_queue(const std::string & name, bool is_file_name, unsigned interval, unsigned repetitions);
+    /* Removes the oldest queued event with that name */
     void remove_event_from_queue(const std::string & name);
+    void cancel_event(unsigned handle);
     void set_file_name(const std::string & event_name, const std::string & file_name, AudioOutputPS ps, bool enabled);
 
   protected:
     void Main (void);
     void get_pending_event_list (std::vector<AudioEvent> & pending_event_list);
-    unsigned long get_time_ms();
-    unsigned get_time_to_next_event();
+    gint64 get_time_ms();
+    gint64 get_time_to_next_event();
+    void schedule_event(unsigned handle, gint64 time);
     bool get_file_name(const std::string & event_name, std::string & file_name, AudioOutputPS & ps);
-    void load_wav(const std::string & event_name, bool is_file_name, char* & buffer, unsigned long & len, unsigned & channels, unsigned & sample_rate, unsigned & bps, AudioOutputPS & ps);
+    boost::shared_ptr<AudioSound> load_wav(const std::string & event_name, bool is_file_name, AudioOutputPS & ps);
+    boost::shared_ptr<AudioSound> read_wav(const std::string & file_name);
+    bool is_stale(AudioSound & sound);
+    void trim_sound_cache();
+    void play_sound(AudioOutputPS ps, AudioSound & sound);
+    void preload_sounds();
+    void invalidate_sounds(const std::string & event_name);
+    void recheck_sounds(const std::string & event_name);
     void Terminate ();
 
     PSyncPoint run_thread;
@@ -91,12 +121,28 @@ namespace Ekiga
     PMutex thread_ended;
     PSyncPoint thread_created;
 
+    /* The events are indexed by handle, and their deadlines are kept in a
+     * min-heap of (deadline, handle). Cancelling an event only removes it
+     * from the index : its stale heap entry is skipped when it surfaces.
+     */
+    typedef std::pair<gint64, unsigned> EventDeadline;
     PMutex event_list_mutex;
-    std::vector <AudioEvent> event_list;
+    std::map<unsigned, AudioEvent> event_list;
+    std::vector<EventDeadline> event_heap;
+    unsigned next_handle;
 
     PMutex event_file_list_mutex;
     std::vector <EventFileName> event_file_list;
 
+    /* Decoded sounds, keyed by event name (empty for plain files)
+     * and file name ; the least recently used ones are dropped when
+     * there are too many, and they are reloaded if the file changes */
+    typedef std::pair<std::string, std::string> SoundKey;
+    PMutex sound_cache_mutex;
+    std::map<SoundKey, boost::shared_ptr<AudioSound> > sound_cache;
+    guint64 sound_uses;
+    std::vector<std::string> preload_list;
+
     Ekiga::AudioOutputCore& audio_output_core;
   };
 };
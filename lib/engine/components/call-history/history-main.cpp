@@ -44,6 +44,11 @@ struct HISTORYSpark: public Ekiga::Spark
   HISTORYSpark (): result(false)
   {}
 
+  /* loading the history fills a book, whose light signals must only be
+   * used from the main thread, and connects it to the call core : this
+   * isn't done on a worker thread ; the source is given to the contact
+   * core in finish_initialization
+   */
   bool try_initialize_more (Ekiga::ServiceCore& core,
 			    int* /*argc*/,
 			    char** /*argv*/[])
@@ -51,12 +56,12 @@ struct HISTORYSpark: public Ekiga::Spark
     boost::shared_ptr<Ekiga::ContactCore> contact_core = core.get<Ekiga::ContactCore> ("contact-core");
     boost::shared_ptr<Ekiga::CallCore> call_core = core.get<Ekiga::CallCore> ("call-core");
 
-    if (contact_core && call_core) {
+    if (contact_core && call_core && !result) {
 
-      boost::shared_ptr<History::Source> source = History::Source::create (core);
-      if (core.add (source)) {
+      boost::shared_ptr<History::Source> new_source = History::Source::create (core);
+      if (core.add (new_source)) {
 
-	contact_core->add_source (source);
+	source = new_source;
 	result = true;
       }
     }
@@ -64,13 +69,34 @@ struct HISTORYSpark: public Ekiga::Spark
     return result;
   }
 
+  void finish_initialization (Ekiga::ServiceCore& core)
+  {
+    boost::shared_ptr<Ekiga::ContactCore> contact_core = core.get<Ekiga::ContactCore> ("contact-core");
+
+    if (contact_core && source) {
+
+      contact_core->add_source (source);
+      source.reset ();
+    }
+  }
+
   Ekiga::Spark::state get_state () const
   { return result?FULL:BLANK; }
 
   const std::string get_name () const
   { return "HISTORY"; }
 
+  void get_provides (std::list<std::string>& names) const
+  { names.push_back ("call-history-store"); }
+
+  void get_requires (std::list<std::string>& names) const
+  {
+    names.push_back ("contact-core");
+    names.push_back ("call-core");
+  }
+
   bool result;
+  boost::shared_ptr<History::Source> source; // until it's given to the contact core
 };
 
 void
@@ -123,6 +123,15 @@ struct GNOTIFYSpark: public Ekiga::Spark
   const std::string get_name () const
   { return "GNOTIFY"; }
 
+  void get_provides (std::list<std::string>& names) const
+  { names.push_back ("libnotify"); }
+
+  void get_requires (std::list<std::string>& names) const
+  {
+    names.push_back ("notification-core");
+    names.push_back ("call-core");
+  }
+
   bool result;
 };
 
@@ -71,6 +71,16 @@ struct GUDevSpark: public Ekiga::Spark
   const std::string get_name () const
   { return "GUDEV"; }
 
+  void get_provides (std::list<std::string>& names) const
+  { names.push_back ("gudev"); }
+
+  void get_requires (std::list<std::string>& names) const
+  {
+    names.push_back ("hal-core");
+    names.push_back ("audioinput-core");
+    names.push_back ("audiooutput-core");
+  }
+
   bool result;
 };
 
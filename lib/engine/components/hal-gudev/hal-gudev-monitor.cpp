@@ -113,6 +113,10 @@ GUDevMonitor::device_change (GUdevDevice* device,
     if (!aicore || !aocore)
       return;
 
+    // the managers may cache their devices : make sure we see the change
+    aicore->refresh_devices ();
+    aocore->refresh_devices ();
+
     aicore->get_devices (new_audio_input_devices);
     aocore->get_devices (new_audio_output_devices);
 
@@ -69,6 +69,12 @@ struct NULLAUDIOOUTPUTSpark: public Ekiga::Spark
   const std::string get_name () const
   { return "NULLAUDIOOUTPUT"; }
 
+  void get_provides (std::list<std::string>& names) const
+  { names.push_back ("null-audio-output"); }
+
+  void get_requires (std::list<std::string>& names) const
+  { names.push_back ("audiooutput-core"); }
+
   bool result;
 };
 
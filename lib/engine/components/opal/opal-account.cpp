@@ -54,29 +54,12 @@
 #include "robust-xml.h"
 #include "form-request-simple.h"
 #include "platform.h"
+#include "ekiga-settings.h"
 
 #include "opal-presentity.h"
+#include "opal-uri.h"
 #include "sip-endpoint.h"
 
-// remove leading and trailing spaces and tabs (useful for copy/paste)
-// also, if no protocol specified, add leading "sip:"
-static std::string
-canonize_uri (std::string uri)
-{
-  const size_t begin_str = uri.find_first_not_of (" \t");
-  if (begin_str == std::string::npos)  // there is no content
-    return "";
-
-  const size_t end_str = uri.find_last_not_of (" \t");
-  const size_t range = end_str - begin_str + 1;
-  uri = uri.substr (begin_str, range);
-  const size_t pos = uri.find (":");
-  if (pos == std::string::npos)
-    uri = uri.insert (0, "sip:");
-  return uri;
-}
-
-
 xmlNodePtr
 Opal::Account::build_node(Opal::Account::Type typus,
                           std::string name,
@@ -180,19 +163,22 @@ Opal::Account::Account (Opal::Bank & _bank,
   failed_registration_already_notified = false;
   dead = false;
 
-  decide_type ();
-
-  for (xmlNodePtr child = node->children; child != NULL; child = child->next) {
+  presences_timer = 0;
+  merged_presences = 0;
+  {
+    Ekiga::Settings sip_settings (SIP_SCHEMA);
+    presences_window = sip_settings.get_int ("presence-window");
+  }
 
-    if (child->type == XML_ELEMENT_NODE && child->name != NULL && xmlStrEqual (BAD_CAST "roster", child->name)) {
+  decide_type ();
 
+  roster_node = NULL;
+  for (xmlNodePtr child = node->children; child != NULL; child = child->next)
+    if (child->type == XML_ELEMENT_NODE && child->name != NULL && xmlStrEqual (BAD_CAST "roster", child->name))
       roster_node = child;
-      for (xmlNodePtr presnode = roster_node->children; presnode != NULL; presnode = presnode->next)
-        load_presentity (presence_core, existing_groups, presnode);
-    }
-  }
 
   /* Actor stuff */
+  begin_actions_update ();
 
   /* Translators: Example: Add ekiga.net Contact */
   char *text = g_strdup_printf (_("A_dd %s Contact"), get_host ().c_str ());
@@ -207,14 +193,31 @@ Opal::Account::Account (Opal::Bank & _bank,
                                                    boost::bind (&Opal::Account::enable, this), !is_enabled ())));
   add_action (Ekiga::ActionPtr (new Ekiga::Action ("disable-account", _("_Disable"),
                                                    boost::bind (&Opal::Account::disable, this), is_enabled ())));
+  commit_actions_update ();
 
   if (sip_endpoint)
     instance_id = sip_endpoint->GetInstanceID ().AsString ();
 }
 
 
+void
+Opal::Account::load_roster ()
+{
+  if (roster_node == NULL)
+    return;
+
+  begin_presentities_update (xmlChildElementCount (roster_node));
+  for (xmlNodePtr presnode = roster_node->children; presnode != NULL; presnode = presnode->next)
+    load_presentity (presence_core, existing_groups, presnode);
+  commit_presentities_update ();
+}
+
+
 Opal::Account::~Account ()
 {
+  PWaitAndSignal m(presences_mutex);
+
+  Ekiga::Runtime::cancel_timer (presences_timer);
 }
 
 
@@ -237,6 +240,20 @@ Opal::Account::get_groups () const
 }
 
 
+void
+Opal::Account::sync_roster ()
+{
+  // a dead account's node (with the roster) is about to be freed, or has been
+  if (dead)
+    return;
+
+  for (Ekiga::HeapImpl<Opal::Presentity>::iterator iter = Ekiga::HeapImpl<Opal::Presentity>::begin ();
+       iter != Ekiga::HeapImpl<Opal::Presentity>::end ();
+       ++iter)
+    (*iter)->sync_node ();
+}
+
+
 const std::string
 Opal::Account::get_name () const
 {
@@ -842,13 +859,60 @@ Opal::Account::load_presentity (boost::weak_ptr<Ekiga::PresenceCore> _presence_c
   // When the presentity emits trigger_saving, we relay it "upstream" so that the
   // Bank can save everything.
   presentities.add_connection (pres, pres->trigger_saving.connect (boost::ref (trigger_saving)));
-  presentities.add_connection (pres, pres->removed.connect (boost::bind (&Opal::Account::unfetch, this, pres->get_uri ()), boost::signals2::at_front));  // slot from DynamicObjectStore must be the last called
+  presentities.add_connection (pres, pres->removed.connect (boost::bind (&Opal::Account::on_presentity_removed, this, _1), boost::signals2::at_front));  // slot from DynamicObjectStore must be the last called
   add_presentity (pres);
 
+  presentities_by_uri.insert (std::make_pair (canonize_uri (pres->get_uri ()),
+                                              presentities.get_handle (pres)));
+
   return pres;
 }
 
 
+void
+Opal::Account::on_presentity_removed (boost::shared_ptr<Presentity> pres)
+{
+  const std::string uri = pres->get_uri ();
+
+  unindex_presentity (uri, presentities.get_handle (pres));
+  unfetch (uri);
+}
+
+
+void
+Opal::Account::unindex_presentity (const std::string uri,
+                                   Ekiga::FlatObjectStore<Presentity>::handle_type handle)
+{
+  std::pair<presentities_by_uri_type::iterator, presentities_by_uri_type::iterator> range =
+    presentities_by_uri.equal_range (canonize_uri (uri));
+
+  for (presentities_by_uri_type::iterator iter = range.first;
+       iter != range.second;
+       ++iter) {
+
+    if (iter->second == handle) {
+
+      presentities_by_uri.erase (iter);
+      break;
+    }
+  }
+}
+
+
+void
+Opal::Account::on_presentity_uri_changed (boost::shared_ptr<Presentity> pres,
+                                          const std::string old_uri)
+{
+  const Ekiga::FlatObjectStore<Presentity>::handle_type handle = presentities.get_handle (pres);
+
+  if (handle == 0)
+    return;
+
+  unindex_presentity (old_uri, handle);
+  presentities_by_uri.insert (std::make_pair (canonize_uri (pres->get_uri ()), handle));
+}
+
+
 void
 Opal::Account::fetch (const std::string uri)
 {
@@ -873,7 +937,7 @@ Opal::Account::unfetch (const std::string uri)
 {
   if (is_supported_uri (uri) && opal_presentity) {
     opal_presentity->UnsubscribeFromPresence (get_full_uri (uri));
-    Ekiga::Runtime::run_in_main (boost::bind (&Opal::Account::presence_status_in_main, this, uri, "unknown", ""));
+    queue_presence (uri, "unknown", "");
   }
 }
 
@@ -1185,7 +1249,63 @@ Opal::Account::OnPresenceChange (OpalPresentity& /*presentity*/,
     break;
   }
 
-  Ekiga::Runtime::run_in_main (boost::bind (&Opal::Account::presence_status_in_main, this, uri, new_presence, new_status));
+  queue_presence (uri, new_presence, new_status);
+}
+
+
+void
+Opal::Account::queue_presence (const std::string uri,
+                               const std::string presence,
+                               const std::string status)
+{
+  PWaitAndSignal m(presences_mutex);
+
+  std::pair<pending_presences_type::iterator, bool> result =
+    pending_presences.insert (std::make_pair (uri, std::make_pair (presence, status)));
+
+  if (!result.second) {
+
+    result.first->second = std::make_pair (presence, status);
+    merged_presences++;
+  }
+
+  if (presences_timer == 0)
+    presences_timer = Ekiga::Runtime::add_timer (boost::bind (&Opal::Account::flush_presences, this),
+                                                 presences_window, presences_window / 2);
+}
+
+
+void
+Opal::Account::flush_presences ()
+{
+  pending_presences_type presences;
+  unsigned int merged;
+
+  {
+    PWaitAndSignal m(presences_mutex);
+
+    presences.swap (pending_presences);
+    merged = merged_presences;
+    merged_presences = 0;
+    presences_timer = 0;
+  }
+
+  PTRACE (4, "Ekiga\tDelivering " << presences.size () << " presence updates for " << get_aor ()
+          << " (" << merged << " merged)");
+
+  std::list<Ekiga::PresenceUpdate> updates;
+  for (pending_presences_type::const_iterator iter = presences.begin ();
+       iter != presences.end ();
+       ++iter) {
+
+    presence_status_in_main (iter->first, iter->second.first, iter->second.second);
+    updates.push_back (Ekiga::PresenceUpdate ());
+    updates.back ().uri = iter->first;
+    updates.back ().presence = iter->second.first;
+    updates.back ().status = iter->second.second;
+  }
+
+  presences_received (updates, merged);
 }
 
 
@@ -1194,18 +1314,17 @@ Opal::Account::presence_status_in_main (std::string uri,
                                         std::string uri_presence,
                                         std::string uri_status) const
 {
-  for (Ekiga::HeapImpl<Opal::Presentity>::const_iterator iter = Ekiga::HeapImpl<Opal::Presentity>::begin ();
-       iter != Ekiga::HeapImpl<Opal::Presentity>::end ();
-       ++iter) {
+  std::pair<presentities_by_uri_type::const_iterator, presentities_by_uri_type::const_iterator> range =
+    presentities_by_uri.equal_range (canonize_uri (uri));
 
-    if ((*iter)->has_uri (uri)) {
+  for (presentities_by_uri_type::const_iterator iter = range.first;
+       iter != range.second;
+       ++iter) {
 
-      (*iter)->set_presence (uri_presence);
-      (*iter)->set_status (uri_status);
-    }
+    Opal::PresentityPtr pres = presentities.get_object (iter->second);
+    if (pres)
+      pres->set_presence_status (uri_presence, uri_status);
   }
-  presence_received (uri, uri_presence);
-  status_received (uri, uri_status);
 }
 
 
@@ -39,6 +39,7 @@
 #define __OPAL_ACCOUNT_H__
 
 #include <libxml/tree.h>
+#include <boost/unordered_map.hpp>
 #include <opal/pres_ent.h>
 #include <sip/sippdu.h>
 
@@ -116,6 +117,12 @@ public:
 
     ~Account ();
 
+    /* Loads the presentities of the roster, all in one presentities_changed :
+     * the Bank calls it once the account is in its heaps, so what heap_added
+     * connected gets them.
+     */
+    void load_roster ();
+
     const std::string get_name () const;
 
     const std::string get_status () const;
@@ -184,6 +191,10 @@ public:
 
     boost::signals2::signal<void(void)> trigger_saving;
 
+    /* Writes the pending changes of the presentities into the roster node,
+     * for the bank to save the document */
+    void sync_roster ();
+
     /*
      * This is because an opal account is an Ekiga::PresencePublisher
      */
@@ -226,6 +237,13 @@ private:
     void unfetch (const std::string uri);
     bool is_supported_uri (const std::string & uri);
 
+    /* Those keep presentities_by_uri up to date */
+    void on_presentity_removed (boost::shared_ptr<Presentity> pres);
+    void on_presentity_uri_changed (boost::shared_ptr<Presentity> pres,
+                                    const std::string old_uri);
+    void unindex_presentity (const std::string uri,
+                             Ekiga::FlatObjectStore<Presentity>::handle_type handle);
+
     void decide_type ();
 
     void add_contact ();
@@ -260,10 +278,35 @@ private:
     boost::function0<std::list<std::string> > existing_groups;
     xmlNodePtr node;
     xmlNodePtr roster_node;
+
+    /* The presentities' handles in the heap, by canonized uri, for the
+     * presence notifications not to look at the whole roster */
+    typedef boost::unordered_multimap<std::string, Ekiga::FlatObjectStore<Presentity>::handle_type> presentities_by_uri_type;
+    presentities_by_uri_type presentities_by_uri;
+
     void presence_status_in_main (std::string uri,
                                   std::string presence,
                                   std::string status) const;
 
+    /* Presence notifications are coalesced : for each uri, only the latest
+     * one received in presences_window milliseconds (the presence-window
+     * setting) is kept, and they all go to the main thread together, where
+     * they are given to the presentities, then to the PresenceCore in one
+     * presences_received.
+     * queue_presence can be called from any thread.
+     */
+    void queue_presence (const std::string uri,
+                         const std::string presence,
+                         const std::string status);
+    void flush_presences ();
+
+    typedef boost::unordered_map<std::string, std::pair<std::string, std::string> > pending_presences_type;
+    PMutex presences_mutex;
+    pending_presences_type pending_presences;
+    unsigned int presences_timer;
+    unsigned int presences_window;
+    unsigned int merged_presences;
+
     Bank & bank;
 
     boost::weak_ptr<Ekiga::PresenceCore> presence_core;
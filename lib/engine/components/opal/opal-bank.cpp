@@ -57,8 +57,6 @@ Opal::Bank::create (Ekiga::ServiceCore& core,
                                                    _endpoint,
                                                    _sip_endpoint));
 
-  bank->load ();
-
   return bank;
 }
 
@@ -70,6 +68,7 @@ Opal::Bank::Bank (Ekiga::ServiceCore& core,
   notification_core(core.get<Ekiga::NotificationCore> ("notification-core")),
   personal_details(core.get<Ekiga::PersonalDetails> ("personal-details")),
   audiooutput_core(core.get<Ekiga::AudioOutputCore> ("audiooutput-core")),
+  protocols_settings(NULL),
   endpoint (_endpoint),
   sip_endpoint(_sip_endpoint)
 {
@@ -104,6 +103,7 @@ Opal::Bank::load_account (boost::function0<std::list<std::string> > _existing_gr
 
   add_account (account);
   add_heap (account);
+  account->load_roster ();
 
   activate (account);
 
@@ -133,6 +133,7 @@ Opal::Bank::load ()
     xmlDocSetRootElement (doc.get (), node);
   }
 
+  begin_accounts_update ();
   for (xmlNodePtr child = node->children; child != NULL; child = child->next) {
 
     if (child->type == XML_ELEMENT_NODE
@@ -140,6 +141,7 @@ Opal::Bank::load ()
         && xmlStrEqual(BAD_CAST "account", child->name))
       load_account (boost::bind(&Opal::Bank::existing_groups, this), child);
   }
+  commit_accounts_update ();
 }
 
 
@@ -274,6 +276,11 @@ Opal::Bank::save () const
   xmlChar *buffer = NULL;
   int doc_size = 0;
 
+  for (Ekiga::BankImpl<Opal::Account>::const_iterator iter = Ekiga::BankImpl<Opal::Account>::begin ();
+       iter != Ekiga::BankImpl<Opal::Account>::end ();
+       ++iter)
+    (*iter)->sync_roster ();
+
   xmlDocDumpMemory (doc.get (), &buffer, &doc_size);
 
   protocols_settings->set_string ("accounts", (const char*)buffer);
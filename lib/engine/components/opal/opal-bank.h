@@ -89,6 +89,12 @@ public:
                                            Opal::EndPoint& _endpoint,
                                            Opal::Sip::EndPoint* _sip_endpoint);
 
+    /* Loads the accounts, all in one accounts_changed : call it once the
+     * bank has been added to the account and presence cores, so what they
+     * connected gets them.
+     */
+    void load ();
+
     ~Bank ();
 
     const std::string get_name () const
@@ -132,7 +138,6 @@ private:
     boost::shared_ptr<Account> load_account (boost::function0<std::list<std::string> > _existing_groups,
                                              xmlNodePtr _node);
 
-    void load ();
     void set_ready ();
     bool is_ready;
 
@@ -76,19 +76,31 @@ Opal::Call::create (EndPoint& _manager,
                     const std::string & uri,
                     const unsigned no_answer_delay)
 {
-  return boost::shared_ptr<Opal::Call> (new Opal::Call (_manager, uri, no_answer_delay));
+  boost::shared_ptr<Opal::Call> call (new Opal::Call (_manager, uri, no_answer_delay));
+
+  if (no_answer_delay > 0 && !call->is_outgoing () && !call->IsEstablished ()) {
+
+    void (*timeout) (boost::weak_ptr<Opal::Call>) = &Opal::Call::OnNoAnswerTimeout;
+    call->noAnswerTimer = Ekiga::Runtime::add_timer (boost::bind (timeout, boost::weak_ptr<Opal::Call> (call)),
+                                                     no_answer_delay * 1000, 500);
+  }
+
+  return call;
 }
 
 
 Opal::Call::Call (Opal::EndPoint& _manager,
                   const std::string& _uri,
-                  const unsigned _no_answer_delay)
+                  const unsigned /*no_answer_delay*/)
   : OpalCall (_manager),
     Ekiga::Call (),
     remote_uri (_uri),
     call_setup (false),
-    outgoing (false)
+    outgoing (false),
+    noAnswerTimer (0)
 {
+  ActionsUpdate update (*this);
+
   add_action (Ekiga::ActionPtr (new Ekiga::Action ("hangup", _("Hangup"),
                                                    boost::bind (&Call::hang_up, this))));
   if (!is_outgoing () && !IsEstablished ()) {
@@ -96,16 +108,13 @@ Opal::Call::Call (Opal::EndPoint& _manager,
                                                      boost::bind (&Call::answer, this))));
     add_action (Ekiga::ActionPtr (new Ekiga::Action ("reject", _("Reject"),
                                                      boost::bind (&Call::hang_up, this))));
-
-    noAnswerTimer.SetNotifier (PCREATE_NOTIFIER (OnNoAnswerTimeout));
-    if (_no_answer_delay > 0)
-      noAnswerTimer.SetInterval (0, _no_answer_delay);
   }
 }
 
 
 Opal::Call::~Call ()
 {
+  Ekiga::Runtime::cancel_timer (noAnswerTimer);
 }
 
 
@@ -126,8 +135,10 @@ Opal::Call::answer ()
     PSafePtr<OpalPCSSConnection> connection = GetConnectionAs<OpalPCSSConnection>();
     if (connection != NULL) {
       connection->AcceptIncoming ();
+      begin_actions_update ();
       remove_action ("reject");
       remove_action ("answer");
+      commit_actions_update ();
     }
   }
 }
@@ -433,16 +444,18 @@ Opal::Call::OnEstablished (OpalConnection & connection)
 {
   OpalMediaStreamPtr stream;
 
-  noAnswerTimer.Stop (false);
+  Ekiga::Runtime::cancel_timer (noAnswerTimer);
 
   if (!PIsDescendant(&connection, OpalPCSSConnection)) {
 
+    begin_actions_update ();
     add_action (Ekiga::ActionPtr (new Ekiga::Action ("hold", _("Hold"),
                                                      boost::bind (&Call::toggle_hold, this))));
     add_action (Ekiga::ActionPtr (new Ekiga::Action ("transfer", _("Transfer"),
                                                      boost::bind (&Call::transfer, this))));
     remove_action ("answer");
     remove_action ("reject");
+    commit_actions_update ();
 
     parse_info (connection);
     Ekiga::Runtime::run_in_main (boost::bind (boost::ref (established), this->shared_from_this ()));
@@ -466,7 +479,7 @@ Opal::Call::OnCleared ()
 {
   std::string reason;
 
-  noAnswerTimer.Stop (false);
+  Ekiga::Runtime::cancel_timer (noAnswerTimer);
 
   OpalCall::OnCleared ();
 
@@ -639,8 +652,17 @@ Opal::Call::DoSetUp (OpalConnection & connection)
 
 
 void
-Opal::Call::OnNoAnswerTimeout (PTimer &,
-                               INT)
+Opal::Call::OnNoAnswerTimeout (boost::weak_ptr<Call> call)
+{
+  boost::shared_ptr<Call> self = call.lock ();
+
+  if (self)
+    self->OnNoAnswerTimeout ();
+}
+
+
+void
+Opal::Call::OnNoAnswerTimeout ()
 {
   if (!forward_uri.empty ()) {
 
@@ -249,8 +249,11 @@ private:
 
     bool auto_answer;
 
-    PDECLARE_NOTIFIER(PTimer, Opal::Call, OnNoAnswerTimeout);
-    PTimer noAnswerTimer;
+    /* the timer only holds a weak_ptr : the call may be destroyed in an
+     * OPAL thread while the timer action is about to run in the main one */
+    static void OnNoAnswerTimeout (boost::weak_ptr<Call> call);
+    void OnNoAnswerTimeout ();
+    unsigned int noAnswerTimer;
   };
 };
 
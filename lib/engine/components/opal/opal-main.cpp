@@ -96,6 +96,7 @@ public:
                                                          &sip_endpoint);
       account_core->add_bank (bank);
       presence_core->add_cluster (bank);
+      bank->load ();
       core.add (bank);
       presence_core->add_presence_publisher (bank);
 
@@ -111,6 +112,20 @@ public:
   const std::string get_name () const
   { return "OPAL"; }
 
+  void get_provides (std::list<std::string>& names) const
+  { names.push_back ("opal-account-store"); }
+
+  void get_requires (std::list<std::string>& names) const
+  {
+    names.push_back ("contact-core");
+    names.push_back ("presence-core");
+    names.push_back ("call-core");
+    names.push_back ("account-core");
+    names.push_back ("audioinput-core");
+    names.push_back ("audiooutput-core");
+    names.push_back ("personal-details");
+  }
+
   bool result;
   bool bank_created;
 };
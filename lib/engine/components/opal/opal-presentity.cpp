@@ -41,25 +41,7 @@
 
 #include "opal-presentity.h"
 #include "opal-account.h"
-
-
-// remove leading and trailing spaces and tabs (useful for copy/paste)
-// also, if no protocol specified, add leading "sip:"
-static std::string
-canonize_uri (std::string uri)
-{
-  const size_t begin_str = uri.find_first_not_of (" \t");
-  if (begin_str == std::string::npos)  // there is no content
-    return "";
-
-  const size_t end_str = uri.find_last_not_of (" \t");
-  const size_t range = end_str - begin_str + 1;
-  uri = uri.substr (begin_str, range);
-  const size_t pos = uri.find (":");
-  if (pos == std::string::npos)
-    uri = uri.insert (0, "sip:");
-  return uri;
-}
+#include "opal-uri.h"
 
 
 /* we call the presence core for help, which needs a smart pointer
@@ -121,8 +103,10 @@ Opal::Presentity::Presentity (Opal::Account & account_,
   presence_core(presence_core_),
   existing_groups(existing_groups_),
   node(node_),
+  dirty(false),
   presence("unknown")
 {
+  parse_node ();
 }
 
 
@@ -132,28 +116,16 @@ Opal::Presentity::~Presentity ()
 
 
 void
-Opal::Presentity::add_actions ()
+Opal::Presentity::parse_node ()
 {
-  /* Pull actions */
-  boost::shared_ptr<Ekiga::PresenceCore> pcore = presence_core.lock ();
-  if (pcore)
-    pcore->pull_actions (*this, get_name (), get_uri ());
-
-  add_action (Ekiga::ActionPtr (new Ekiga::Action ("edit", _("_Edit"),
-                                                   boost::bind (&Opal::Presentity::edit_presentity, this))));
-  add_action (Ekiga::ActionPtr (new Ekiga::Action ("remove", _("_Remove"),
-                                                   boost::bind (&Opal::Presentity::remove, this))));
-  add_action (Ekiga::ActionPtr (new Ekiga::Action ("rename", _("Rename _Groups"),
-                                                   boost::bind (&Opal::Account::on_rename_group,
-                                                                (Opal::Account *) &account, get_groups ()))));
-}
+  xmlChar* xml_str = NULL;
 
+  xml_str = xmlGetProp (node, BAD_CAST "uri");
+  if (xml_str != NULL) {
 
-const std::string
-Opal::Presentity::get_name () const
-{
-  std::string name;
-  xmlChar* xml_str = NULL;
+    uri = (const char*)xml_str;
+    xmlFree (xml_str);
+  }
 
   for (xmlNodePtr child = node->children ;
        child != NULL ;
@@ -174,9 +146,89 @@ Opal::Presentity::get_name () const
           name = _("Unnamed");
         }
       }
+
+      if (xmlStrEqual (BAD_CAST ("group"), child->name)) {
+
+        xml_str = xmlNodeGetContent (child);
+        if (xml_str != NULL) {
+
+          groups.push_back ((const char*) xml_str);
+          xmlFree (xml_str);
+        }
+      }
     }
   }
+}
 
+
+void
+Opal::Presentity::sync_node ()
+{
+  if (!dirty || node == NULL)
+    return;
+
+  std::set<xmlNodePtr> nodes_to_remove;
+
+  xmlSetProp (node, BAD_CAST "uri", BAD_CAST uri.c_str ());
+
+  for (xmlNodePtr child = node->children ;
+       child != NULL ;
+       child = child->next) {
+
+    if (child->type == XML_ELEMENT_NODE
+        && child->name != NULL
+        && (xmlStrEqual (BAD_CAST ("name"), child->name)
+            || xmlStrEqual (BAD_CAST ("group"), child->name)))
+      nodes_to_remove.insert (child); // don't free what we loop on!
+  }
+
+  for (std::set<xmlNodePtr>::iterator iter = nodes_to_remove.begin ();
+       iter != nodes_to_remove.end ();
+       ++iter) {
+
+    xmlUnlinkNode (*iter);
+    xmlFreeNode (*iter);
+  }
+
+  xmlNewChild (node, NULL,
+               BAD_CAST "name",
+               BAD_CAST robust_xmlEscape (node->doc,
+                                          name).c_str ());
+  for (std::list<std::string>::const_iterator iter = groups.begin ();
+       iter != groups.end ();
+       ++iter)
+    xmlNewChild (node, NULL,
+                 BAD_CAST "group",
+                 BAD_CAST robust_xmlEscape (node->doc,
+                                            *iter).c_str ());
+
+  dirty = false;
+}
+
+
+void
+Opal::Presentity::add_actions ()
+{
+  ActionsUpdate update (*this);
+
+  /* Pull actions */
+  boost::shared_ptr<Ekiga::PresenceCore> pcore = presence_core.lock ();
+  if (pcore)
+    pcore->pull_actions (*this, get_name (), get_uri ());
+
+  add_action (Ekiga::ActionPtr (new Ekiga::Action ("edit", _("_Edit"),
+                                                   boost::bind (&Opal::Presentity::edit_presentity, this))));
+  add_action (Ekiga::ActionPtr (new Ekiga::Action ("remove", _("_Remove"),
+                                                   boost::bind (&Opal::Presentity::remove, this))));
+  add_action (Ekiga::ActionPtr (new Ekiga::Action ("rename", _("Rename _Groups"),
+                                                   boost::bind (&Opal::Account::on_rename_group,
+                                                                (Opal::Account *) &account, get_groups ()))));
+}
+
+
+const std::string
+Opal::Presentity::get_name () const
+{
   return name;
 }
 
@@ -198,27 +250,6 @@ Opal::Presentity::get_status () const
 const std::list<std::string>
 Opal::Presentity::get_groups () const
 {
-  std::list<std::string> groups;
-
-  for (xmlNodePtr child = node->children ;
-       child != NULL ;
-       child = child->next) {
-
-    if (child->type == XML_ELEMENT_NODE
-        && child->name != NULL) {
-
-      if (xmlStrEqual (BAD_CAST ("group"), child->name)) {
-
-        xmlChar* xml_str = xmlNodeGetContent (child);
-        if (xml_str != NULL) {
-
-          groups.push_back ((const char*) xml_str);
-          xmlFree (xml_str);
-        }
-      }
-    }
-  }
-
   return groups;
 }
 
@@ -226,16 +257,6 @@ Opal::Presentity::get_groups () const
 const std::string
 Opal::Presentity::get_uri () const
 {
-  std::string uri;
-  xmlChar* xml_str = NULL;
-
-  xml_str = xmlGetProp (node, BAD_CAST "uri");
-  if (xml_str != NULL) {
-
-    uri = (const char*)xml_str;
-    xmlFree (xml_str);
-  }
-
   return uri;
 }
 
@@ -243,7 +264,7 @@ Opal::Presentity::get_uri () const
 bool
 Opal::Presentity::has_uri (const std::string uri) const
 {
-  return uri == get_uri ();
+  return uri == this->uri;
 }
 
 
@@ -263,6 +284,19 @@ Opal::Presentity::set_status (const std::string status_)
 }
 
 
+void
+Opal::Presentity::set_presence_status (const std::string presence_,
+                                       const std::string status_)
+{
+  if (presence == presence_ && status == status_)
+    return;
+
+  presence = presence_;
+  status = status_;
+  updated (this->shared_from_this ());
+}
+
+
 void
 Opal::Presentity::edit_presentity ()
 {
@@ -304,11 +338,9 @@ Opal::Presentity::edit_presentity_form_submitted (bool submitted,
     return false;
 
   const std::string new_name = result.text ("name");
-  const std::list<std::string> groups = get_groups ();
   const std::list<std::string> new_groups = result.editable_list ("groups");
   std::string new_uri = result.text ("uri");
-  const std::string uri = get_uri ();
-  std::set<xmlNodePtr> nodes_to_remove;
+  const std::string old_uri = uri;
 
   if (new_name.empty ()) {
     error = _("You did not provide a valid name");
@@ -321,63 +353,31 @@ Opal::Presentity::edit_presentity_form_submitted (bool submitted,
 
   new_uri = canonize_uri (new_uri);
 
-  for (xmlNodePtr child = node->children ;
-       child != NULL ;
-       child = child->next) {
-
-    if (child->type == XML_ELEMENT_NODE
-        && child->name != NULL)
-      if (xmlStrEqual (BAD_CAST ("name"), child->name))
-        robust_xmlNodeSetContent (node, &child, "name", new_name);
-  }
+  name = new_name;
 
-  if (uri != new_uri) {
-    xmlSetProp (node, (const xmlChar*)"uri", (const xmlChar*)new_uri.c_str ());
-    account.unfetch (uri);
+  if (old_uri != new_uri) {
+    uri = new_uri;
+    account.on_presentity_uri_changed (this->shared_from_this (), old_uri);
+    account.unfetch (old_uri);
     account.fetch (new_uri);
-    Ekiga::Runtime::run_in_main (boost::bind (&Opal::Account::presence_status_in_main, &account, new_uri, "unknown", ""));
-  }
-
-  // the first loop looks at groups we were in: are we still in?
-  for (xmlNodePtr child = node->children ;
-       child != NULL ;
-       child = child->next) {
-
-    if (child->type == XML_ELEMENT_NODE
-        && child->name != NULL) {
-
-      if (xmlStrEqual (BAD_CAST ("group"), child->name)) {
-
-        xmlChar* xml_str = xmlNodeGetContent (child);
-
-        if (xml_str != NULL) {
-          if (std::find (new_groups.begin (), new_groups.end (), (const char*) xml_str) == new_groups.end ())
-            nodes_to_remove.insert (child); // don't free what we loop on!
-          xmlFree (xml_str);
-        }
-      }
-    }
+    account.queue_presence (new_uri, "unknown", "");
   }
 
-  // ok, now we can clean up!
-  for (std::set<xmlNodePtr>::iterator iter = nodes_to_remove.begin ();
-       iter != nodes_to_remove.end ();
-       ++iter) {
-
-    xmlUnlinkNode (*iter);
-    xmlFreeNode (*iter);
-  }
-
-  // the second loop looks for groups we weren't in but are now
+  // keep the groups we are still in, in their order, then the new ones
+  std::list<std::string> kept_groups;
+  for (std::list<std::string>::const_iterator iter = groups.begin ();
+       iter != groups.end ();
+       ++iter)
+    if (std::find (new_groups.begin (), new_groups.end (), *iter) != new_groups.end ())
+      kept_groups.push_back (*iter);
   for (std::list<std::string>::const_iterator iter = new_groups.begin ();
        iter != new_groups.end ();
-       iter++) {
-
+       ++iter)
     if (std::find (groups.begin (), groups.end (), *iter) == groups.end ())
-      xmlNewChild (node, NULL,
-                   BAD_CAST "group",
-                   BAD_CAST robust_xmlEscape (node->doc, *iter).c_str ());
-  }
+      kept_groups.push_back (*iter);
+  groups.swap (kept_groups);
+
+  dirty = true;
 
   updated (this->shared_from_this ());
   trigger_saving ();
@@ -392,53 +392,32 @@ Opal::Presentity::rename_group (const std::string old_name,
 {
   bool old_name_present = false;
   bool already_in_new_name = false;
-  std::set<xmlNodePtr> nodes_to_remove;
+  std::list<std::string> kept_groups;
 
-  /* remove the old name's node
+  /* remove the old name's group
    * and check if we aren't already in the new name's group
    */
-  for (xmlNodePtr child = node->children ;
-       child != NULL ;
-       child = child->next) {
-
-    if (child->type == XML_ELEMENT_NODE
-        && child->name != NULL) {
-
-      if (xmlStrEqual (BAD_CAST ("group"), child->name)) {
-
-        xmlChar* xml_str = xmlNodeGetContent (child);
-
-        if (xml_str != NULL) {
-
-          if (!xmlStrcasecmp ((const xmlChar*)old_name.c_str (), xml_str)) {
-            nodes_to_remove.insert (child); // don't free what we loop on!
-            old_name_present = true;
-          }
-
-          if (!xmlStrcasecmp ((const xmlChar*)new_name.c_str (), xml_str))
-            already_in_new_name = true;
-
-          xmlFree (xml_str);
-        }
-      }
-    }
-  }
-
-  // ok, now we can clean up!
-  for (std::set<xmlNodePtr>::iterator iter = nodes_to_remove.begin ();
-       iter != nodes_to_remove.end ();
+  for (std::list<std::string>::const_iterator iter = groups.begin ();
+       iter != groups.end ();
        ++iter) {
 
-    xmlUnlinkNode (*iter);
-    xmlFreeNode (*iter);
+    if (!xmlStrcasecmp ((const xmlChar*)old_name.c_str (), (const xmlChar*)iter->c_str ()))
+      old_name_present = true;
+    else
+      kept_groups.push_back (*iter);
+
+    if (!xmlStrcasecmp ((const xmlChar*)new_name.c_str (), (const xmlChar*)iter->c_str ()))
+      already_in_new_name = true;
   }
 
   if (old_name_present && !already_in_new_name)
-    xmlNewChild (node, NULL,
-                 BAD_CAST "group",
-                 BAD_CAST robust_xmlEscape (node->doc,
-                                            new_name).c_str ());
+    kept_groups.push_back (new_name);
+
+  if (old_name_present) {
 
+    groups.swap (kept_groups);
+    dirty = true;
+  }
 
   updated (this->shared_from_this ());
   trigger_saving ();
@@ -450,6 +429,7 @@ Opal::Presentity::remove ()
 {
   xmlUnlinkNode (node);
   xmlFreeNode (node);
+  node = NULL;
 
   trigger_saving ();
   removed (this->shared_from_this ());
@@ -56,6 +56,11 @@ namespace Opal
   /* This class implements and Ekiga::Presentity, stored as a node
    * in an XML document -- the code is relative to that node, so could
    * probably be abstracted, should the need arise!
+   *
+   * The node is only read when the presentity is created : the getters
+   * use the parsed values, and the setters only change those and mark the
+   * presentity dirty. The node gets written back by sync_node, which the
+   * account calls just before the document is saved.
    */
 
   class Presentity:
@@ -99,6 +104,10 @@ namespace Opal
 
     void set_status (const std::string status_);
 
+    /* does both at once, and only emits 'updated' if something changed */
+    void set_presence_status (const std::string presence_,
+                              const std::string status_);
+
     // method to rename a group for this presentity
     void rename_group (const std::string old_name,
                        const std::string new_name);
@@ -119,6 +128,10 @@ namespace Opal
     boost::signals2::signal<void(void)> trigger_saving;
     void remove ();
 
+    /* Writes the changes made to the presentity back into its node
+     * (if there are any) */
+    void sync_node ();
+
   private:
     Presentity (Account & account,
                 boost::weak_ptr<Ekiga::PresenceCore> presence_core_,
@@ -127,6 +140,8 @@ namespace Opal
 
     void add_actions ();
 
+    void parse_node ();
+
     /* this pair of method is to let the user edit the presentity with
      * a nice form
      */
@@ -140,6 +155,12 @@ namespace Opal
     boost::function0<std::list<std::string> > existing_groups;
     xmlNodePtr node;
 
+    /* what the node says, parsed once ; dirty means the node is out of date */
+    std::string name;
+    std::string uri;
+    std::list<std::string> groups;
+    bool dirty;
+
     std::string presence;
     std::string status;
   };
@@ -0,0 +1,63 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         opal-uri.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : helpers for the uris of the opal component
+ *
+ */
+
+
+
+#ifndef __OPAL_URI_H__
+#define __OPAL_URI_H__
+
+#include <string>
+
+namespace Opal
+{
+  // remove leading and trailing spaces and tabs (useful for copy/paste)
+  // also, if no protocol specified, add leading "sip:"
+  inline std::string
+  canonize_uri (std::string uri)
+  {
+    const size_t begin_str = uri.find_first_not_of (" \t");
+    if (begin_str == std::string::npos)  // there is no content
+      return "";
+
+    const size_t end_str = uri.find_last_not_of (" \t");
+    const size_t range = end_str - begin_str + 1;
+    uri = uri.substr (begin_str, range);
+    const size_t pos = uri.find (":");
+    if (pos == std::string::npos)
+      uri = uri.insert (0, "sip:");
+    return uri;
+  }
+};
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         presence-lookup-bench.cpp  -  description
+ *                         -----------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Times delivering presence notifications to a
+ *                          roster, looking the presentities up as
+ *                          Opal::Account does and by going through all
+ *                          of them and their XML nodes as it used to.
+ *
+ */
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <glib.h>
+#include <libxml/tree.h>
+#include <boost/unordered_map.hpp>
+
+#include "dynamic-object.h"
+#include "flat-object-store.h"
+
+#include "opal-uri.h"
+
+#define ROSTER 5000
+#define NOTIFICATIONS 10000
+#define ROUNDS 3
+
+/* there's no main loop here : everything runs in the main thread */
+bool
+Ekiga::Runtime::is_main_thread ()
+{
+  return true;
+}
+
+/* what Opal::Presentity does when it gets a notification */
+class Contact: public Ekiga::DynamicObject<Contact>
+{
+public:
+
+  static boost::shared_ptr<Contact> create (xmlNodePtr roster,
+					    const std::string uri)
+  {
+    boost::shared_ptr<Contact> result (new Contact);
+    result->node = xmlNewChild (roster, NULL, BAD_CAST "entry", NULL);
+    xmlSetProp (result->node, BAD_CAST "uri", BAD_CAST uri.c_str ());
+    result->uri = uri;
+    return result;
+  }
+
+  /* what Opal::Presentity::has_uri did : read the uri from the node */
+  bool has_uri (const std::string uri) const
+  {
+    std::string node_uri;
+    xmlChar* xml_str = xmlGetProp (node, BAD_CAST "uri");
+
+    if (xml_str != NULL) {
+
+      node_uri = (const char*)xml_str;
+      xmlFree (xml_str);
+    }
+
+    return uri == node_uri;
+  }
+
+  void set_presence (const std::string presence_)
+  {
+    presence = presence_;
+    updated (this->shared_from_this ());
+  }
+
+  xmlNodePtr node;
+  std::string uri;
+  std::string presence;
+};
+
+typedef boost::shared_ptr<Contact> ContactPtr;
+typedef Ekiga::FlatObjectStore<Contact> Roster;
+typedef boost::unordered_multimap<std::string, Roster::handle_type> RosterIndex;
+
+static void
+count_update (unsigned int* updates,
+	      ContactPtr /*contact*/)
+{
+  (*updates)++;
+}
+
+static void
+deliver_by_scan (Roster& roster,
+		 const std::string uri,
+		 const std::string presence)
+{
+  for (Roster::iterator iter = roster.begin ();
+       iter != roster.end ();
+       ++iter)
+    if ((*iter)->has_uri (uri))
+      (*iter)->set_presence (presence);
+}
+
+static void
+deliver_by_index (Roster& roster,
+		  const RosterIndex& index,
+		  const std::string uri,
+		  const std::string presence)
+{
+  std::pair<RosterIndex::const_iterator, RosterIndex::const_iterator> range =
+    index.equal_range (Opal::canonize_uri (uri));
+
+  for (RosterIndex::const_iterator iter = range.first;
+       iter != range.second;
+       ++iter) {
+
+    ContactPtr contact = roster.get_object (iter->second);
+    if (contact)
+      contact->set_presence (presence);
+  }
+}
+
+int
+main (int /*argc*/,
+      char** /*argv*/)
+{
+  static const char* presences[] = { "online", "away", "busy", "offline" };
+  Roster roster;
+  RosterIndex index;
+  std::vector<std::string> uris;
+  unsigned int updates = 0;
+  GRand* rand = g_rand_new_with_seed (42);
+  xmlDocPtr doc = xmlNewDoc (BAD_CAST "1.0");
+  xmlNodePtr root = xmlNewDocNode (doc, NULL, BAD_CAST "list", NULL);
+
+  xmlDocSetRootElement (doc, root);
+  roster.object_updated.connect (boost::bind (&count_update, &updates, _1));
+
+  for (unsigned ii = 0; ii < ROSTER; ii++) {
+
+    gchar* uri = g_strdup_printf ("sip:contact%u@example.org", ii);
+    ContactPtr contact = Contact::create (root, uri);
+    roster.add_object (contact);
+    index.insert (std::make_pair (Opal::canonize_uri (contact->uri), roster.get_handle (contact)));
+    g_free (uri);
+  }
+
+  // most notifications are for the roster, some for uris it doesn't have
+  for (unsigned ii = 0; ii < NOTIFICATIONS; ii++) {
+
+    gchar* uri = g_strdup_printf ("sip:contact%u@example.org", g_rand_int_range (rand, 0, ROSTER * 5 / 4));
+    uris.push_back (uri);
+    g_free (uri);
+  }
+  g_rand_free (rand);
+
+  GTimer* timer = g_timer_new ();
+  double scan_time = 0;
+  double index_time = 0;
+  unsigned int scan_updates = 0;
+  unsigned int index_updates = 0;
+
+  for (unsigned round = 0; round < ROUNDS; round++) {
+
+    updates = 0;
+    g_timer_start (timer);
+    for (unsigned ii = 0; ii < uris.size (); ii++)
+      deliver_by_scan (roster, uris[ii], presences[ii % G_N_ELEMENTS (presences)]);
+    scan_time += g_timer_elapsed (timer, NULL);
+    scan_updates = updates;
+
+    updates = 0;
+    g_timer_start (timer);
+    for (unsigned ii = 0; ii < uris.size (); ii++)
+      deliver_by_index (roster, index, uris[ii], presences[ii % G_N_ELEMENTS (presences)]);
+    index_time += g_timer_elapsed (timer, NULL);
+    index_updates = updates;
+  }
+
+  g_timer_destroy (timer);
+  xmlFreeDoc (doc);
+
+  printf ("%u notifications into a %u presentities roster, average of %u rounds\n",
+	  NOTIFICATIONS, ROSTER, ROUNDS);
+  printf ("%-20s %8.3f ms  (%u updates)\n", "scanning the roster", scan_time * 1e3 / ROUNDS, scan_updates);
+  printf ("%-20s %8.3f ms  (%u updates)\n", "uri index", index_time * 1e3 / ROUNDS, index_updates);
+
+  if (scan_updates != index_updates) {
+
+    printf ("THE LOOKUPS DIDN'T FIND THE SAME PRESENTITIES\n");
+    return 1;
+  }
+
+  return 0;
+}
@@ -53,6 +53,9 @@
 
 #include <stdlib.h>
 
+// how long we wait for the STUN detection before going on, in milliseconds
+#define STUN_TIMEOUT 20000
+
 // opal manages its endpoints itself, so we must be wary
 struct null_deleter
 {
@@ -61,49 +64,9 @@ struct null_deleter
 };
 
 
-class StunDetector : public PThread
-{
-  PCLASSINFO(StunDetector, PThread);
-
-public:
-
-  StunDetector (const std::string & _server,
-                Opal::EndPoint& _manager,
-                GAsyncQueue* _queue)
-    : PThread (1000, AutoDeleteThread),
-    server (_server),
-    manager (_manager),
-    queue (_queue)
-  {
-    PTRACE (3, "Ekiga\tStarted STUN detector");
-    g_async_queue_ref (queue);
-    this->Resume ();
-  };
-
-  ~StunDetector ()
-    {
-      g_async_queue_unref (queue);
-      PTRACE (3, "Ekiga\tStopped STUN detector");
-    }
-
-  void Main ()
-    {
-      PSTUNClient::NatTypes result = manager.SetSTUNServer (server);
-      g_async_queue_push (queue, GUINT_TO_POINTER ((guint)result + 1));
-    };
-
-private:
-  const std::string server;
-  Opal::EndPoint & manager;
-  GAsyncQueue* queue;
-};
-
-
 /* The class */
 Opal::EndPoint::EndPoint (Ekiga::ServiceCore& _core) : core(_core)
 {
-  stun_thread = 0;
-
   /* Initialise the endpoint parameters */
 #if P_HAS_IPV6
   char * ekiga_ipv6 = getenv("EKIGA_IPV6");
@@ -123,6 +86,8 @@ Opal::EndPoint::EndPoint (Ekiga::ServiceCore& _core) : core(_core)
   SetAudioJitterDelay (20, 500);
 
   stun_enabled = false;
+  stun_timer = 0;
+  stun_timed_out = false;
   isReady = false;
   autoAnswer = false;
 
@@ -130,9 +95,6 @@ Opal::EndPoint::EndPoint (Ekiga::ServiceCore& _core) : core(_core)
   SetMediaFormatOrder (PStringArray ());
   SetMediaFormatMask (PStringArray ());
 
-  // used to communicate with the StunDetector
-  queue = g_async_queue_new ();
-
   PInterfaceMonitor::GetInstance().SetRefreshInterval (15000);
 
   // Create endpoints
@@ -148,10 +110,14 @@ Opal::EndPoint::EndPoint (Ekiga::ServiceCore& _core) : core(_core)
 
 Opal::EndPoint::~EndPoint ()
 {
-  if (stun_thread)
-    stun_thread->WaitForTermination ();
+  // both would call us back in the main thread
+  if (stun_timer)
+    Ekiga::Runtime::cancel_timer (stun_timer);
+  if (stun_task) {
 
-  g_async_queue_unref (queue);
+    stun_task->cancel ();
+    stun_task->wait ();
+  }
 
   for (PSafePtr<OpalCall> call = activeCalls; call != NULL; ++call)
     DestroyCall (call);
@@ -274,7 +240,7 @@ bool Opal::EndPoint::GetAutoAnswer (void) const
 void Opal::EndPoint::SetStunServer (const std::string & server)
 {
   if (server == (const char*) GetNATServer ("STUN")) {
-    if (!isReady && !stun_thread) {
+    if (!isReady && !stun_task) {
       isReady = true;
       ready ();
     }
@@ -282,12 +248,16 @@ void Opal::EndPoint::SetStunServer (const std::string & server)
     return;
   }
 
-  if (!server.empty () && !stun_thread) {
+  if (!server.empty () && !stun_task) {
 
     // Ready
-    stun_thread = new StunDetector (server, *this, queue);
-    patience = 20;
-    Ekiga::Runtime::run_in_main (boost::bind (&Opal::EndPoint::HandleSTUNResult, this), 1);
+    PTRACE (3, "Ekiga\tStarted STUN detector");
+    stun_task = Ekiga::Runtime::run_in_background (boost::bind (&Opal::EndPoint::DetectSTUN, this, server),
+                                                   boost::bind (&Opal::EndPoint::HandleSTUNResult, this),
+                                                   Ekiga::Runtime::HighPriority);
+    stun_timed_out = false;
+    stun_timer = Ekiga::Runtime::add_timer (boost::bind (&Opal::EndPoint::HandleSTUNTimeout, this),
+                                            STUN_TIMEOUT);
   }
   else {
 
@@ -348,47 +318,57 @@ Opal::EndPoint::DestroyCall (boost::shared_ptr<Ekiga::Call> call)
 
 
 void
-Opal::EndPoint::HandleSTUNResult ()
+Opal::EndPoint::DetectSTUN (const std::string server)
 {
-  gboolean error = false;
-  gboolean got_answer = false;
-
-  if (g_async_queue_length (queue) > 0) {
+  stun_result = SetSTUNServer (server);
+  PTRACE (3, "Ekiga\tStopped STUN detector");
+}
 
-    PSTUNClient::NatTypes result
-      = (PSTUNClient::NatTypes)(GPOINTER_TO_UINT (g_async_queue_pop (queue))-1);
-    got_answer = true;
-    stun_thread = 0;
 
-    if (result == PSTUNClient::SymmetricNat
-        || result == PSTUNClient::BlockedNat
-        || result == PSTUNClient::PartiallyBlocked) {
+void
+Opal::EndPoint::HandleSTUNResult ()
+{
+  stun_task.reset ();
 
-      error = true;
-    }
-    else {
+  if (stun_timed_out) {
 
-      isReady = true;
-      ready ();
-    }
+    // we already went on without it
+    PTRACE (3, "Ekiga\tSTUN detection finished after the timeout");
+    return;
   }
-  else if (patience == 0) {
 
-    error = true;
-  }
+  Ekiga::Runtime::cancel_timer (stun_timer);
+  stun_timer = 0;
 
-  if (error) {
+  if (stun_result == PSTUNClient::SymmetricNat
+      || stun_result == PSTUNClient::BlockedNat
+      || stun_result == PSTUNClient::PartiallyBlocked
+      || stun_result == PSTUNClient::UnknownNat) {
 
     ReportSTUNError (_("Ekiga did not manage to configure your network settings automatically. We suggest"
                        " you disable STUN support and relay on a SIP provider that supports NAT environments.\n\n"));
-    isReady = true;
-    ready ();
   }
-  else if (!got_answer) {
 
-    patience--;
-    Ekiga::Runtime::run_in_main (boost::bind (&Opal::EndPoint::HandleSTUNResult, this), 1);
-  }
+  isReady = true;
+  ready ();
+}
+
+
+void
+Opal::EndPoint::HandleSTUNTimeout ()
+{
+  stun_timer = 0;
+  stun_timed_out = true;
+
+  /* The detection can't be interrupted : it goes on in the background, and
+   * keeps stun_task set so no other one starts until it's over.
+   */
+  PTRACE (3, "Ekiga\tSTUN detection timed out");
+  ReportSTUNError (_("Ekiga did not manage to configure your network settings automatically. We suggest"
+                     " you disable STUN support and relay on a SIP provider that supports NAT environments.\n\n"));
+
+  isReady = true;
+  ready ();
 }
 
 
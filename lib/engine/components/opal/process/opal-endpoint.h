@@ -51,6 +51,7 @@
 #include "contact-core.h"
 
 #include "actor.h"
+#include "runtime.h"
 
 class GMPCSSEndpoint;
 
@@ -104,18 +105,25 @@ private:
 
     void DestroyCall (boost::shared_ptr<Ekiga::Call> call);
 
+    void DetectSTUN (const std::string server);
+
     void HandleSTUNResult ();
 
+    void HandleSTUNTimeout ();
+
     void ReportSTUNError (const std::string error);
 
     OpalConnection::AnswerCallResponse OnAnswerCall (OpalConnection & connection,
                                                      const PString & caller);
 
 
-    /* used to get the STUNDetector results */
-    PThread* stun_thread;
-    GAsyncQueue* queue;
-    unsigned int patience;
+    /* DetectSTUN runs in the background, then HandleSTUNResult gets
+     * its result in the main thread ; if that takes more than
+     * STUN_TIMEOUT milliseconds, HandleSTUNTimeout goes on without it */
+    Ekiga::Runtime::BackgroundTaskPtr stun_task;
+    PSTUNClient::NatTypes stun_result;
+    unsigned int stun_timer;
+    bool stun_timed_out;
 
     std::string stun_server;
     unsigned noAnswerDelay;
@@ -43,53 +43,34 @@ namespace Opal {
 
   namespace Sip {
 
-    class RegistrarHandler : public PThread
+    /* Runs in the background : it may block on the network */
+    static void
+    handle_registration (Opal::Account & account,
+                         Opal::Sip::EndPoint& ep,
+                         bool registering)
     {
-      PCLASSINFO (RegistrarHandler, PThread);
-
-  public:
-
-      RegistrarHandler (Opal::Account & _account,
-                        Opal::Sip::EndPoint& _ep,
-                        bool _registering)
-        : PThread (1000, AutoDeleteThread),
-        account (_account),
-        ep (_ep),
-        registering (_registering)
-      {
-        this->Resume ();
+      if (registering) {
+        PString _aor;
+
+        SIPRegister::Params params;
+        params.m_addressOfRecord = "sip:" + account.get_username () + "@" + account.get_host () + ";transport=tcp";
+        params.m_instanceId = ep.GetInstanceID ();
+        params.m_compatibility = SIPRegister::e_RFC5626;
+        params.m_authID = account.get_authentication_username ();
+        params.m_password = account.get_password ();
+        params.m_expire = account.is_enabled () ? account.get_timeout () : 0;
+        params.m_minRetryTime = PMaxTimeInterval;  // use default value
+        params.m_maxRetryTime = PMaxTimeInterval;  // use default value
+
+        if (!account.get_outbound_proxy ().empty ())
+          params.m_addressOfRecord = params.m_addressOfRecord + ";OPAL-proxy=" + account.get_outbound_proxy () + "%3Btransport=tcp";
+
+        // Register the given aor to the given registrar
+        ep.Register (params, _aor);
       }
-
-      void Main ()
-      {
-        if (registering) {
-          PString _aor;
-
-          SIPRegister::Params params;
-          params.m_addressOfRecord = "sip:" + account.get_username () + "@" + account.get_host () + ";transport=tcp";
-          params.m_instanceId = ep.GetInstanceID ();
-          params.m_compatibility = SIPRegister::e_RFC5626;
-          params.m_authID = account.get_authentication_username ();
-          params.m_password = account.get_password ();
-          params.m_expire = account.is_enabled () ? account.get_timeout () : 0;
-          params.m_minRetryTime = PMaxTimeInterval;  // use default value
-          params.m_maxRetryTime = PMaxTimeInterval;  // use default value
-
-          if (!account.get_outbound_proxy ().empty ())
-            params.m_addressOfRecord = params.m_addressOfRecord + ";OPAL-proxy=" + account.get_outbound_proxy () + "%3Btransport=tcp";
-
-          // Register the given aor to the given registrar
-          ep.Register (params, _aor);
-        }
-        else
-          ep.Unregister (account.get_full_uri (""));
-      }
-
-  private:
-      Opal::Account & account;
-      Opal::Sip::EndPoint& ep;
-      bool registering;
-    };
+      else
+        ep.Unregister (account.get_full_uri (""));
+    }
   };
 };
 
@@ -97,7 +78,8 @@ namespace Opal {
 /* The class */
 Opal::Sip::EndPoint::EndPoint (Opal::EndPoint & _endpoint,
                                const Ekiga::ServiceCore& _core): SIPEndPoint (_endpoint),
-                                                                 core (_core)
+                                                                 core (_core),
+                                                                 account_store (_core, "opal-account-store")
 {
   /* Timeouts */
   SetRetryTimeouts (500, 4000);
@@ -127,7 +109,7 @@ bool
 Opal::Sip::EndPoint::SetUpCall (const std::string & uri)
 {
   PString token;
-  boost::shared_ptr<Opal::Bank> bank = core.get<Opal::Bank> ("opal-account-store");
+  boost::shared_ptr<Opal::Bank> bank = account_store.get ();
   if (bank) {
     Opal::AccountPtr account = bank->find_account (SIPURL (uri).GetHostPort ());
     if (account)
@@ -181,14 +163,14 @@ Opal::Sip::EndPoint::StartListener (unsigned port)
 void
 Opal::Sip::EndPoint::EnableAccount (Account & account)
 {
-  new RegistrarHandler (account, *this, true);
+  Ekiga::Runtime::run_in_background (boost::bind (&handle_registration, boost::ref (account), boost::ref (*this), true));
 }
 
 
 void
 Opal::Sip::EndPoint::DisableAccount (Account & account)
 {
-  new RegistrarHandler (account, *this, false);
+  Ekiga::Runtime::run_in_background (boost::bind (&handle_registration, boost::ref (account), boost::ref (*this), false));
 }
 
 
@@ -233,7 +215,7 @@ Opal::Sip::EndPoint::OnRegistrationStatus (const RegistrationStatus & status)
 {
   std::string info;
 
-  boost::shared_ptr<Opal::Bank> bank = core.get<Opal::Bank> ("opal-account-store");
+  boost::shared_ptr<Opal::Bank> bank = account_store.get ();
   if (!bank)
     return;
 
@@ -260,7 +242,8 @@ Opal::Sip::EndPoint::OnRegistrationStatus (const RegistrationStatus & status)
     Ekiga::Runtime::run_in_main (boost::bind (&Opal::Account::handle_registration_event, account,
                                               status.m_wasRegistering?Account::Registered:Account::Unregistered,
                                               std::string (),
-                                              status.m_addressofRecord));
+                                              status.m_addressofRecord),
+                                 0, "sip-registration");
   }
   /* Registration or unregistration failure */
   else {
@@ -530,7 +513,8 @@ Opal::Sip::EndPoint::OnRegistrationStatus (const RegistrationStatus & status)
     if (status.m_reason != SIP_PDU::Failure_RequestTerminated) {
       Ekiga::Runtime::run_in_main (boost::bind (&Opal::Account::handle_registration_event, account,
                                                 status.m_wasRegistering?Account::RegistrationFailed:Account::UnregistrationFailed,
-                                                info, std::string ()));
+                                                info, std::string ()),
+                                   0, "sip-registration");
     }
   }
 }
@@ -547,7 +531,7 @@ Opal::Sip::EndPoint::OnMWIReceived (const PString & party,
     mwi = "0/0";
 
   /* Signal */
-  Ekiga::Runtime::run_in_main (boost::bind (boost::ref(mwi_event), party, mwi));
+  Ekiga::Runtime::run_in_main (boost::bind (boost::ref(mwi_event), party, mwi), 0, "sip-mwi");
 }
 
 
@@ -111,6 +111,7 @@ namespace Opal {
       void OnDialogInfoReceived (const SIPDialogNotification & info);
 
       const Ekiga::ServiceCore & core;
+      Ekiga::ServiceHandle<Opal::Bank> account_store;
 
       PString noAnswerForwardParty;
       PString unconditionalForwardParty;
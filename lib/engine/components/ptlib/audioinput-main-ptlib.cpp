@@ -69,6 +69,12 @@ struct PTLIBAUDIOINPUTSpark: public Ekiga::Spark
   const std::string get_name () const
   { return "PTLIBAUDIOINPUT"; }
 
+  void get_provides (std::list<std::string>& names) const
+  { names.push_back ("ptlib-audio-input"); }
+
+  void get_requires (std::list<std::string>& names) const
+  { names.push_back ("audioinput-core"); }
+
   bool result;
 };
 
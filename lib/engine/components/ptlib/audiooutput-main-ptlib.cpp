@@ -69,6 +69,12 @@ struct PTLIBAUDIOOUTPUTSpark: public Ekiga::Spark
   const std::string get_name () const
   { return "PTLIBAUDIOOUTPUT"; }
 
+  void get_provides (std::list<std::string>& names) const
+  { names.push_back ("ptlib-audio-output"); }
+
+  void get_requires (std::list<std::string>& names) const
+  { names.push_back ("audiooutput-core"); }
+
   bool result;
 };
 
@@ -40,6 +40,7 @@
 
 #include "services.h"
 #include "kickstart.h"
+#include "startup-trace.h"
 
 #include "notification-core.h"
 #include "plugin-core.h"
@@ -80,24 +81,36 @@ engine_init (Ekiga::ServiceCore& core,
              int argc,
              char *argv [])
 {
+  Ekiga::StartupTrace::Span trace ("opal_init_pprocess", "engine");
+
   // AT THE VERY FIRST, create the PProcess
   GnomeMeeting & instance = opal_init_pprocess (argc, argv);
 
   // FIRST we add a few things by hand
   // (for speed and because that's less code)
 
+  trace.next ("notification-core");
   boost::shared_ptr<Ekiga::NotificationCore> notification_core(new Ekiga::NotificationCore);
   core.add (notification_core);
 
+  trace.next ("account-core");
   boost::shared_ptr<Ekiga::AccountCore> account_core (new Ekiga::AccountCore);
+  trace.next ("contact-core");
   boost::shared_ptr<Ekiga::ContactCore> contact_core (new Ekiga::ContactCore);
+  trace.next ("call-core");
   boost::shared_ptr<Ekiga::CallCore> call_core (new Ekiga::CallCore (notification_core));
+  trace.next ("audiooutput-core");
   boost::shared_ptr<Ekiga::AudioOutputCore> audiooutput_core (new Ekiga::AudioOutputCore (core));
+  trace.next ("audioinput-core");
   boost::shared_ptr<Ekiga::AudioInputCore> audioinput_core (new Ekiga::AudioInputCore(core));
+  trace.next ("hal-core");
   boost::shared_ptr<Ekiga::HalCore> hal_core (new Ekiga::HalCore);
+  trace.next ("personal-details");
   boost::shared_ptr<Gmconf::PersonalDetails> details(new Gmconf::PersonalDetails);
+  trace.next ("presence-core");
   boost::shared_ptr<Ekiga::PresenceCore> presence_core(new Ekiga::PresenceCore (details));
 
+  trace.next ("registering the cores");
   core.add (contact_core);
   core.add (audioinput_core);
   core.add (audiooutput_core);
@@ -108,10 +121,13 @@ engine_init (Ekiga::ServiceCore& core,
   core.add (presence_core);
 
   //
+  trace.next ("opal process start");
   instance.Start (core);
 
   // THEN we use the kickstart scheme
 
+  trace.next ("registering the sparks");
+
   Ekiga::KickStart kickstart;
 
   audioinput_null_init (kickstart);
@@ -132,20 +148,18 @@ engine_init (Ekiga::ServiceCore& core,
 
   plugin_init (kickstart);
 
-  // FIXME: Some parts in the kickstart need the gui.  The gui needs
-  //  some parts in the kickstart.  So we will kick a first time to
-  //  get things not needing the gui up and running, then start the
-  //  gui (which will hence find what it needs) and kick a second time
-  //  to really make the engine go vroom. It would be nicer to either
-  //  push the parts needed by the gui in the hand-crafted part of
-  //  this initialization, or put the gui in the kickstart too.
-
-  kickstart.kick (core, &argc, &argv);
+  // the gui core doesn't need anything from the kickstart, so bring it up
+  // before : then a single kick is enough, and sparks needing the gui can
+  // ask for it as any other requirement
 
+  trace.next ("gtk-core");
   gtk_core_init (core, &argc, &argv);
 
+  trace.next ("kickstart");
   kickstart.kick (core, &argc, &argv);
 
+  trace.next ("devices setup");
+
   /* FIXME: everything that follows except the debug output shouldn't
      be there, as that means we're doing the work of initializing
      those in the correct order here instead of having the specific
@@ -164,6 +178,8 @@ engine_init (Ekiga::ServiceCore& core,
 #if DEBUG_STARTUP
   std::cout << "Here is what ekiga is made of for this run :" << std::endl;
   core.dump (std::cout);
+  std::cout << "And here is how long it took to kickstart :" << std::endl;
+  kickstart.dump (std::cout);
 #endif
 }
 
@@ -0,0 +1,260 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         audio-converter.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : implementation of the audio stream converter
+ *
+ */
+
+#include <math.h>
+#include <string.h>
+#include <glib.h>
+
+#include "audio-converter.h"
+#include "audio-dsp.h"
+
+/* Number of filter taps per input sample when upsampling : when
+ * downsampling, the filter gets longer to keep the same quality */
+#define TAPS_PER_SIDE 8
+
+/* The histories are only compacted once that many input samples went
+ * through them, instead of moving the filter memory on every call */
+#define HISTORY_COMPACT 4096
+
+Ekiga::AudioConverter::AudioConverter ()
+{
+  setup (1, 8000, 16, 1, 8000, 16);
+}
+
+void
+Ekiga::AudioConverter::setup (unsigned in_channels_,
+			      unsigned in_samplerate_,
+			      unsigned in_bits_per_sample,
+			      unsigned out_channels_,
+			      unsigned out_samplerate_,
+			      unsigned out_bits_per_sample)
+{
+  unsigned a = in_samplerate_;
+  unsigned b = out_samplerate_;
+
+  g_return_if_fail (in_channels_ > 0 && out_channels_ > 0);
+  g_return_if_fail (in_samplerate_ > 0 && out_samplerate_ > 0);
+  g_return_if_fail (in_bits_per_sample == 8 || in_bits_per_sample == 16);
+  g_return_if_fail (out_bits_per_sample == 8 || out_bits_per_sample == 16);
+
+  in_channels = in_channels_;
+  in_samplerate = in_samplerate_;
+  in_bytes = in_bits_per_sample / 8;
+  out_channels = out_channels_;
+  out_samplerate = out_samplerate_;
+  out_bytes = out_bits_per_sample / 8;
+  identity = (in_channels == out_channels
+	      && in_samplerate == out_samplerate
+	      && in_bytes == out_bytes);
+
+  while (b != 0) {
+
+    unsigned r = a % b;
+    a = b;
+    b = r;
+  }
+  up = out_samplerate / a;
+  down = in_samplerate / a;
+
+  coefficients.clear ();
+  taps = 0;
+
+  if (up != down) {
+
+    unsigned length = 0;
+    double center = 0;
+    double cutoff = 0;
+
+    taps = (2 * TAPS_PER_SIDE * MAX (up, down) + up - 1) / up;
+    length = up * taps;
+    center = (length - 1) / 2.0;
+    /* in cycles per upsampled sample, a bit below Nyquist */
+    cutoff = 0.475 / MAX (up, down);
+
+    coefficients.resize (length);
+    for (unsigned ii = 0; ii < length; ii++) {
+
+      double x = 2 * cutoff * (ii - center);
+      double sinc = (fabs (x) < 1e-9) ? 1.0 : sin (M_PI * x) / (M_PI * x);
+      double w = 2 * M_PI * ii / (length - 1);
+      double blackman = 0.42 - 0.5 * cos (w) + 0.08 * cos (2 * w);
+      unsigned phase = ii % up;
+      unsigned tap = ii / up;
+
+      /* each phase is stored reversed, so that the filtering is a
+       * plain dot product with the input */
+      coefficients[phase * taps + (taps - 1 - tap)] = (float) (up * 2 * cutoff * sinc * blackman);
+    }
+  }
+
+  channels.resize (out_channels);
+  histories.resize (out_channels);
+  reset ();
+}
+
+void
+Ekiga::AudioConverter::reset ()
+{
+  position = 0;
+  history_start = 0;
+
+  for (unsigned ii = 0; ii < histories.size (); ii++)
+    histories[ii].assign (taps > 0 ? taps - 1 : 0, 0.0f);
+}
+
+unsigned
+Ekiga::AudioConverter::get_input_size (unsigned size) const
+{
+  unsigned long out_frame_size = out_channels * out_bytes;
+  unsigned long out_frames = (size + out_frame_size - 1) / out_frame_size;
+  unsigned long in_frames = (out_frames * down + up - 1) / up;
+
+  return (unsigned) (in_frames * in_channels * in_bytes);
+}
+
+void
+Ekiga::AudioConverter::convert (const char* in,
+				unsigned in_size,
+				std::vector<char>& out)
+{
+  unsigned frames = in_size / (in_channels * in_bytes);
+  unsigned long next_position = position;
+
+  if (identity) {
+
+    out.insert (out.end (), in, in + frames * in_channels * in_bytes);
+    return;
+  }
+
+  if (frames == 0)
+    return;
+
+  decode (in, frames);
+
+  if (taps > 0) {
+
+    for (unsigned ii = 0; ii < out_channels; ii++) {
+
+      /* the filter memory starts at history_start, followed by the samples
+       * decode just appended */
+      const float* history = &histories[ii][history_start];
+
+      channels[ii].clear ();
+      next_position = position;
+      while (next_position / up < frames) {
+
+	channels[ii].push_back (AudioDSP::dot (&coefficients[(next_position % up) * taps],
+					       history + next_position / up,
+					       taps));
+	next_position += down;
+      }
+    }
+    position = next_position - (unsigned long) frames * up;
+    history_start += frames;
+
+    if (history_start >= HISTORY_COMPACT) {
+
+      for (unsigned ii = 0; ii < out_channels; ii++)
+	histories[ii].erase (histories[ii].begin (), histories[ii].begin () + history_start);
+      history_start = 0;
+    }
+  }
+
+  encode (out);
+}
+
+void
+Ekiga::AudioConverter::decode (const char* in,
+			       unsigned frames)
+{
+  unsigned count = frames * in_channels;
+
+  samples.resize (count);
+  if (in_bytes == 2)
+    AudioDSP::int16_to_float ((const short*) in, &samples[0], count);
+  else
+    for (unsigned ii = 0; ii < count; ii++)
+      samples[ii] = ((int) (unsigned char) in[ii] - 128) / 128.0f;
+
+  /* when resampling, decode straight at the end of the filter memory */
+  std::vector<std::vector<float> >& targets = (taps > 0) ? histories : channels;
+  size_t base = (taps > 0) ? histories[0].size () : 0;
+
+  for (unsigned ii = 0; ii < out_channels; ii++)
+    targets[ii].resize (base + frames);
+
+  for (unsigned ff = 0; ff < frames; ff++) {
+
+    const float* frame = &samples[ff * in_channels];
+
+    if (out_channels == 1 && in_channels > 1) {
+
+      float sum = 0.0f;
+      for (unsigned ii = 0; ii < in_channels; ii++)
+	sum += frame[ii];
+      targets[0][base + ff] = sum / in_channels;
+    }
+    else
+      for (unsigned ii = 0; ii < out_channels; ii++)
+	targets[ii][base + ff] = frame[ii % in_channels];
+  }
+}
+
+void
+Ekiga::AudioConverter::encode (std::vector<char>& out)
+{
+  unsigned frames = channels[0].size ();
+  unsigned count = frames * out_channels;
+  size_t start = out.size ();
+
+  samples.resize (count);
+  for (unsigned ff = 0; ff < frames; ff++)
+    for (unsigned ii = 0; ii < out_channels; ii++)
+      samples[ff * out_channels + ii] = channels[ii][ff];
+
+  out.resize (start + count * out_bytes);
+  if (count == 0)
+    return;
+
+  if (out_bytes == 2) {
+
+    encoded.resize (count);
+    AudioDSP::float_to_int16 (&samples[0], &encoded[0], count);
+    memcpy (&out[start], &encoded[0], count * 2);
+  }
+  else
+    for (unsigned ii = 0; ii < count; ii++)
+      out[start + ii] = (char) (unsigned char) CLAMP (lrintf (samples[ii] * 128.0f) + 128, 0, 255);
+}
@@ -0,0 +1,131 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         audio-converter.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : conversion of an audio stream between sample
+ *                          rates, channel counts and sample sizes
+ *
+ */
+
+#ifndef __AUDIO_CONVERTER_H__
+#define __AUDIO_CONVERTER_H__
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace Ekiga
+{
+
+  /**
+   * @addtogroup services
+   * @{
+   */
+
+  /* Converts a stream of interleaved samples from one format to another.
+   *
+   * Channels are downmixed (by averaging) or duplicated, 8 bits (unsigned)
+   * and 16 bits (signed, native endian) samples are supported, and the
+   * sample rate is changed with a polyphase windowed-sinc resampler, which
+   * handles any rational ratio (48000 to 8000, 44100 to 16000, ...).
+   *
+   * The converter keeps the tail of the previous buffer, so a stream can be
+   * fed in pieces of any size ; call reset () between two streams.
+   */
+  class AudioConverter:
+    public boost::noncopyable
+  {
+  public:
+
+    AudioConverter ();
+
+    void setup (unsigned in_channels,
+		unsigned in_samplerate,
+		unsigned in_bits_per_sample,
+		unsigned out_channels,
+		unsigned out_samplerate,
+		unsigned out_bits_per_sample);
+
+    /* True if the input and output formats are the same */
+    bool is_identity () const
+    { return identity; }
+
+    /* Forgets about the previous buffers */
+    void reset ();
+
+    /* Converts in_size bytes from in, and appends the result to out.
+     * Incomplete frames at the end of in are ignored.
+     */
+    void convert (const char* in,
+		  unsigned in_size,
+		  std::vector<char>& out);
+
+    /* Returns the number of input bytes needed to get about size output
+     * bytes (rounded up to complete frames).
+     */
+    unsigned get_input_size (unsigned size) const;
+
+  private:
+
+    void decode (const char* in, unsigned frames);
+    void resample (std::vector<float>& channel_data, std::vector<float>& history);
+    void encode (std::vector<char>& out);
+
+    unsigned in_channels;
+    unsigned in_samplerate;
+    unsigned in_bytes;
+    unsigned out_channels;
+    unsigned out_samplerate;
+    unsigned out_bytes;
+    bool identity;
+
+    /* polyphase filter : taps coefficients for each of the up phases */
+    unsigned up;
+    unsigned down;
+    unsigned taps;
+    std::vector<float> coefficients;
+
+    /* position of the next output sample, in 1/up of input sample */
+    unsigned long position;
+
+    /* per output channel work buffers and filter memory : the memory
+     * starts at history_start, and is compacted from time to time */
+    std::vector<std::vector<float> > channels;
+    std::vector<std::vector<float> > histories;
+    unsigned history_start;
+    std::vector<float> samples;
+    std::vector<short> encoded;
+  };
+
+  /**
+   * @}
+   */
+};
+
+#endif
@@ -0,0 +1,246 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         audio-dsp-bench.cpp  -  description
+ *                         -----------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Checks that all AudioDSP implementations give
+ *                          the same results, and times them against the
+ *                          loop the audio cores used before.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "audio-dsp.h"
+
+#define FRAMES 960 // 20 ms at 48 kHz, what the audio stacks move around
+#define ROUNDS 20000
+
+static const char* implementations[] = { "c", "sse2", "avx2" };
+
+struct Results
+{
+  guint64 abs_sum;
+  guint64 square_sum;
+  unsigned peak;
+  unsigned clip_count;
+  std::vector<short> gained;
+  std::vector<short> mixed;
+  std::vector<float> floats;
+  std::vector<short> shorts;
+  float dot;
+};
+
+static void
+fill_samples (std::vector<short>& samples,
+	      guint32 seed)
+{
+  GRand* rand = g_rand_new_with_seed (seed);
+
+  for (unsigned ii = 0; ii < samples.size (); ii++)
+    samples[ii] = (short) g_rand_int_range (rand, -32768, 32768);
+
+  // make sure the saturation paths get exercised
+  samples[0] = -32768;
+  samples[1] = 32767;
+
+  g_rand_free (rand);
+}
+
+static void
+compute (const std::vector<short>& samples,
+	 const std::vector<short>& other,
+	 Results& results)
+{
+  unsigned count = samples.size ();
+
+  results.abs_sum = Ekiga::AudioDSP::abs_sum (&samples[0], count);
+  results.square_sum = Ekiga::AudioDSP::square_sum (&samples[0], count);
+  results.peak = Ekiga::AudioDSP::peak (&samples[0], count);
+  results.clip_count = Ekiga::AudioDSP::clip_count (&samples[0], count, 30000);
+
+  results.gained = samples;
+  Ekiga::AudioDSP::apply_gain (&results.gained[0], count, 1.7f);
+
+  results.mixed = samples;
+  Ekiga::AudioDSP::mix (&results.mixed[0], &other[0], count, 0.8f);
+
+  results.floats.resize (count);
+  Ekiga::AudioDSP::int16_to_float (&samples[0], &results.floats[0], count);
+
+  results.shorts.resize (count);
+  Ekiga::AudioDSP::float_to_int16 (&results.floats[0], &results.shorts[0], count);
+
+  std::vector<float> other_floats (count);
+  Ekiga::AudioDSP::int16_to_float (&other[0], &other_floats[0], count);
+  results.dot = Ekiga::AudioDSP::dot (&results.floats[0], &other_floats[0], count);
+}
+
+/* what both audio cores did to get their average level before AudioDSP :
+ * size is in bytes */
+static int
+original_abs_sum (const short* buffer,
+		  unsigned size)
+{
+  int sum = 0;
+  unsigned csize = 0;
+
+  while (csize < (size>>1) ) {
+
+    if (*buffer < 0)
+      sum -= *buffer++;
+    else
+      sum += *buffer++;
+
+    csize++;
+  }
+
+  return sum;
+}
+
+static bool
+same_results (const Results& a,
+	      const Results& b)
+{
+  return (a.abs_sum == b.abs_sum
+	  && a.square_sum == b.square_sum
+	  && a.peak == b.peak
+	  && a.clip_count == b.clip_count
+	  && a.gained == b.gained
+	  && a.mixed == b.mixed
+	  && memcmp (&a.floats[0], &b.floats[0], a.floats.size () * sizeof (float)) == 0
+	  && a.shorts == b.shorts
+	  && memcmp (&a.dot, &b.dot, sizeof (float)) == 0);
+}
+
+/* the original loop if original is true, else the current kernel */
+static double
+time_abs_sum (const std::vector<short>& samples,
+	      bool original)
+{
+  guint64 sink = 0;
+  GTimer* timer = g_timer_new ();
+
+  for (unsigned round = 0; round < ROUNDS; round++) {
+
+    if (original)
+      sink += original_abs_sum (&samples[0], samples.size () * sizeof (short));
+    else
+      sink += Ekiga::AudioDSP::abs_sum (&samples[0], samples.size ());
+  }
+
+  double elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  if (sink == 0) // keeps the compiler from dropping the loop
+    printf ("\n");
+
+  return elapsed;
+}
+
+static double
+time_kernels (std::vector<short>& samples,
+	      const std::vector<short>& other)
+{
+  std::vector<float> floats (samples.size ());
+  unsigned count = samples.size ();
+  guint64 sink = 0;
+  float dot_sink = 0.0f;
+  GTimer* timer = g_timer_new ();
+
+  for (unsigned round = 0; round < ROUNDS; round++) {
+
+    sink += Ekiga::AudioDSP::abs_sum (&samples[0], count);
+    sink += Ekiga::AudioDSP::square_sum (&samples[0], count);
+    sink += Ekiga::AudioDSP::peak (&samples[0], count);
+    sink += Ekiga::AudioDSP::clip_count (&samples[0], count);
+    Ekiga::AudioDSP::apply_gain (&samples[0], count, 1.0f);
+    Ekiga::AudioDSP::mix (&samples[0], &other[0], count, 0.0f);
+    Ekiga::AudioDSP::int16_to_float (&samples[0], &floats[0], count);
+    Ekiga::AudioDSP::float_to_int16 (&floats[0], &samples[0], count);
+    dot_sink += Ekiga::AudioDSP::dot (&floats[0], &floats[0], count);
+  }
+
+  double elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  if (sink == 0 && dot_sink == 0.0f) // keeps the compiler from dropping the loop
+    printf ("\n");
+
+  return elapsed;
+}
+
+int
+main (int /*argc*/,
+      char** /*argv*/)
+{
+  std::vector<short> samples (FRAMES + 7); // odd size : check the tails too
+  std::vector<short> other (FRAMES + 7);
+  Results reference;
+  bool success = true;
+
+  fill_samples (samples, 42);
+  fill_samples (other, 4242);
+
+  Ekiga::AudioDSP::set_implementation ("c");
+  compute (samples, other, reference);
+
+  bool same = (reference.abs_sum
+	       == (guint64) original_abs_sum (&samples[0], samples.size () * sizeof (short)));
+  success = success && same;
+  printf ("%-5s %s  %8.3f us per %u samples abs-sum\n",
+	  "loop", same ? "same results   " : "DIFFERENT RESULTS",
+	  time_abs_sum (samples, true) * 1e6 / ROUNDS, FRAMES + 7);
+
+  for (unsigned ii = 0; ii < G_N_ELEMENTS (implementations); ii++) {
+
+    if ( !Ekiga::AudioDSP::set_implementation (implementations[ii])) {
+
+      printf ("%-5s not available on this CPU\n", implementations[ii]);
+      continue;
+    }
+
+    Results results;
+    compute (samples, other, results);
+    bool same = same_results (reference, results);
+    success = success && same;
+
+    std::vector<short> work (samples);
+    double elapsed = time_kernels (work, other);
+
+    printf ("%-5s %s  %8.3f us per %u samples abs-sum, %8.3f us for all kernels\n",
+	    implementations[ii], same ? "same results   " : "DIFFERENT RESULTS",
+	    time_abs_sum (samples, false) * 1e6 / ROUNDS, FRAMES + 7,
+	    elapsed * 1e6 / ROUNDS);
+  }
+
+  return success ? 0 : 1;
+}
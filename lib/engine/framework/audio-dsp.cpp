@@ -0,0 +1,850 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         audio-dsp.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : implementation of the signal processing kernels
+ *
+ */
+
+#include <math.h>
+
+#include "audio-dsp.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DSP_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+namespace
+{
+  struct Kernels
+  {
+    const char* name;
+    guint64 (*abs_sum) (const short*, unsigned);
+    guint64 (*square_sum) (const short*, unsigned);
+    unsigned (*peak) (const short*, unsigned);
+    unsigned (*clip_count) (const short*, unsigned, short);
+    void (*apply_gain) (short*, unsigned, float);
+    void (*mix) (short*, const short*, unsigned, float);
+    void (*int16_to_float) (const short*, float*, unsigned);
+    void (*float_to_int16) (const float*, short*, unsigned);
+    float (*dot) (const float*, const float*, unsigned);
+  };
+
+  /* Plain C implementation : also used for the tails of the vectorized ones
+   *
+   */
+
+  inline short
+  saturate (float value)
+  {
+    value = CLAMP (value, -32768.0f, 32767.0f);
+    return (short) lrintf (value);
+  }
+
+  guint64
+  abs_sum_c (const short* samples,
+	     unsigned count)
+  {
+    guint64 sum = 0;
+
+    for (unsigned ii = 0; ii < count; ii++)
+      sum += (unsigned) ABS ((int) samples[ii]);
+
+    return sum;
+  }
+
+  guint64
+  square_sum_c (const short* samples,
+		unsigned count)
+  {
+    guint64 sum = 0;
+
+    for (unsigned ii = 0; ii < count; ii++)
+      sum += (unsigned) ((int) samples[ii] * (int) samples[ii]);
+
+    return sum;
+  }
+
+  unsigned
+  peak_c (const short* samples,
+	  unsigned count)
+  {
+    int high = 0;
+    int low = 0;
+
+    for (unsigned ii = 0; ii < count; ii++) {
+
+      high = MAX (high, (int) samples[ii]);
+      low = MIN (low, (int) samples[ii]);
+    }
+
+    return (unsigned) MAX (high, -low);
+  }
+
+  unsigned
+  clip_count_c (const short* samples,
+		unsigned count,
+		short threshold)
+  {
+    unsigned result = 0;
+
+    for (unsigned ii = 0; ii < count; ii++)
+      result += (ABS ((int) samples[ii]) >= threshold);
+
+    return result;
+  }
+
+  void
+  apply_gain_c (short* samples,
+		unsigned count,
+		float gain)
+  {
+    for (unsigned ii = 0; ii < count; ii++)
+      samples[ii] = saturate ((float) samples[ii] * gain);
+  }
+
+  void
+  mix_c (short* dest,
+	 const short* src,
+	 unsigned count,
+	 float gain)
+  {
+    for (unsigned ii = 0; ii < count; ii++)
+      dest[ii] = saturate ((float) dest[ii] + (float) src[ii] * gain);
+  }
+
+  void
+  int16_to_float_c (const short* src,
+		    float* dest,
+		    unsigned count)
+  {
+    for (unsigned ii = 0; ii < count; ii++)
+      dest[ii] = (float) src[ii] * (1.0f / 32768.0f);
+  }
+
+  void
+  float_to_int16_c (const float* src,
+		    short* dest,
+		    unsigned count)
+  {
+    for (unsigned ii = 0; ii < count; ii++)
+      dest[ii] = saturate (src[ii] * 32768.0f);
+  }
+
+  /* The dot product keeps 8 partial sums, which all the implementations
+   * fill and add up in the same order : that way they give exactly the
+   * same results, even though float additions aren't associative */
+
+  float
+  dot_finish (const float* partial,
+	      const float* a,
+	      const float* b,
+	      unsigned count)
+  {
+    float sum = (((partial[0] + partial[4]) + (partial[1] + partial[5]))
+		 + ((partial[2] + partial[6]) + (partial[3] + partial[7])));
+
+    for (unsigned ii = 0; ii < count; ii++)
+      sum += a[ii] * b[ii];
+
+    return sum;
+  }
+
+  float
+  dot_c (const float* a,
+	 const float* b,
+	 unsigned count)
+  {
+    float partial[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    unsigned ii = 0;
+
+    for (; ii + 8 <= count; ii += 8)
+      for (unsigned kk = 0; kk < 8; kk++)
+	partial[kk] += a[ii + kk] * b[ii + kk];
+
+    return dot_finish (partial, a + ii, b + ii, count - ii);
+  }
+
+  const Kernels kernels_c = {
+    "c",
+    abs_sum_c,
+    square_sum_c,
+    peak_c,
+    clip_count_c,
+    apply_gain_c,
+    mix_c,
+    int16_to_float_c,
+    float_to_int16_c,
+    dot_c
+  };
+
+#ifdef DSP_X86
+
+  /* SSE2 implementation
+   *
+   */
+
+  /* Each 32 bits lane gains at most 2*32768 per iteration : flush
+   * them in the 64 bits accumulator before they can overflow */
+  const unsigned sse2_block = 32768;
+
+  __attribute__((target("sse2"))) inline guint64
+  hsum_epu32_sse2 (__m128i acc)
+  {
+    guint32 lanes[4];
+
+    _mm_storeu_si128 ((__m128i*) lanes, acc);
+
+    return (guint64) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+
+  __attribute__((target("sse2"))) guint64
+  abs_sum_sse2 (const short* samples,
+		unsigned count)
+  {
+    const __m128i zero = _mm_setzero_si128 ();
+    guint64 sum = 0;
+    unsigned ii = 0;
+
+    while (ii + 8 <= count) {
+
+      __m128i acc = _mm_setzero_si128 ();
+      unsigned end = MIN (count & ~7u, ii + 8 * sse2_block);
+
+      for (; ii < end; ii += 8) {
+
+	__m128i x = _mm_loadu_si128 ((const __m128i*) (samples + ii));
+	__m128i sign = _mm_srai_epi16 (x, 15);
+	/* |-32768| wraps to 0x8000, which is right once read as unsigned */
+	__m128i a = _mm_sub_epi16 (_mm_xor_si128 (x, sign), sign);
+	acc = _mm_add_epi32 (acc, _mm_unpacklo_epi16 (a, zero));
+	acc = _mm_add_epi32 (acc, _mm_unpackhi_epi16 (a, zero));
+      }
+      sum += hsum_epu32_sse2 (acc);
+    }
+
+    return sum + abs_sum_c (samples + ii, count - ii);
+  }
+
+  __attribute__((target("sse2"))) guint64
+  square_sum_sse2 (const short* samples,
+		   unsigned count)
+  {
+    const __m128i zero = _mm_setzero_si128 ();
+    __m128i acc = _mm_setzero_si128 ();
+    guint64 lanes[2];
+    unsigned ii = 0;
+
+    for (; ii + 8 <= count; ii += 8) {
+
+      __m128i x = _mm_loadu_si128 ((const __m128i*) (samples + ii));
+      /* each lane is at most 2*2^30, which fits in an unsigned 32 bits */
+      __m128i sq = _mm_madd_epi16 (x, x);
+      acc = _mm_add_epi64 (acc, _mm_unpacklo_epi32 (sq, zero));
+      acc = _mm_add_epi64 (acc, _mm_unpackhi_epi32 (sq, zero));
+    }
+
+    _mm_storeu_si128 ((__m128i*) lanes, acc);
+
+    return lanes[0] + lanes[1] + square_sum_c (samples + ii, count - ii);
+  }
+
+  __attribute__((target("sse2"))) unsigned
+  peak_sse2 (const short* samples,
+	     unsigned count)
+  {
+    __m128i high = _mm_setzero_si128 ();
+    __m128i low = _mm_setzero_si128 ();
+    short highs[8];
+    short lows[8];
+    unsigned result = 0;
+    unsigned ii = 0;
+
+    for (; ii + 8 <= count; ii += 8) {
+
+      __m128i x = _mm_loadu_si128 ((const __m128i*) (samples + ii));
+      high = _mm_max_epi16 (high, x);
+      low = _mm_min_epi16 (low, x);
+    }
+
+    _mm_storeu_si128 ((__m128i*) highs, high);
+    _mm_storeu_si128 ((__m128i*) lows, low);
+    for (unsigned jj = 0; jj < 8; jj++)
+      result = MAX (result, (unsigned) MAX ((int) highs[jj], -(int) lows[jj]));
+
+    return MAX (result, peak_c (samples + ii, count - ii));
+  }
+
+  __attribute__((target("sse2"))) unsigned
+  clip_count_sse2 (const short* samples,
+		   unsigned count,
+		   short threshold)
+  {
+    const __m128i above = _mm_set1_epi16 (threshold - 1);
+    const __m128i below = _mm_set1_epi16 (1 - threshold);
+    unsigned result = 0;
+    unsigned ii = 0;
+
+    for (; ii + 8 <= count; ii += 8) {
+
+      __m128i x = _mm_loadu_si128 ((const __m128i*) (samples + ii));
+      __m128i clipped = _mm_or_si128 (_mm_cmpgt_epi16 (x, above),
+				      _mm_cmplt_epi16 (x, below));
+      /* two mask bits per sample */
+      result += __builtin_popcount (_mm_movemask_epi8 (clipped)) / 2;
+    }
+
+    return result + clip_count_c (samples + ii, count - ii, threshold);
+  }
+
+  __attribute__((target("sse2"))) inline __m128i
+  saturate_sse2 (__m128 lo,
+		 __m128 hi)
+  {
+    const __m128 min = _mm_set1_ps (-32768.0f);
+    const __m128 max = _mm_set1_ps (32767.0f);
+
+    lo = _mm_min_ps (_mm_max_ps (lo, min), max);
+    hi = _mm_min_ps (_mm_max_ps (hi, min), max);
+
+    return _mm_packs_epi32 (_mm_cvtps_epi32 (lo), _mm_cvtps_epi32 (hi));
+  }
+
+  __attribute__((target("sse2"))) inline void
+  widen_sse2 (__m128i x,
+	      __m128& lo,
+	      __m128& hi)
+  {
+    /* sign-extend by shifting the samples in the high halves */
+    lo = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpacklo_epi16 (x, x), 16));
+    hi = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpackhi_epi16 (x, x), 16));
+  }
+
+  __attribute__((target("sse2"))) void
+  apply_gain_sse2 (short* samples,
+		   unsigned count,
+		   float gain)
+  {
+    const __m128 g = _mm_set1_ps (gain);
+    unsigned ii = 0;
+
+    for (; ii + 8 <= count; ii += 8) {
+
+      __m128 lo, hi;
+      widen_sse2 (_mm_loadu_si128 ((const __m128i*) (samples + ii)), lo, hi);
+      _mm_storeu_si128 ((__m128i*) (samples + ii),
+			saturate_sse2 (_mm_mul_ps (lo, g), _mm_mul_ps (hi, g)));
+    }
+
+    apply_gain_c (samples + ii, count - ii, gain);
+  }
+
+  __attribute__((target("sse2"))) void
+  mix_sse2 (short* dest,
+	    const short* src,
+	    unsigned count,
+	    float gain)
+  {
+    const __m128 g = _mm_set1_ps (gain);
+    unsigned ii = 0;
+
+    for (; ii + 8 <= count; ii += 8) {
+
+      __m128 dlo, dhi, slo, shi;
+      widen_sse2 (_mm_loadu_si128 ((const __m128i*) (dest + ii)), dlo, dhi);
+      widen_sse2 (_mm_loadu_si128 ((const __m128i*) (src + ii)), slo, shi);
+      _mm_storeu_si128 ((__m128i*) (dest + ii),
+			saturate_sse2 (_mm_add_ps (dlo, _mm_mul_ps (slo, g)),
+				       _mm_add_ps (dhi, _mm_mul_ps (shi, g))));
+    }
+
+    mix_c (dest + ii, src + ii, count - ii, gain);
+  }
+
+  __attribute__((target("sse2"))) void
+  int16_to_float_sse2 (const short* src,
+		       float* dest,
+		       unsigned count)
+  {
+    const __m128 scale = _mm_set1_ps (1.0f / 32768.0f);
+    unsigned ii = 0;
+
+    for (; ii + 8 <= count; ii += 8) {
+
+      __m128 lo, hi;
+      widen_sse2 (_mm_loadu_si128 ((const __m128i*) (src + ii)), lo, hi);
+      _mm_storeu_ps (dest + ii, _mm_mul_ps (lo, scale));
+      _mm_storeu_ps (dest + ii + 4, _mm_mul_ps (hi, scale));
+    }
+
+    int16_to_float_c (src + ii, dest + ii, count - ii);
+  }
+
+  __attribute__((target("sse2"))) void
+  float_to_int16_sse2 (const float* src,
+		       short* dest,
+		       unsigned count)
+  {
+    const __m128 scale = _mm_set1_ps (32768.0f);
+    unsigned ii = 0;
+
+    for (; ii + 8 <= count; ii += 8)
+      _mm_storeu_si128 ((__m128i*) (dest + ii),
+			saturate_sse2 (_mm_mul_ps (_mm_loadu_ps (src + ii), scale),
+				       _mm_mul_ps (_mm_loadu_ps (src + ii + 4), scale)));
+
+    float_to_int16_c (src + ii, dest + ii, count - ii);
+  }
+
+  __attribute__((target("sse2"))) float
+  dot_sse2 (const float* a,
+	    const float* b,
+	    unsigned count)
+  {
+    __m128 lo = _mm_setzero_ps ();
+    __m128 hi = _mm_setzero_ps ();
+    float partial[8];
+    unsigned ii = 0;
+
+    for (; ii + 8 <= count; ii += 8) {
+
+      lo = _mm_add_ps (lo, _mm_mul_ps (_mm_loadu_ps (a + ii), _mm_loadu_ps (b + ii)));
+      hi = _mm_add_ps (hi, _mm_mul_ps (_mm_loadu_ps (a + ii + 4), _mm_loadu_ps (b + ii + 4)));
+    }
+    _mm_storeu_ps (partial, lo);
+    _mm_storeu_ps (partial + 4, hi);
+
+    return dot_finish (partial, a + ii, b + ii, count - ii);
+  }
+
+  const Kernels kernels_sse2 = {
+    "sse2",
+    abs_sum_sse2,
+    square_sum_sse2,
+    peak_sse2,
+    clip_count_sse2,
+    apply_gain_sse2,
+    mix_sse2,
+    int16_to_float_sse2,
+    float_to_int16_sse2,
+    dot_sse2
+  };
+
+  /* AVX2 implementation
+   *
+   */
+
+  __attribute__((target("avx2"))) guint64
+  abs_sum_avx2 (const short* samples,
+		unsigned count)
+  {
+    const __m256i zero = _mm256_setzero_si256 ();
+    guint64 sum = 0;
+    unsigned ii = 0;
+
+    while (ii + 16 <= count) {
+
+      __m256i acc = _mm256_setzero_si256 ();
+      unsigned end = MIN (count & ~15u, ii + 16 * sse2_block);
+      guint32 lanes[8];
+
+      for (; ii < end; ii += 16) {
+
+	/* |-32768| gives 0x8000, which is right once read as unsigned */
+	__m256i a = _mm256_abs_epi16 (_mm256_loadu_si256 ((const __m256i*) (samples + ii)));
+	acc = _mm256_add_epi32 (acc, _mm256_unpacklo_epi16 (a, zero));
+	acc = _mm256_add_epi32 (acc, _mm256_unpackhi_epi16 (a, zero));
+      }
+
+      _mm256_storeu_si256 ((__m256i*) lanes, acc);
+      for (unsigned jj = 0; jj < 8; jj++)
+	sum += lanes[jj];
+    }
+
+    return sum + abs_sum_c (samples + ii, count - ii);
+  }
+
+  __attribute__((target("avx2"))) guint64
+  square_sum_avx2 (const short* samples,
+		   unsigned count)
+  {
+    const __m256i zero = _mm256_setzero_si256 ();
+    __m256i acc = _mm256_setzero_si256 ();
+    guint64 lanes[4];
+    unsigned ii = 0;
+
+    for (; ii + 16 <= count; ii += 16) {
+
+      __m256i x = _mm256_loadu_si256 ((const __m256i*) (samples + ii));
+      __m256i sq = _mm256_madd_epi16 (x, x);
+      acc = _mm256_add_epi64 (acc, _mm256_unpacklo_epi32 (sq, zero));
+      acc = _mm256_add_epi64 (acc, _mm256_unpackhi_epi32 (sq, zero));
+    }
+
+    _mm256_storeu_si256 ((__m256i*) lanes, acc);
+
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3]
+      + square_sum_c (samples + ii, count - ii);
+  }
+
+  __attribute__((target("avx2"))) unsigned
+  peak_avx2 (const short* samples,
+	     unsigned count)
+  {
+    __m256i high = _mm256_setzero_si256 ();
+    __m256i low = _mm256_setzero_si256 ();
+    short highs[16];
+    short lows[16];
+    unsigned result = 0;
+    unsigned ii = 0;
+
+    for (; ii + 16 <= count; ii += 16) {
+
+      __m256i x = _mm256_loadu_si256 ((const __m256i*) (samples + ii));
+      high = _mm256_max_epi16 (high, x);
+      low = _mm256_min_epi16 (low, x);
+    }
+
+    _mm256_storeu_si256 ((__m256i*) highs, high);
+    _mm256_storeu_si256 ((__m256i*) lows, low);
+    for (unsigned jj = 0; jj < 16; jj++)
+      result = MAX (result, (unsigned) MAX ((int) highs[jj], -(int) lows[jj]));
+
+    return MAX (result, peak_c (samples + ii, count - ii));
+  }
+
+  __attribute__((target("avx2"))) unsigned
+  clip_count_avx2 (const short* samples,
+		   unsigned count,
+		   short threshold)
+  {
+    const __m256i above = _mm256_set1_epi16 (threshold - 1);
+    const __m256i below = _mm256_set1_epi16 (1 - threshold);
+    unsigned result = 0;
+    unsigned ii = 0;
+
+    for (; ii + 16 <= count; ii += 16) {
+
+      __m256i x = _mm256_loadu_si256 ((const __m256i*) (samples + ii));
+      __m256i clipped = _mm256_or_si256 (_mm256_cmpgt_epi16 (x, above),
+					 _mm256_cmpgt_epi16 (below, x));
+      /* two mask bits per sample */
+      result += __builtin_popcount ((unsigned) _mm256_movemask_epi8 (clipped)) / 2;
+    }
+
+    return result + clip_count_c (samples + ii, count - ii, threshold);
+  }
+
+  __attribute__((target("avx2"))) inline __m256i
+  saturate_avx2 (__m256 lo,
+		 __m256 hi)
+  {
+    const __m256 min = _mm256_set1_ps (-32768.0f);
+    const __m256 max = _mm256_set1_ps (32767.0f);
+
+    lo = _mm256_min_ps (_mm256_max_ps (lo, min), max);
+    hi = _mm256_min_ps (_mm256_max_ps (hi, min), max);
+
+    /* packs works within 128 bits lanes : put the quarters back in order */
+    return _mm256_permute4x64_epi64 (_mm256_packs_epi32 (_mm256_cvtps_epi32 (lo),
+							 _mm256_cvtps_epi32 (hi)),
+				     0xd8);
+  }
+
+  __attribute__((target("avx2"))) inline void
+  widen_avx2 (const short* samples,
+	      __m256& lo,
+	      __m256& hi)
+  {
+    lo = _mm256_cvtepi32_ps (_mm256_cvtepi16_epi32 (_mm_loadu_si128 ((const __m128i*) samples)));
+    hi = _mm256_cvtepi32_ps (_mm256_cvtepi16_epi32 (_mm_loadu_si128 ((const __m128i*) (samples + 8))));
+  }
+
+  __attribute__((target("avx2"))) void
+  apply_gain_avx2 (short* samples,
+		   unsigned count,
+		   float gain)
+  {
+    const __m256 g = _mm256_set1_ps (gain);
+    unsigned ii = 0;
+
+    for (; ii + 16 <= count; ii += 16) {
+
+      __m256 lo, hi;
+      widen_avx2 (samples + ii, lo, hi);
+      _mm256_storeu_si256 ((__m256i*) (samples + ii),
+			   saturate_avx2 (_mm256_mul_ps (lo, g), _mm256_mul_ps (hi, g)));
+    }
+
+    apply_gain_c (samples + ii, count - ii, gain);
+  }
+
+  __attribute__((target("avx2"))) void
+  mix_avx2 (short* dest,
+	    const short* src,
+	    unsigned count,
+	    float gain)
+  {
+    const __m256 g = _mm256_set1_ps (gain);
+    unsigned ii = 0;
+
+    for (; ii + 16 <= count; ii += 16) {
+
+      __m256 dlo, dhi, slo, shi;
+      widen_avx2 (dest + ii, dlo, dhi);
+      widen_avx2 (src + ii, slo, shi);
+      _mm256_storeu_si256 ((__m256i*) (dest + ii),
+			   saturate_avx2 (_mm256_add_ps (dlo, _mm256_mul_ps (slo, g)),
+					  _mm256_add_ps (dhi, _mm256_mul_ps (shi, g))));
+    }
+
+    mix_c (dest + ii, src + ii, count - ii, gain);
+  }
+
+  __attribute__((target("avx2"))) void
+  int16_to_float_avx2 (const short* src,
+		       float* dest,
+		       unsigned count)
+  {
+    const __m256 scale = _mm256_set1_ps (1.0f / 32768.0f);
+    unsigned ii = 0;
+
+    for (; ii + 16 <= count; ii += 16) {
+
+      __m256 lo, hi;
+      widen_avx2 (src + ii, lo, hi);
+      _mm256_storeu_ps (dest + ii, _mm256_mul_ps (lo, scale));
+      _mm256_storeu_ps (dest + ii + 8, _mm256_mul_ps (hi, scale));
+    }
+
+    int16_to_float_c (src + ii, dest + ii, count - ii);
+  }
+
+  __attribute__((target("avx2"))) void
+  float_to_int16_avx2 (const float* src,
+		       short* dest,
+		       unsigned count)
+  {
+    const __m256 scale = _mm256_set1_ps (32768.0f);
+    unsigned ii = 0;
+
+    for (; ii + 16 <= count; ii += 16)
+      _mm256_storeu_si256 ((__m256i*) (dest + ii),
+			   saturate_avx2 (_mm256_mul_ps (_mm256_loadu_ps (src + ii), scale),
+					  _mm256_mul_ps (_mm256_loadu_ps (src + ii + 8), scale)));
+
+    float_to_int16_c (src + ii, dest + ii, count - ii);
+  }
+
+  __attribute__((target("avx2"))) float
+  dot_avx2 (const float* a,
+	    const float* b,
+	    unsigned count)
+  {
+    __m256 acc = _mm256_setzero_ps ();
+    float partial[8];
+    unsigned ii = 0;
+
+    /* no FMA here : it would round differently from the other versions */
+    for (; ii + 8 <= count; ii += 8)
+      acc = _mm256_add_ps (acc, _mm256_mul_ps (_mm256_loadu_ps (a + ii), _mm256_loadu_ps (b + ii)));
+    _mm256_storeu_ps (partial, acc);
+
+    return dot_finish (partial, a + ii, b + ii, count - ii);
+  }
+
+  const Kernels kernels_avx2 = {
+    "avx2",
+    abs_sum_avx2,
+    square_sum_avx2,
+    peak_avx2,
+    clip_count_avx2,
+    apply_gain_avx2,
+    mix_avx2,
+    int16_to_float_avx2,
+    float_to_int16_avx2,
+    dot_avx2
+  };
+
+#endif
+
+  /* Dispatching
+   *
+   */
+
+  const Kernels*
+  find_kernels (const char* name)
+  {
+    if (g_strcmp0 (name, kernels_c.name) == 0)
+      return &kernels_c;
+
+#ifdef DSP_X86
+    __builtin_cpu_init ();
+    if (g_strcmp0 (name, kernels_sse2.name) == 0 && __builtin_cpu_supports ("sse2"))
+      return &kernels_sse2;
+    if (g_strcmp0 (name, kernels_avx2.name) == 0 && __builtin_cpu_supports ("avx2"))
+      return &kernels_avx2;
+#endif
+
+    return NULL;
+  }
+
+  const Kernels*
+  detect_kernels ()
+  {
+    const Kernels* kernels = find_kernels ("avx2");
+
+    if (kernels == NULL)
+      kernels = find_kernels ("sse2");
+    if (kernels == NULL)
+      kernels = &kernels_c;
+
+    return kernels;
+  }
+
+  gpointer current_kernels = NULL;
+
+  const Kernels*
+  get_kernels ()
+  {
+    static gsize initialized = 0;
+
+    if (g_once_init_enter (&initialized)) {
+
+      g_atomic_pointer_set (&current_kernels, (gpointer) detect_kernels ());
+      g_once_init_leave (&initialized, 1);
+    }
+
+    return (const Kernels*) g_atomic_pointer_get (&current_kernels);
+  }
+};
+
+const char*
+Ekiga::AudioDSP::get_implementation ()
+{
+  return get_kernels ()->name;
+}
+
+bool
+Ekiga::AudioDSP::set_implementation (const char* name)
+{
+  const Kernels* kernels = find_kernels (name);
+
+  if (kernels == NULL)
+    return false;
+
+  get_kernels (); // make sure the detection won't override us later
+  g_atomic_pointer_set (&current_kernels, (gpointer) kernels);
+
+  return true;
+}
+
+guint64
+Ekiga::AudioDSP::abs_sum (const short* samples,
+			  unsigned count)
+{
+  return get_kernels ()->abs_sum (samples, count);
+}
+
+guint64
+Ekiga::AudioDSP::square_sum (const short* samples,
+			     unsigned count)
+{
+  return get_kernels ()->square_sum (samples, count);
+}
+
+double
+Ekiga::AudioDSP::rms (const short* samples,
+		      unsigned count)
+{
+  if (count == 0)
+    return 0.0;
+
+  return sqrt ((double) square_sum (samples, count) / count);
+}
+
+unsigned
+Ekiga::AudioDSP::peak (const short* samples,
+		       unsigned count)
+{
+  return get_kernels ()->peak (samples, count);
+}
+
+unsigned
+Ekiga::AudioDSP::clip_count (const short* samples,
+			     unsigned count,
+			     short threshold)
+{
+  g_return_val_if_fail (threshold > 0, 0);
+
+  return get_kernels ()->clip_count (samples, count, threshold);
+}
+
+void
+Ekiga::AudioDSP::apply_gain (short* samples,
+			     unsigned count,
+			     float gain)
+{
+  get_kernels ()->apply_gain (samples, count, gain);
+}
+
+void
+Ekiga::AudioDSP::mix (short* dest,
+		      const short* src,
+		      unsigned count,
+		      float gain)
+{
+  get_kernels ()->mix (dest, src, count, gain);
+}
+
+void
+Ekiga::AudioDSP::int16_to_float (const short* src,
+				 float* dest,
+				 unsigned count)
+{
+  get_kernels ()->int16_to_float (src, dest, count);
+}
+
+void
+Ekiga::AudioDSP::float_to_int16 (const float* src,
+				 short* dest,
+				 unsigned count)
+{
+  get_kernels ()->float_to_int16 (src, dest, count);
+}
+
+float
+Ekiga::AudioDSP::dot (const float* a,
+		      const float* b,
+		      unsigned count)
+{
+  return get_kernels ()->dot (a, b, count);
+}
@@ -0,0 +1,100 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         audio-dsp.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : small signal processing kernels on 16 bits
+ *                          samples, shared by the audio stacks
+ *
+ */
+
+#ifndef __AUDIO_DSP_H__
+#define __AUDIO_DSP_H__
+
+#include <glib.h>
+
+namespace Ekiga
+{
+
+  /**
+   * @addtogroup services
+   * @{
+   */
+
+  /* All the functions work on native-endian signed 16 bits samples, and
+   * saturate instead of wrapping around. The best implementation available
+   * on the running CPU (AVX2, SSE2 or plain C) is picked on first use ;
+   * all of them give exactly the same results.
+   */
+  namespace AudioDSP
+  {
+    /* Returns the name of the implementation in use ("avx2", "sse2", "c") */
+    const char* get_implementation ();
+
+    /* Forces the named implementation instead of the detected one ; returns
+     * false if it isn't available on the running CPU. Meant for the checks
+     * and benchmarks comparing the implementations.
+     */
+    bool set_implementation (const char* name);
+
+    /* Returns the sum of the absolute values of the samples */
+    guint64 abs_sum (const short* samples, unsigned count);
+
+    /* Returns the sum of the squares of the samples */
+    guint64 square_sum (const short* samples, unsigned count);
+
+    /* Returns the root mean square of the samples (0..32768) */
+    double rms (const short* samples, unsigned count);
+
+    /* Returns the largest absolute value of the samples (0..32768) */
+    unsigned peak (const short* samples, unsigned count);
+
+    /* Returns how many samples have an absolute value of at least threshold
+     * (1..32767) */
+    unsigned clip_count (const short* samples, unsigned count, short threshold = 32767);
+
+    /* Multiplies the samples by gain in place */
+    void apply_gain (short* samples, unsigned count, float gain);
+
+    /* Adds the src samples multiplied by gain to the dest samples */
+    void mix (short* dest, const short* src, unsigned count, float gain = 1.0f);
+
+    /* Converts between 16 bits samples and floats in the [-1, 1[ range */
+    void int16_to_float (const short* src, float* dest, unsigned count);
+    void float_to_int16 (const float* src, short* dest, unsigned count);
+
+    /* Returns the sum of the a[i] * b[i] (used for FIR filtering) */
+    float dot (const float* a, const float* b, unsigned count);
+  };
+
+  /**
+   * @}
+   */
+};
+
+#endif
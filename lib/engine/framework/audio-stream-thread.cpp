@@ -0,0 +1,118 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         audio-stream-thread.cpp  -  description
+ *                         ---------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Implementation of a thread moving audio chunks
+ *                          between a device and a lock-free ring.
+ *
+ */
+
+#include "audio-stream-thread.h"
+
+using namespace Ekiga;
+
+AudioStreamThread::AudioStreamThread (const char* name)
+: PThread (1000, NoAutoDeleteThread, HighestPriority, name)
+{
+  overruns = 0;
+  underruns = 0;
+  chunk = NULL;
+  chunk_size = 0;
+  end_thread = false;
+  running = 0;
+
+  // Since windows does not like to restart a thread that
+  // was never started, we do so here
+  this->Resume ();
+  thread_created.Wait ();
+}
+
+AudioStreamThread::~AudioStreamThread ()
+{
+  quit ();
+  g_free (chunk);
+}
+
+void AudioStreamThread::quit ()
+{
+  end_thread = true;
+  g_atomic_int_set (&running, 0);
+  run_thread.Signal ();
+
+  /* Wait for the Main () method to be terminated */
+  PWaitAndSignal m(thread_ended);
+}
+
+void AudioStreamThread::start (unsigned _chunk_size,
+                               unsigned ring_size)
+{
+  stop ();
+
+  /* The thread is idle : we can safely touch the ring and the chunk */
+  chunk_size = _chunk_size;
+  chunk = (char*) g_realloc (chunk, chunk_size);
+  ring.resize (ring_size);
+  g_atomic_int_set (&overruns, 0);
+  g_atomic_int_set (&underruns, 0);
+
+  g_atomic_int_set (&running, 1);
+  run_thread.Signal ();
+}
+
+void AudioStreamThread::stop ()
+{
+  if (!is_running ())
+    return;
+
+  g_atomic_int_set (&running, 0);
+  stopped.Wait ();
+}
+
+void AudioStreamThread::Main ()
+{
+  PWaitAndSignal m(thread_ended);
+
+  thread_created.Signal ();
+
+  while (!end_thread) {
+
+    run_thread.Wait ();
+
+    while (!end_thread && is_running ())
+      process_chunk ();
+
+    stopped.Signal ();
+  }
+}
+
+void AudioStreamThread::Terminate ()
+{
+  quit ();
+}
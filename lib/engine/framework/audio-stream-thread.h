@@ -0,0 +1,122 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         audio-stream-thread.h  -  description
+ *                         -------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Declaration of a thread moving audio chunks
+ *                          between a device and a lock-free ring.
+ *
+ */
+
+#ifndef __AUDIO_STREAM_THREAD_H__
+#define __AUDIO_STREAM_THREAD_H__
+
+#include "ring-buffer.h"
+
+#include <glib.h>
+#include <ptlib.h>
+
+namespace Ekiga
+{
+
+  /**
+   * @addtogroup services
+   * @{
+   */
+
+  /* What the capture and playout threads of the audio cores have in
+   * common : a thread which sleeps until it is started, then calls
+   * process_chunk () in a loop until it is stopped, with a ring between
+   * it and the streaming thread and a chunk buffer of its own.
+   *
+   * start () and stop () must not be called with the core mutex held, as
+   * process_chunk () needs it. Subclasses must call quit () in their
+   * destructor, so that process_chunk () is never called on a half
+   * destroyed object.
+   */
+  class AudioStreamThread : public PThread
+  {
+    PCLASSINFO(AudioStreamThread, PThread);
+
+  public:
+    AudioStreamThread (const char* name);
+    ~AudioStreamThread ();
+    void quit ();
+
+    bool is_running () const
+      { return g_atomic_int_get (&running) != 0; }
+
+    /** Returns how many times data had to be dropped
+     */
+    unsigned get_overruns () const
+      { return (unsigned) g_atomic_int_get (&overruns); }
+
+    /** Returns how many times silence had to be made up
+     */
+    unsigned get_underruns () const
+      { return (unsigned) g_atomic_int_get (&underruns); }
+
+  protected:
+    /* Stops the thread if needed, then (re)sizes the ring and the chunk
+     * and starts calling process_chunk () */
+    void start (unsigned chunk_size, unsigned ring_size);
+
+    /* Waits until process_chunk () isn't called anymore */
+    void stop ();
+
+    virtual void process_chunk () = 0;
+
+    void Main (void);
+    void Terminate ();
+
+    PSyncPoint data_available;
+
+    volatile gint overruns;
+    volatile gint underruns;
+
+    RingBuffer ring;
+    char* chunk;
+    unsigned chunk_size;
+
+  private:
+    PSyncPoint run_thread;
+    PSyncPoint stopped;
+    bool end_thread;
+
+    PMutex thread_ended;
+    PSyncPoint thread_created;
+
+    volatile gint running;
+  };
+
+  /**
+   * @}
+   */
+};
+#endif
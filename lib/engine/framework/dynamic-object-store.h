@@ -42,6 +42,8 @@
 
 #include <boost/smart_ptr.hpp>
 #include <typeinfo>
+#include <list>
+#include <set>
 
 #include "map-key-iterator.h"
 #include "map-key-const-iterator.h"
@@ -57,6 +59,9 @@ namespace Ekiga
     typedef std::map<boost::shared_ptr<ObjectType>, boost::shared_ptr<scoped_connections> > container_type;
     typedef Ekiga::map_key_iterator<container_type> iterator;
     typedef Ekiga::map_key_const_iterator<container_type> const_iterator;
+    typedef std::list<boost::shared_ptr<ObjectType> > objects_list;
+
+    DynamicObjectStore ();
 
     ~DynamicObjectStore ();
 
@@ -73,6 +78,17 @@ namespace Ekiga
 
     int size () const;
 
+    /* Between begin_bulk and commit_bulk, object_added and object_removed
+     * aren't emitted, and neither is object_updated for the objects added
+     * in the meantime : commit_bulk emits objects_changed once with the
+     * added objects, in the order they were added, and the removed objects.
+     * So what listens to object_added and object_removed must listen to
+     * objects_changed too. Calls can be nested.
+     */
+    void begin_bulk ();
+
+    void commit_bulk ();
+
     iterator begin ();
     iterator end ();
 
@@ -83,13 +99,31 @@ namespace Ekiga
     boost::signals2::signal<void(boost::shared_ptr<ObjectType>)> object_removed;
     boost::signals2::signal<void(boost::shared_ptr<ObjectType>)> object_updated;
 
+    /* the added objects, then the removed objects */
+    boost::signals2::signal<void(const objects_list&, const objects_list&)> objects_changed;
+
   private:
+    void on_object_updated (boost::shared_ptr<ObjectType> obj);
+
     container_type objects;
+
+    unsigned int bulk_depth;
+    /* the objects added in the bulk and still there, and the order they
+     * were added in (which can list removed objects) */
+    std::set<boost::shared_ptr<ObjectType> > bulk_added;
+    objects_list bulk_added_order;
+    objects_list bulk_removed;
   };
 
 };
 
 
+template<typename ObjectType>
+Ekiga::DynamicObjectStore<ObjectType>::DynamicObjectStore (): bulk_depth(0)
+{
+}
+
+
 template<typename ObjectType>
 Ekiga::DynamicObjectStore<ObjectType>::~DynamicObjectStore ()
 {
@@ -114,9 +148,14 @@ Ekiga::DynamicObjectStore<ObjectType>::add_object (boost::shared_ptr<ObjectType>
   typename container_type::iterator iter = objects.find (obj);
   if (iter == objects.end ()) {
     objects[obj] = boost::shared_ptr<scoped_connections> (new scoped_connections);
-    object_added (obj);
+    if (bulk_depth > 0) {
+
+      if (bulk_added.insert (obj).second)
+        bulk_added_order.push_back (obj);
+    } else
+      object_added (obj);
 
-    objects[obj]->add (obj->updated.connect (boost::bind (boost::ref (object_updated), _1)));
+    objects[obj]->add (obj->updated.connect (boost::bind (&Ekiga::DynamicObjectStore<ObjectType>::on_object_updated, this, _1)));
     // this must be the last slot to execute
     // the other slots connecting to removed signal must add at_front parameter
     // in boost signals2 it is not possible to specify a slot to be executed last when the following slots are added without parameter
@@ -139,10 +178,26 @@ template<typename ObjectType>
 void
 Ekiga::DynamicObjectStore<ObjectType>::remove_object (boost::shared_ptr<ObjectType> obj)
 {
-  object_removed (obj);
+  if (bulk_depth > 0) {
+
+    if (bulk_added.erase (obj) == 0)
+      bulk_removed.push_back (obj);
+  }
+  else
+    object_removed (obj);
   objects.erase (objects.find (obj));
 }
 
+template<typename ObjectType>
+void
+Ekiga::DynamicObjectStore<ObjectType>::on_object_updated (boost::shared_ptr<ObjectType> obj)
+{
+  if (bulk_depth > 0 && bulk_added.find (obj) != bulk_added.end ())
+    return;
+
+  object_updated (obj);
+}
+
 template<typename ObjectType>
 void
 Ekiga::DynamicObjectStore<ObjectType>::remove_all_objects ()
@@ -159,6 +214,37 @@ Ekiga::DynamicObjectStore<ObjectType>::size () const
   return objects.size ();
 }
 
+template<typename ObjectType>
+void
+Ekiga::DynamicObjectStore<ObjectType>::begin_bulk ()
+{
+  bulk_depth++;
+}
+
+template<typename ObjectType>
+void
+Ekiga::DynamicObjectStore<ObjectType>::commit_bulk ()
+{
+  if (bulk_depth == 0 || --bulk_depth > 0)
+    return;
+
+  objects_list added;
+  objects_list removed;
+
+  for (typename objects_list::iterator iter = bulk_added_order.begin ();
+       iter != bulk_added_order.end ();
+       ++iter)
+    if (bulk_added.erase (*iter) > 0)
+      added.push_back (*iter);
+  bulk_added_order.clear ();
+  removed.swap (bulk_removed);
+
+  if (added.empty () && removed.empty ())
+    return;
+
+  objects_changed (added, removed);
+}
+
 template<typename ObjectType>
 typename Ekiga::DynamicObjectStore<ObjectType>::iterator
 Ekiga::DynamicObjectStore<ObjectType>::begin ()
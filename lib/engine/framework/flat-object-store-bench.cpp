@@ -0,0 +1,274 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         flat-object-store-bench.cpp  -  description
+ *                         -------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Checks that FlatObjectStore behaves as
+ *                          DynamicObjectStore, and times them ; times
+ *                          loading a roster with and without a bulk.
+ *
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#include <glib.h>
+
+#include "dynamic-object.h"
+#include "dynamic-object-store.h"
+#include "flat-object-store.h"
+
+#define OBJECTS 10000
+#define ROUNDS 20
+
+#define ROSTER 5000
+#define VISIBLE_ROWS 50
+
+/* there's no main loop here : everything runs in the main thread */
+bool
+Ekiga::Runtime::is_main_thread ()
+{
+  return true;
+}
+
+class Object: public Ekiga::DynamicObject<Object>
+{
+public:
+
+  static boost::shared_ptr<Object> create (unsigned int value)
+  {
+    boost::shared_ptr<Object> result (new Object);
+    result->value = value;
+    return result;
+  }
+
+  unsigned int value;
+};
+
+typedef boost::shared_ptr<Object> ObjectPtr;
+
+struct Times
+{
+  double add;
+  double visit;
+  double remove;
+  double removed_signal;
+  guint64 visited;
+};
+
+static bool
+sum_values (guint64* sum,
+	    ObjectPtr obj)
+{
+  *sum += obj->value;
+  return true;
+}
+
+static void
+shuffle (std::vector<ObjectPtr>& objects,
+	 guint32 seed)
+{
+  GRand* rand = g_rand_new_with_seed (seed);
+
+  for (unsigned ii = objects.size () - 1; ii > 0; ii--)
+    objects[ii].swap (objects[g_rand_int_range (rand, 0, ii + 1)]);
+
+  g_rand_free (rand);
+}
+
+template<typename Store>
+static bool
+run (const std::vector<ObjectPtr>& objects,
+     Times& times)
+{
+  std::vector<ObjectPtr> order (objects);
+  bool success = true;
+  Store store;
+  GTimer* timer = g_timer_new ();
+
+  times.add = times.visit = times.remove = times.removed_signal = 0;
+  times.visited = 0;
+
+  shuffle (order, 4242);
+
+  for (unsigned round = 0; round < ROUNDS; round++) {
+
+    g_timer_start (timer);
+    for (unsigned ii = 0; ii < objects.size (); ii++)
+      store.add_object (objects[ii]);
+    times.add += g_timer_elapsed (timer, NULL);
+
+    success = success && (store.size () == (int) objects.size ());
+
+    guint64 sum = 0;
+    g_timer_start (timer);
+    store.visit_objects (boost::bind (&sum_values, &sum, _1));
+    times.visit += g_timer_elapsed (timer, NULL);
+    times.visited += sum;
+
+    // half through remove_object, half through the objects' own signal
+    g_timer_start (timer);
+    for (unsigned ii = 0; ii < order.size () / 2; ii++)
+      store.remove_object (order[ii]);
+    times.remove += g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    for (unsigned ii = order.size () / 2; ii < order.size (); ii++)
+      order[ii]->removed (order[ii]);
+    times.removed_signal += g_timer_elapsed (timer, NULL);
+
+    success = success && (store.size () == 0);
+  }
+
+  g_timer_destroy (timer);
+
+  return success;
+}
+
+/* what a roster view does : keep the rows sorted, and redraw the visible
+ * ones when something changed */
+struct View
+{
+  std::vector<unsigned int> rows;
+  guint64 drawn;
+
+  View (): drawn(0)
+  {}
+
+  void redraw ()
+  {
+    for (unsigned ii = 0; ii < rows.size () && ii < VISIBLE_ROWS; ii++)
+      drawn += rows[ii];
+  }
+
+  void on_added (ObjectPtr obj)
+  {
+    rows.insert (std::lower_bound (rows.begin (), rows.end (), obj->value), obj->value);
+    redraw ();
+  }
+
+  void on_changed (const std::list<ObjectPtr>& added,
+		   const std::list<ObjectPtr>& /*removed*/)
+  {
+    for (std::list<ObjectPtr>::const_iterator iter = added.begin ();
+	 iter != added.end ();
+	 ++iter)
+      rows.push_back ((*iter)->value);
+    std::sort (rows.begin (), rows.end ());
+    redraw ();
+  }
+};
+
+/* loads a roster in a store a view already listens to, as Opal::Account
+ * does, in one bulk or one object at a time */
+static double
+load_roster (const std::vector<ObjectPtr>& roster,
+	     bool bulk,
+	     std::vector<unsigned int>& rows)
+{
+  Ekiga::FlatObjectStore<Object> store;
+  View view;
+  GTimer* timer = g_timer_new ();
+
+  store.object_added.connect (boost::bind (&View::on_added, &view, _1));
+  store.objects_changed.connect (boost::bind (&View::on_changed, &view, _1, _2));
+
+  g_timer_start (timer);
+  if (bulk)
+    store.begin_bulk (roster.size ());
+  for (unsigned ii = 0; ii < roster.size (); ii++)
+    store.add_object (roster[ii]);
+  if (bulk)
+    store.commit_bulk ();
+  double elapsed = g_timer_elapsed (timer, NULL);
+
+  g_timer_destroy (timer);
+  rows.swap (view.rows);
+
+  return elapsed;
+}
+
+static void
+print (const char* name,
+       const Times& times)
+{
+  printf ("%-20s add %8.3f ms  visit %8.3f ms  remove %8.3f ms  removed signal %8.3f ms\n",
+	  name,
+	  times.add * 1e3 / ROUNDS, times.visit * 1e3 / ROUNDS,
+	  times.remove * 1e3 / ROUNDS, times.removed_signal * 1e3 / ROUNDS);
+}
+
+int
+main (int /*argc*/,
+      char** /*argv*/)
+{
+  std::vector<ObjectPtr> objects;
+  Times dynamic_times;
+  Times flat_times;
+  bool success = true;
+
+  for (unsigned ii = 0; ii < OBJECTS; ii++)
+    objects.push_back (Object::create (ii));
+
+  success = run<Ekiga::DynamicObjectStore<Object> > (objects, dynamic_times) && success;
+  success = run<Ekiga::FlatObjectStore<Object> > (objects, flat_times) && success;
+  success = success && (dynamic_times.visited == flat_times.visited);
+
+  printf ("%u objects, average of %u rounds\n", OBJECTS, ROUNDS);
+  print ("DynamicObjectStore", dynamic_times);
+  print ("FlatObjectStore", flat_times);
+
+  std::vector<ObjectPtr> roster;
+  std::vector<unsigned int> single_rows;
+  std::vector<unsigned int> bulk_rows;
+  double single_time = 0;
+  double bulk_time = 0;
+  GRand* rand = g_rand_new_with_seed (42);
+
+  for (unsigned ii = 0; ii < ROSTER; ii++)
+    roster.push_back (Object::create (g_rand_int (rand)));
+  g_rand_free (rand);
+
+  for (unsigned round = 0; round < ROUNDS; round++) {
+
+    single_time += load_roster (roster, false, single_rows);
+    bulk_time += load_roster (roster, true, bulk_rows);
+  }
+  success = success && (single_rows == bulk_rows);
+
+  printf ("%u presentities roster loaded in a view, average of %u rounds\n", ROSTER, ROUNDS);
+  printf ("%-20s %8.3f ms\n", "one by one", single_time * 1e3 / ROUNDS);
+  printf ("%-20s %8.3f ms\n", "in one bulk", bulk_time * 1e3 / ROUNDS);
+
+  if ( !success)
+    printf ("THE STORES DIDN'T BEHAVE THE SAME\n");
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,580 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2009 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         flat-object-store.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : declaration of an object able to store objects,
+ *                          contiguously
+ *
+ */
+
+#ifndef __FLAT_OBJECT_STORE_H__
+#define __FLAT_OBJECT_STORE_H__
+
+#include <list>
+#include <vector>
+
+#include <boost/signals2.hpp>
+#include <boost/bind.hpp>
+#include <boost/smart_ptr.hpp>
+
+#include "light-signal.h"
+
+namespace Ekiga
+{
+  /* This has the same api as DynamicObjectStore, but keeps the objects and
+   * the connections to them side by side in a vector instead of in a map of
+   * heap-allocated scoped_connections : adding and removing an object are
+   * O(1), and visiting the objects goes through contiguous memory. Finding
+   * an object goes through an open-addressing table, so an object only
+   * costs an allocation if add_connection is used on it.
+   *
+   * The objects aren't kept in any particular order : removing one moves the
+   * last one to its place. So each object also gets a handle, which doesn't
+   * change as long as the object stays in the store (and which can be given
+   * to another object after that). Handles are never 0.
+   *
+   * As with DynamicObjectStore, adding or removing objects invalidates the
+   * iterators, and removing objects from a visitor can make it miss some.
+   *
+   * Its own signals are light signals : it must live in the main thread.
+   *
+   * Between begin_bulk and commit_bulk, object_added and object_removed
+   * aren't emitted, and neither is object_updated for the objects added in
+   * the meantime : commit_bulk emits objects_changed once, with the objects
+   * added, in the order they were added, and the objects removed (an
+   * object added then removed isn't reported at all). So what listens to
+   * object_added and object_removed must listen to objects_changed too.
+   */
+  template<typename ObjectType>
+  class FlatObjectStore
+  {
+    struct slot
+    {
+      boost::shared_ptr<ObjectType> object;
+      /* to the updated and removed signals of the object */
+      boost::signals2::connection own_connections[2];
+      /* from add_connection */
+      std::vector<boost::signals2::connection> connections;
+      unsigned int handle;
+      unsigned int entry; // in the index
+      bool bulk_added;
+    };
+
+    /* an entry of a removed object keeps its key but gets handle 0, so the
+     * lookups go on past it ; an entry never used has a NULL key */
+    struct index_entry
+    {
+      const ObjectType* key;
+      unsigned int handle;
+    };
+
+    typedef std::vector<slot> container_type;
+
+  public:
+
+    typedef unsigned int handle_type;
+
+    class iterator: public std::forward_iterator_tag
+    {
+    public:
+
+      iterator (typename container_type::iterator it_): it(it_)
+      {}
+
+      bool operator== (const iterator& other) const
+      { return it == other.it; }
+
+      bool operator!= (const iterator& other) const
+      { return it != other.it; }
+
+      iterator& operator++ ()
+      { ++it; return *this; }
+
+      iterator operator++ (int)
+      { iterator tmp = *this; ++it; return tmp; }
+
+      boost::shared_ptr<ObjectType> operator* ()
+      { return it->object; }
+
+      boost::shared_ptr<ObjectType>* operator-> ()
+      { return &it->object; }
+
+    private:
+      typename container_type::iterator it;
+    };
+
+    class const_iterator: public std::forward_iterator_tag
+    {
+    public:
+
+      const_iterator (typename container_type::const_iterator it_): it(it_)
+      {}
+
+      bool operator== (const const_iterator& other) const
+      { return it == other.it; }
+
+      bool operator!= (const const_iterator& other) const
+      { return it != other.it; }
+
+      const_iterator& operator++ ()
+      { ++it; return *this; }
+
+      const_iterator operator++ (int)
+      { const_iterator tmp = *this; ++it; return tmp; }
+
+      boost::shared_ptr<ObjectType> operator* ()
+      { return it->object; }
+
+      const boost::shared_ptr<ObjectType>* operator-> ()
+      { return &it->object; }
+
+    private:
+      typename container_type::const_iterator it;
+    };
+
+    typedef std::list<boost::shared_ptr<ObjectType> > objects_list;
+
+    FlatObjectStore ();
+
+    ~FlatObjectStore ();
+
+    void visit_objects (boost::function1<bool, boost::shared_ptr<ObjectType> > visitor) const;
+
+    handle_type add_object (boost::shared_ptr<ObjectType> obj);
+
+    void add_connection (boost::shared_ptr<ObjectType> obj,
+			 boost::signals2::connection connection);
+
+    void remove_object (boost::shared_ptr<ObjectType> obj);
+
+    void remove_all_objects ();
+
+    int size () const;
+
+    /* expected is how many objects are about to be added (it's only used to
+     * reserve memory) ; calls can be nested */
+    void begin_bulk (unsigned int expected = 0);
+
+    void commit_bulk ();
+
+    /* 0 if the object isn't in the store */
+    handle_type get_handle (boost::shared_ptr<ObjectType> obj) const;
+
+    /* empty if there's no such object anymore */
+    boost::shared_ptr<ObjectType> get_object (handle_type handle) const;
+
+    iterator begin ();
+    iterator end ();
+
+    const_iterator begin () const;
+    const_iterator end () const;
+
+    Ekiga::light_signal<void(boost::shared_ptr<ObjectType>)> object_added;
+    Ekiga::light_signal<void(boost::shared_ptr<ObjectType>)> object_removed;
+    Ekiga::light_signal<void(boost::shared_ptr<ObjectType>)> object_updated;
+
+    /* the added objects, then the removed objects */
+    Ekiga::light_signal<void(const objects_list&, const objects_list&)> objects_changed;
+
+  private:
+
+    void erase (unsigned int position);
+
+    void on_object_updated (boost::shared_ptr<ObjectType> obj);
+
+    /* the entry of the object in the index if it's there, or the entry to
+     * use to add it ; the index mustn't be empty */
+    unsigned int find_entry (const ObjectType* key) const;
+
+    /* makes sure that many objects can be added without the index getting
+     * too full */
+    void reserve_index (unsigned int expected);
+
+    static std::size_t hash (const ObjectType* key);
+
+    container_type objects;
+
+    /* handle - 1 -> position in objects, for the handles in use */
+    std::vector<unsigned int> positions;
+    std::vector<handle_type> free_handles;
+
+    /* object -> handle, its size is a power of two */
+    std::vector<index_entry> index;
+    unsigned int index_used; // entries with a key
+
+    unsigned int bulk_depth;
+    std::vector<handle_type> bulk_added;
+    objects_list bulk_removed;
+  };
+
+};
+
+
+template<typename ObjectType>
+Ekiga::FlatObjectStore<ObjectType>::FlatObjectStore (): index_used(0), bulk_depth(0)
+{
+}
+
+
+template<typename ObjectType>
+Ekiga::FlatObjectStore<ObjectType>::~FlatObjectStore ()
+{
+  for (typename container_type::iterator iter = objects.begin ();
+       iter != objects.end ();
+       ++iter) {
+
+    iter->own_connections[0].disconnect ();
+    iter->own_connections[1].disconnect ();
+    for (unsigned int ii = 0; ii < iter->connections.size (); ii++)
+      iter->connections[ii].disconnect ();
+  }
+}
+
+
+template<typename ObjectType>
+void
+Ekiga::FlatObjectStore<ObjectType>::visit_objects (boost::function1<bool, boost::shared_ptr<ObjectType> > visitor) const
+{
+  bool go_on = true;
+  for (unsigned int ii = 0; go_on && ii < objects.size (); ii++)
+    go_on = visitor (objects[ii].object);
+}
+
+template<typename ObjectType>
+typename Ekiga::FlatObjectStore<ObjectType>::handle_type
+Ekiga::FlatObjectStore<ObjectType>::add_object (boost::shared_ptr<ObjectType> obj)
+{
+  reserve_index (1);
+
+  unsigned int entry = find_entry (obj.get ());
+  handle_type handle = index[entry].handle;
+
+  if (handle != 0)
+    return handle;
+
+  if (free_handles.empty ()) {
+
+    positions.push_back (0);
+    handle = positions.size ();
+  } else {
+
+    handle = free_handles.back ();
+    free_handles.pop_back ();
+  }
+
+  if (index[entry].key == NULL)
+    index_used++;
+  index[entry].key = obj.get ();
+  index[entry].handle = handle;
+
+  positions[handle - 1] = objects.size ();
+  objects.push_back (slot ());
+  objects.back ().object = obj;
+  objects.back ().handle = handle;
+  objects.back ().entry = entry;
+  objects.back ().bulk_added = (bulk_depth > 0);
+
+  if (bulk_depth > 0)
+    bulk_added.push_back (handle);
+  else
+    object_added (obj);
+
+  // a slot of object_added could have removed it already
+  if (get_object (handle) == obj) {
+
+    slot& added = objects[positions[handle - 1]];
+
+    added.own_connections[0] = obj->updated.connect (boost::bind (&Ekiga::FlatObjectStore<ObjectType>::on_object_updated, this, _1));
+    // this must be the last slot to execute, as in DynamicObjectStore
+    added.own_connections[1] = obj->removed.connect (boost::bind (&Ekiga::FlatObjectStore<ObjectType>::remove_object, this, _1));
+  }
+
+  return handle;
+}
+
+template<typename ObjectType>
+void
+Ekiga::FlatObjectStore<ObjectType>::add_connection (boost::shared_ptr<ObjectType> obj,
+						    boost::signals2::connection connection)
+{
+  handle_type handle = get_handle (obj);
+
+  if (handle == 0)
+    handle = add_object (obj);
+
+  if (get_object (handle) == obj)
+    objects[positions[handle - 1]].connections.push_back (connection);
+  else
+    connection.disconnect ();
+}
+
+template<typename ObjectType>
+void
+Ekiga::FlatObjectStore<ObjectType>::remove_object (boost::shared_ptr<ObjectType> obj)
+{
+  handle_type handle = get_handle (obj);
+
+  if (handle == 0)
+    return;
+
+  if (bulk_depth > 0) {
+
+    if ( !objects[positions[handle - 1]].bulk_added)
+      bulk_removed.push_back (obj);
+    erase (positions[handle - 1]);
+    return;
+  }
+
+  object_removed (obj);
+
+  // a slot of object_removed could have removed it already
+  if (get_object (handle) == obj)
+    erase (positions[handle - 1]);
+}
+
+template<typename ObjectType>
+void
+Ekiga::FlatObjectStore<ObjectType>::on_object_updated (boost::shared_ptr<ObjectType> obj)
+{
+  if (bulk_depth > 0) {
+
+    handle_type handle = get_handle (obj);
+    if (handle != 0 && objects[positions[handle - 1]].bulk_added)
+      return;
+  }
+
+  object_updated (obj);
+}
+
+template<typename ObjectType>
+void
+Ekiga::FlatObjectStore<ObjectType>::erase (unsigned int position)
+{
+  slot& removed = objects[position];
+
+  removed.own_connections[0].disconnect ();
+  removed.own_connections[1].disconnect ();
+  for (unsigned int ii = 0; ii < removed.connections.size (); ii++)
+    removed.connections[ii].disconnect ();
+
+  index[removed.entry].handle = 0;
+  free_handles.push_back (removed.handle);
+
+  if (position + 1 != objects.size ()) {
+
+    slot& last = objects.back ();
+    removed.object.swap (last.object);
+    removed.own_connections[0].swap (last.own_connections[0]);
+    removed.own_connections[1].swap (last.own_connections[1]);
+    removed.connections.swap (last.connections);
+    removed.handle = last.handle;
+    removed.entry = last.entry;
+    removed.bulk_added = last.bulk_added;
+    positions[removed.handle - 1] = position;
+  }
+
+  objects.pop_back ();
+}
+
+template<typename ObjectType>
+void
+Ekiga::FlatObjectStore<ObjectType>::remove_all_objects ()
+{
+  while ( !objects.empty ())
+    remove_object (objects.back ().object);
+}
+
+template<typename ObjectType>
+int
+Ekiga::FlatObjectStore<ObjectType>::size () const
+{
+  return objects.size ();
+}
+
+template<typename ObjectType>
+void
+Ekiga::FlatObjectStore<ObjectType>::begin_bulk (unsigned int expected)
+{
+  bulk_depth++;
+
+  objects.reserve (objects.size () + expected);
+  reserve_index (expected);
+  if (free_handles.size () < expected)
+    positions.reserve (positions.size () + expected - free_handles.size ());
+}
+
+template<typename ObjectType>
+void
+Ekiga::FlatObjectStore<ObjectType>::commit_bulk ()
+{
+  if (bulk_depth == 0 || --bulk_depth > 0)
+    return;
+
+  objects_list added;
+  objects_list removed;
+
+  for (unsigned int ii = 0; ii < bulk_added.size (); ii++) {
+
+    // the handle could have been given to another object since
+    boost::shared_ptr<ObjectType> obj = get_object (bulk_added[ii]);
+    if (obj) {
+
+      slot& added_slot = objects[positions[bulk_added[ii] - 1]];
+      if (added_slot.bulk_added) {
+
+        added_slot.bulk_added = false;
+        added.push_back (obj);
+      }
+    }
+  }
+  bulk_added.clear ();
+  removed.swap (bulk_removed);
+
+  if (added.empty () && removed.empty ())
+    return;
+
+  objects_changed (added, removed);
+}
+
+template<typename ObjectType>
+typename Ekiga::FlatObjectStore<ObjectType>::handle_type
+Ekiga::FlatObjectStore<ObjectType>::get_handle (boost::shared_ptr<ObjectType> obj) const
+{
+  if (index.empty ())
+    return 0;
+
+  // an unused entry has handle 0
+  return index[find_entry (obj.get ())].handle;
+}
+
+template<typename ObjectType>
+boost::shared_ptr<ObjectType>
+Ekiga::FlatObjectStore<ObjectType>::get_object (handle_type handle) const
+{
+  boost::shared_ptr<ObjectType> result;
+
+  if (handle != 0 && handle <= positions.size ()) {
+
+    unsigned int position = positions[handle - 1];
+    if (position < objects.size () && objects[position].handle == handle)
+      result = objects[position].object;
+  }
+
+  return result;
+}
+
+template<typename ObjectType>
+unsigned int
+Ekiga::FlatObjectStore<ObjectType>::find_entry (const ObjectType* key) const
+{
+  unsigned int mask = index.size () - 1;
+  unsigned int entry = hash (key) & mask;
+  unsigned int reusable = index.size ();
+
+  // reserve_index makes sure there's always an entry never used
+  while (index[entry].key != NULL) {
+
+    if (index[entry].handle == 0) {
+
+      if (reusable == index.size ())
+        reusable = entry;
+    } else if (index[entry].key == key)
+      return entry;
+
+    entry = (entry + 1) & mask;
+  }
+
+  return reusable != index.size () ? reusable : entry;
+}
+
+template<typename ObjectType>
+void
+Ekiga::FlatObjectStore<ObjectType>::reserve_index (unsigned int expected)
+{
+  // keep it at most three quarters full
+  if ((index_used + expected) * 4 <= index.size () * 3)
+    return;
+
+  unsigned int wanted = 16;
+  while (wanted * 3 < (objects.size () + expected) * 4)
+    wanted *= 2;
+
+  index.assign (wanted, index_entry ());
+  for (unsigned int ii = 0; ii < objects.size (); ii++) {
+
+    unsigned int entry = find_entry (objects[ii].object.get ());
+    index[entry].key = objects[ii].object.get ();
+    index[entry].handle = objects[ii].handle;
+    objects[ii].entry = entry;
+  }
+  index_used = objects.size ();
+}
+
+template<typename ObjectType>
+std::size_t
+Ekiga::FlatObjectStore<ObjectType>::hash (const ObjectType* key)
+{
+  // the low bits of a pointer don't change, and objects allocated one after
+  // the other are often a power of two apart
+  std::size_t bits = reinterpret_cast<std::size_t> (key) >> 4;
+
+  bits *= 2654435761u;
+
+  return bits ^ (bits >> 16);
+}
+
+template<typename ObjectType>
+typename Ekiga::FlatObjectStore<ObjectType>::iterator
+Ekiga::FlatObjectStore<ObjectType>::begin ()
+{
+  return iterator (objects.begin ());
+}
+
+template<typename ObjectType>
+typename Ekiga::FlatObjectStore<ObjectType>::iterator
+Ekiga::FlatObjectStore<ObjectType>::end ()
+{
+  return iterator (objects.end ());
+}
+
+template<typename ObjectType>
+typename Ekiga::FlatObjectStore<ObjectType>::const_iterator
+Ekiga::FlatObjectStore<ObjectType>::begin () const
+{
+  return const_iterator (objects.begin ());
+}
+
+template<typename ObjectType>
+typename Ekiga::FlatObjectStore<ObjectType>::const_iterator
+Ekiga::FlatObjectStore<ObjectType>::end () const
+{
+  return const_iterator (objects.end ());
+}
+
+#endif
@@ -33,16 +33,82 @@
  */
 
 #include "kickstart.h"
+#include "startup-trace.h"
+#include "runtime.h"
 
 #define KICKSTART_DEBUG 0
 
+/* how many sparks can be tried at the same time off the main thread */
+#define KICKSTART_THREADS 4
+
 #include <algorithm>
 
 #if KICKSTART_DEBUG
 #include <iostream>
 #endif
 
-Ekiga::KickStart::KickStart ()
+namespace
+{
+  struct SparkNode
+  {
+    SparkNode (boost::shared_ptr<Ekiga::Spark> spark_):
+      spark(spark_), waiting(0), dropped(false), done(false),
+      result(false), start(0), stop(0)
+    {}
+
+    boost::shared_ptr<Ekiga::Spark> spark;
+    std::list<SparkNode*> dependencies;
+    std::list<SparkNode*> dependents;
+    unsigned int waiting; // dependencies not tried yet
+    bool dropped; // something it requires can't be found
+    bool done;
+    bool result;
+    gint64 start;
+    gint64 stop;
+  };
+
+  struct GraphContext
+  {
+    Ekiga::ServiceCore* core;
+    int* argc;
+    char*** argv;
+    GAsyncQueue* finished;
+  };
+
+  void
+  try_spark (SparkNode* node,
+	     GraphContext* context)
+  {
+    Ekiga::StartupTrace::Span trace (node->spark->get_name (), "spark");
+
+    node->start = g_get_monotonic_time ();
+    node->result = node->spark->try_initialize_more (*context->core,
+						      context->argc,
+						      context->argv);
+    node->stop = g_get_monotonic_time ();
+  }
+
+  void
+  spark_worker (gpointer data,
+		gpointer user_data)
+  {
+    SparkNode* node = (SparkNode*) data;
+    GraphContext* context = (GraphContext*) user_data;
+
+    try_spark (node, context);
+    g_async_queue_push (context->finished, node);
+  }
+
+  bool
+  is_disabled (const std::list<std::string>& disabled,
+	       boost::shared_ptr<Ekiga::Spark> spark)
+  {
+    return std::find (disabled.begin (), disabled.end (), spark->get_name ())
+      != disabled.end ();
+  }
+};
+
+Ekiga::KickStart::KickStart (): critical_time(0)
 {
 }
 
@@ -79,13 +145,18 @@ Ekiga::KickStart::add_spark (boost::shared_ptr<Ekiga::Spark>& spark)
 #endif
 }
 
+void
+Ekiga::KickStart::take_sparks (std::list<boost::shared_ptr<Spark> >& sparks)
+{
+  sparks.splice (sparks.end (), blanks);
+}
+
 void
 Ekiga::KickStart::kick (Ekiga::ServiceCore& core,
 			int* argc,
 			char** argv[])
 {
   std::list<std::string> disabled;
-  bool went_on;
 
   for (int arg = 2; arg <= *argc; arg++) {
 
@@ -104,6 +175,229 @@ Ekiga::KickStart::kick (Ekiga::ServiceCore& core,
     }
   }
 
+  timings.clear ();
+  critical_path.clear ();
+  critical_time = 0;
+
+  kick_graph (core, argc, argv, disabled);
+  kick_loop (core, argc, argv, disabled);
+}
+
+void
+Ekiga::KickStart::kick_graph (Ekiga::ServiceCore& core,
+			      int* argc,
+			      char** argv[],
+			      const std::list<std::string>& disabled)
+{
+  std::list<SparkNode> nodes;
+  std::map<std::string, SparkNode*> providers;
+  gint64 kick_start = g_get_monotonic_time ();
+
+  { // first find the sparks which tell what they provide
+    std::list<boost::shared_ptr<Spark> > temp;
+    temp.swap (blanks);
+
+    for (std::list<boost::shared_ptr<Spark> >::iterator iter = temp.begin ();
+	 iter != temp.end ();
+	 ++iter) {
+
+      std::list<std::string> provides;
+      (*iter)->get_provides (provides);
+
+      if (provides.empty () || is_disabled (disabled, *iter)) {
+
+	blanks.push_back (*iter);
+	continue;
+      }
+
+      nodes.push_back (SparkNode (*iter));
+      for (std::list<std::string>::iterator name = provides.begin ();
+	   name != provides.end ();
+	   ++name)
+	providers[*name] = &nodes.back ();
+    }
+  }
+
+  if (nodes.empty ())
+    return;
+
+  // then link them, leaving out those which require something nobody has
+  bool dropped_some = true;
+  while (dropped_some) {
+
+    dropped_some = false;
+    for (std::list<SparkNode>::iterator node = nodes.begin ();
+	 node != nodes.end ();
+	 ++node) {
+
+      if (node->dropped)
+	continue;
+
+      std::list<std::string> requires;
+      node->spark->get_requires (requires);
+      node->dependencies.clear ();
+
+      for (std::list<std::string>::iterator name = requires.begin ();
+	   name != requires.end () && !node->dropped;
+	   ++name) {
+
+	if (core.get (*name))
+	  continue;
+
+	std::map<std::string, SparkNode*>::iterator provider = providers.find (*name);
+	if (provider != providers.end () && !provider->second->dropped) {
+
+	  if (provider->second != &*node)
+	    node->dependencies.push_back (provider->second);
+	} else {
+
+#if KICKSTART_DEBUG
+	  std::cout << "KickStart(kick_graph): " << node->spark->get_name ()
+		    << " requires " << *name << ", which nobody provides"
+		    << std::endl;
+#endif
+	  node->dropped = true;
+	  dropped_some = true;
+	}
+      }
+    }
+  }
+
+  for (std::list<SparkNode>::iterator node = nodes.begin ();
+       node != nodes.end ();
+       ++node) {
+
+    if (node->dropped)
+      continue;
+
+    node->waiting = node->dependencies.size ();
+    for (std::list<SparkNode*>::iterator dep = node->dependencies.begin ();
+	 dep != node->dependencies.end ();
+	 ++dep)
+      (*dep)->dependents.push_back (&*node);
+  }
+
+  // now try them : a spark is tried when all the sparks it depends on were
+  GraphContext context = { &core, argc, argv, g_async_queue_new () };
+  GThreadPool* pool = g_thread_pool_new (spark_worker, &context,
+					 KICKSTART_THREADS, FALSE, NULL);
+  std::list<SparkNode*> ready; // those which must be tried on this thread
+  unsigned int running = 0; // those tried on the worker threads
+
+  for (std::list<SparkNode>::iterator node = nodes.begin ();
+       node != nodes.end ();
+       ++node) {
+
+    if (node->dropped || node->waiting > 0)
+      continue;
+
+    if (node->spark->main_thread_only ()) {
+
+      ready.push_back (&*node);
+    } else {
+
+      running++;
+      g_thread_pool_push (pool, &*node, NULL);
+    }
+  }
+
+  while (!ready.empty () || running > 0) {
+
+    SparkNode* node = (SparkNode*) g_async_queue_try_pop (context.finished);
+
+    if (node != NULL) {
+
+      running--;
+    } else if ( !ready.empty ()) {
+
+      node = ready.front ();
+      ready.pop_front ();
+      try_spark (node, &context);
+    } else {
+
+      node = (SparkNode*) g_async_queue_pop (context.finished);
+      running--;
+    }
+
+    node->done = true;
+    timings[node->spark->get_name ()] += node->stop - node->start;
+
+    if (node->result) {
+
+      Ekiga::StartupTrace::Span trace (node->spark->get_name () + " (finish)", "spark");
+      node->spark->finish_initialization (core);
+#if KICKSTART_DEBUG
+      std::cout << "KickStart(kick_graph): " << node->spark->get_name ()
+		<< " took " << (node->stop - node->start) / 1000 << " ms"
+		<< std::endl;
+#endif
+    }
+
+    for (std::list<SparkNode*>::iterator dep = node->dependents.begin ();
+	 dep != node->dependents.end ();
+	 ++dep) {
+
+      if (--(*dep)->waiting > 0)
+	continue;
+
+      if ((*dep)->spark->main_thread_only ()) {
+
+	ready.push_back (*dep);
+      } else {
+
+	running++;
+	g_thread_pool_push (pool, *dep, NULL);
+      }
+    }
+  }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_async_queue_unref (context.finished);
+
+  // what didn't go all the way (including dependency cycles) goes back to
+  // the loop
+  SparkNode* last = NULL;
+  for (std::list<SparkNode>::iterator node = nodes.begin ();
+       node != nodes.end ();
+       ++node) {
+
+    if (node->done && (last == NULL || node->stop > last->stop))
+      last = &*node;
+
+    if ( !node->done || !node->result)
+      blanks.push_back (node->spark);
+    else if (node->spark->get_state () == Spark::PARTIAL)
+      partials.push_back (node->spark);
+    else if (node->spark->get_state () == Spark::BLANK)
+      blanks.push_back (node->spark); // shouldn't happen!
+  }
+
+  // the critical path ends with the last spark done, and goes back through
+  // the dependency each spark waited for the longest
+  if (last != NULL)
+    critical_time = last->stop - kick_start;
+
+  while (last != NULL) {
+
+    SparkNode* previous = NULL;
+    critical_path.push_front (last->spark->get_name ());
+    for (std::list<SparkNode*>::iterator dep = last->dependencies.begin ();
+	 dep != last->dependencies.end ();
+	 ++dep)
+      if ((*dep)->done && (previous == NULL || (*dep)->stop > previous->stop))
+	previous = *dep;
+    last = previous;
+  }
+}
+
+void
+Ekiga::KickStart::kick_loop (Ekiga::ServiceCore& core,
+			     int* argc,
+			     char** argv[],
+			     const std::list<std::string>& disabled)
+{
+  bool went_on;
+
   // this makes sure we loop only if something needs to be done
   went_on = !(blanks.empty () && partials.empty ());
 
@@ -126,11 +420,12 @@ Ekiga::KickStart::kick (Ekiga::ServiceCore& core,
 	   ++iter) {
 
 	bool result = false;
-	if (std::find (disabled.begin (),
-		       disabled.end (), (*iter)->get_name ())
-	    == disabled.end ()) {
+	if ( !is_disabled (disabled, *iter)) {
 
+	  Ekiga::StartupTrace::Span trace ((*iter)->get_name (), "spark");
+	  gint64 start = g_get_monotonic_time ();
 	  result = (*iter)->try_initialize_more (core, argc, argv);
+	  timings[(*iter)->get_name ()] += g_get_monotonic_time () - start;
 	} else {
 
 #if KICKSTART_DEBUG
@@ -142,6 +437,7 @@ Ekiga::KickStart::kick (Ekiga::ServiceCore& core,
 	if (result) {
 
 	  went_on = true;
+	  (*iter)->finish_initialization (core);
 	  switch ((*iter)->get_state ()) {
 
 	  case Spark::BLANK:
@@ -203,11 +499,15 @@ Ekiga::KickStart::kick (Ekiga::ServiceCore& core,
 	   iter != temp.end ();
 	   ++iter) {
 
+	Ekiga::StartupTrace::Span trace ((*iter)->get_name (), "spark");
+	gint64 start = g_get_monotonic_time ();
 	bool result = (*iter)->try_initialize_more (core, argc, argv);
+	timings[(*iter)->get_name ()] += g_get_monotonic_time () - start;
 
 	if (result) {
 
 	  went_on = true;
+	  (*iter)->finish_initialization (core);
 	  switch ((*iter)->get_state ()) {
 
 	  case Spark::BLANK:
@@ -256,3 +556,19 @@ Ekiga::KickStart::kick (Ekiga::ServiceCore& core,
     }
   }
 }
+
+void
+Ekiga::KickStart::dump (std::ostream& stream) const
+{
+  for (std::map<std::string, gint64>::const_iterator iter = timings.begin ();
+       iter != timings.end ();
+       ++iter)
+    stream << iter->first << ": " << iter->second / 1000 << " ms" << std::endl;
+
+  stream << "Critical path:";
+  for (std::list<std::string>::const_iterator iter = critical_path.begin ();
+       iter != critical_path.end ();
+       ++iter)
+    stream << (iter == critical_path.begin () ? " " : " -> ") << *iter;
+  stream << " (" << critical_time / 1000 << " ms)" << std::endl;
+}
@@ -58,8 +58,28 @@
  * - try_initialize_more shouldn't return 'true' if no new service could be
  * registered ;
  * - states should always evolve as BLANK -> PARTIAL -> FULL : no coming back!
+ *
+ * A spark can also tell which services it provides and which it requires :
+ * the kickstart object then orders those sparks as a dependency graph, and
+ * tries each of them once, as soon as what it requires is there, instead of
+ * looping on all of them. A spark which isn't main_thread_only can even be
+ * tried on a worker thread, concurrently with the other sparks ; it should
+ * then only create its objects and add them to the core (which is safe),
+ * and leave the rest of the wiring to finish_initialization, which is always
+ * called from the main thread. In particular it mustn't build anything
+ * which uses light signals (books, heaps, presentities...) : those check
+ * they're only used from the main thread.
+ *
+ * Sparks which don't declare anything, or which didn't manage to reach the
+ * FULL state that way, go through the good old loop described above.
  */
 
+#include <list>
+#include <map>
+#include <ostream>
+
+#include <glib.h>
+
 #include "services.h"
 
 namespace Ekiga
@@ -79,6 +99,21 @@ namespace Ekiga
 
     // this method is useful for debugging purposes
     virtual const std::string get_name () const = 0;
+
+    /* names of the services this spark adds to the core */
+    virtual void get_provides (std::list<std::string>& /*names*/) const
+    {}
+
+    /* names of the services this spark needs in the core */
+    virtual void get_requires (std::list<std::string>& /*names*/) const
+    {}
+
+    virtual bool main_thread_only () const
+    { return true; }
+
+    /* called on the main thread after a successful try_initialize_more */
+    virtual void finish_initialization (ServiceCore& /*core*/)
+    {}
   };
 
   class KickStart
@@ -91,14 +126,42 @@ namespace Ekiga
 
     void add_spark (boost::shared_ptr<Spark>& spark);
 
+    /* moves the sparks which were never tried to the list : this lets a
+     * kickstart object collect sparks for another one
+     */
+    void take_sparks (std::list<boost::shared_ptr<Spark> >& sparks);
+
     /* try to do more with the known blank/partial sparks */
     void kick (Ekiga::ServiceCore& core,
 	       int* argc,
 	       char** argv[]);
 
+    /* how long each spark took during the last kick, and the chain of
+     * sparks which decided how long it lasted
+     */
+    void dump (std::ostream& stream) const;
+
   private:
+
+    /* sparks with dependencies, tried once each and in parallel */
+    void kick_graph (Ekiga::ServiceCore& core,
+		     int* argc,
+		     char** argv[],
+		     const std::list<std::string>& disabled);
+
+    /* the others, tried until nothing happens anymore */
+    void kick_loop (Ekiga::ServiceCore& core,
+		    int* argc,
+		    char** argv[],
+		    const std::list<std::string>& disabled);
+
     std::list<boost::shared_ptr<Spark> > blanks;
     std::list<boost::shared_ptr<Spark> > partials;
+
+    /* spark name -> time it took, in microseconds */
+    std::map<std::string, gint64> timings;
+    std::list<std::string> critical_path;
+    gint64 critical_time;
   };
 };
 
@@ -0,0 +1,426 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2009 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         light-signal.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : a signal for objects living in the main thread
+ *
+ */
+
+#ifndef __LIGHT_SIGNAL_H__
+#define __LIGHT_SIGNAL_H__
+
+#include <cassert>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/signals2/connection.hpp>
+
+#include "runtime.h"
+
+/* A boost::signals2::signal takes a mutex and allocates when it's emitted,
+ * which shows when the presence and addressbook objects fire thousands of
+ * them while a big roster or addressbook loads. Those are only ever used from
+ * the main thread, so they use this instead : it can be used like a void
+ * boost::signals2::signal with up to three arguments (connect, with
+ * boost::signals2::at_front if needed, emission, boost::ref as a slot of
+ * another signal), but it isn't thread-safe -- debug builds check it's only
+ * used from the main thread -- and emitting it doesn't allocate.
+ *
+ * Slots can connect and disconnect while the signal is emitted : slots
+ * connected then are only called from the next emission on.
+ *
+ * The connections can be stored in Ekiga::scoped_connections.
+ */
+
+namespace Ekiga
+{
+  namespace detail
+  {
+    template<typename Function>
+    struct light_signal_state
+    {
+      /* that many slots fit in the state itself */
+      enum { INLINE_SLOTS = 2 };
+
+      struct slot
+      {
+	unsigned int id; // 0 once disconnected
+	Function function;
+      };
+
+      light_signal_state (): size(0), next_id(1), emitting(0), dirty(false)
+      {}
+
+      slot& at (unsigned int ii)
+      { return ii < INLINE_SLOTS ? inline_slots[ii] : more_slots[ii - INLINE_SLOTS]; }
+
+      unsigned int connect (const Function& function,
+			    bool at_front)
+      {
+	unsigned int id = next_id++;
+
+	if (emitting > 0) {
+
+	  pending.push_back (std::make_pair (at_front, slot ()));
+	  pending.back ().second.id = id;
+	  pending.back ().second.function = function;
+	} else {
+
+	  append (id, function);
+	  if (at_front)
+	    for (unsigned int ii = size - 1; ii > 0; ii--)
+	      swap (at (ii), at (ii - 1));
+	}
+
+	return id;
+      }
+
+      bool connected (unsigned int id)
+      {
+	for (unsigned int ii = 0; ii < size; ii++)
+	  if (at (ii).id == id)
+	    return true;
+	for (unsigned int ii = 0; ii < pending.size (); ii++)
+	  if (pending[ii].second.id == id)
+	    return true;
+	return false;
+      }
+
+      void disconnect (unsigned int id)
+      {
+	for (unsigned int ii = 0; ii < size; ii++)
+	  if (at (ii).id == id) {
+
+	    at (ii).id = 0;
+	    dirty = true;
+	  }
+	for (unsigned int ii = 0; ii < pending.size (); ii++)
+	  if (pending[ii].second.id == id)
+	    pending[ii].second.id = 0;
+
+	if (emitting == 0)
+	  cleanup ();
+      }
+
+      void disconnect_all ()
+      {
+	for (unsigned int ii = 0; ii < size; ii++)
+	  at (ii).id = 0;
+	pending.clear ();
+	dirty = true;
+
+	if (emitting == 0)
+	  cleanup ();
+      }
+
+      /* called once no emission is going on anymore */
+      void cleanup ()
+      {
+	if (dirty) {
+
+	  unsigned int kept = 0;
+	  for (unsigned int ii = 0; ii < size; ii++)
+	    if (at (ii).id != 0) {
+
+	      if (kept != ii)
+		swap (at (kept), at (ii));
+	      kept++;
+	    }
+	  for (unsigned int ii = kept; ii < size; ii++)
+	    at (ii).function.clear ();
+	  if (size > INLINE_SLOTS)
+	    more_slots.resize (kept > INLINE_SLOTS ? kept - INLINE_SLOTS : 0);
+	  size = kept;
+	  dirty = false;
+	}
+
+	for (unsigned int ii = 0; ii < pending.size (); ii++) {
+
+	  if (pending[ii].second.id == 0)
+	    continue;
+
+	  append (pending[ii].second.id, pending[ii].second.function);
+	  if (pending[ii].first)
+	    for (unsigned int jj = size - 1; jj > 0; jj--)
+	      swap (at (jj), at (jj - 1));
+	}
+	pending.clear ();
+      }
+
+      void append (unsigned int id,
+		   const Function& function)
+      {
+	if (size >= INLINE_SLOTS)
+	  more_slots.push_back (slot ());
+	at (size).id = id;
+	at (size).function = function;
+	size++;
+      }
+
+      static void swap (slot& a,
+			slot& b)
+      {
+	std::swap (a.id, b.id);
+	a.function.swap (b.function);
+      }
+
+      slot inline_slots[INLINE_SLOTS];
+      std::vector<slot> more_slots;
+      unsigned int size;
+      std::vector<std::pair<bool, slot> > pending;
+      unsigned int next_id;
+      unsigned int emitting;
+      bool dirty;
+    };
+
+    class light_connection_body
+    {
+    public:
+
+      virtual ~light_connection_body () {}
+
+      virtual bool connected () const = 0;
+
+      virtual void disconnect () = 0;
+    };
+
+    template<typename Function>
+    class light_connection_body_impl: public light_connection_body
+    {
+    public:
+
+      light_connection_body_impl (boost::weak_ptr<light_signal_state<Function> > state_,
+				  unsigned int id_):
+	state(state_), id(id_)
+      {}
+
+      bool connected () const
+      {
+	boost::shared_ptr<light_signal_state<Function> > locked = state.lock ();
+	return locked && locked->connected (id);
+      }
+
+      void disconnect ()
+      {
+	boost::shared_ptr<light_signal_state<Function> > locked = state.lock ();
+	if (locked)
+	  locked->disconnect (id);
+      }
+
+    private:
+
+      boost::weak_ptr<light_signal_state<Function> > state;
+      unsigned int id;
+    };
+
+    inline void
+    check_light_signal_thread ()
+    {
+      assert (Ekiga::Runtime::is_main_thread ());
+    }
+  };
+
+  class light_connection
+  {
+  public:
+
+    light_connection ()
+    {}
+
+    light_connection (boost::shared_ptr<detail::light_connection_body> body_):
+      body(body_)
+    {}
+
+    bool connected () const
+    { return body && body->connected (); }
+
+    void disconnect () const
+    {
+      if (body)
+	body->disconnect ();
+    }
+
+  private:
+
+    boost::shared_ptr<detail::light_connection_body> body;
+  };
+
+  template<typename Signature>
+  class light_signal_base: public boost::noncopyable
+  {
+  public:
+
+    typedef void result_type;
+    typedef boost::function<Signature> slot_type;
+
+    ~light_signal_base ()
+    {
+      if (state)
+	state->disconnect_all ();
+    }
+
+    light_connection connect (const slot_type& slot,
+			      boost::signals2::connect_position position = boost::signals2::at_back)
+    {
+      detail::check_light_signal_thread ();
+
+      if ( !state)
+	state = boost::shared_ptr<state_type> (new state_type);
+
+      unsigned int id = state->connect (slot, position == boost::signals2::at_front);
+      return light_connection (boost::shared_ptr<detail::light_connection_body> (new detail::light_connection_body_impl<slot_type> (state, id)));
+    }
+
+    void disconnect_all_slots ()
+    {
+      if (state)
+	state->disconnect_all ();
+    }
+
+    bool empty () const
+    { return !state || state->size == 0; }
+
+    std::size_t num_slots () const
+    { return state ? state->size : 0; }
+
+  protected:
+
+    typedef detail::light_signal_state<slot_type> state_type;
+
+    /* an emission keeps the state alive, in case a slot destroys the
+     * signal ; it goes through the slots which were there when it started
+     */
+    class emission
+    {
+    public:
+
+      emission (boost::shared_ptr<state_type> state_):
+	state(state_), size(state_ ? state_->size : 0), index(0)
+      {
+	detail::check_light_signal_thread ();
+	if (state)
+	  state->emitting++;
+      }
+
+      ~emission ()
+      {
+	if (state && --state->emitting == 0)
+	  state->cleanup ();
+      }
+
+      /* the next slot to call, or 0 */
+      slot_type* next ()
+      {
+	while (index < size) {
+
+	  typename state_type::slot& slot = state->at (index++);
+	  if (slot.id != 0)
+	    return &slot.function;
+	}
+	return 0;
+      }
+
+    private:
+
+      boost::shared_ptr<state_type> state;
+      unsigned int size;
+      unsigned int index;
+    };
+
+    boost::shared_ptr<state_type> state;
+  };
+
+  template<typename Signature>
+  class light_signal;
+
+  template<>
+  class light_signal<void()>: public light_signal_base<void()>
+  {
+  public:
+
+    void operator() ()
+    {
+      emission slots (state);
+      for (slot_type* slot = slots.next (); slot != 0; slot = slots.next ())
+	(*slot) ();
+    }
+  };
+
+  template<typename A1>
+  class light_signal<void(A1)>: public light_signal_base<void(A1)>
+  {
+    typedef light_signal_base<void(A1)> base;
+
+  public:
+
+    void operator() (A1 a1)
+    {
+      typename base::emission slots (base::state);
+      for (typename base::slot_type* slot = slots.next (); slot != 0; slot = slots.next ())
+	(*slot) (a1);
+    }
+  };
+
+  template<typename A1, typename A2>
+  class light_signal<void(A1, A2)>: public light_signal_base<void(A1, A2)>
+  {
+    typedef light_signal_base<void(A1, A2)> base;
+
+  public:
+
+    void operator() (A1 a1,
+		     A2 a2)
+    {
+      typename base::emission slots (base::state);
+      for (typename base::slot_type* slot = slots.next (); slot != 0; slot = slots.next ())
+	(*slot) (a1, a2);
+    }
+  };
+
+  template<typename A1, typename A2, typename A3>
+  class light_signal<void(A1, A2, A3)>: public light_signal_base<void(A1, A2, A3)>
+  {
+    typedef light_signal_base<void(A1, A2, A3)> base;
+
+  public:
+
+    void operator() (A1 a1,
+		     A2 a2,
+		     A3 a3)
+    {
+      typename base::emission slots (base::state);
+      for (typename base::slot_type* slot = slots.next (); slot != 0; slot = slots.next ())
+	(*slot) (a1, a2, a3);
+    }
+  };
+};
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         ring-buffer.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : a lock-free single-producer/single-consumer
+ *                          byte ring used to hand audio between threads
+ *
+ */
+
+#ifndef __RING_BUFFER_H__
+#define __RING_BUFFER_H__
+
+#include <string.h>
+#include <glib.h>
+#include <boost/noncopyable.hpp>
+
+namespace Ekiga
+{
+
+  /**
+   * @addtogroup services
+   * @{
+   */
+
+  /* A byte ring which can be written by exactly one thread and read by
+   * exactly one (other) thread without any lock.
+   *
+   * The read and write positions are free-running counters : the producer
+   * only ever stores the write position, the consumer only ever stores the
+   * read position, and both are published with g_atomic_int_set, which is
+   * a full memory barrier. The capacity is rounded up to a power of two so
+   * that the counters can wrap around freely.
+   *
+   * reset () and resize () are not thread-safe : they may only be called
+   * while neither side is using the ring.
+   */
+  class RingBuffer:
+    public boost::noncopyable
+  {
+  public:
+
+    RingBuffer (unsigned capacity = 0):
+      buffer(NULL), mask(0), read_pos(0), write_pos(0)
+    { resize (capacity); }
+
+    ~RingBuffer ()
+    { g_free (buffer); }
+
+    void resize (unsigned capacity)
+    {
+      unsigned size = 1;
+
+      while (size < capacity)
+	size <<= 1;
+
+      g_free (buffer);
+      buffer = (capacity > 0) ? (char*) g_malloc0 (size) : NULL;
+      mask = (capacity > 0) ? size - 1 : 0;
+      reset ();
+    }
+
+    void reset ()
+    {
+      g_atomic_int_set (&read_pos, 0);
+      g_atomic_int_set (&write_pos, 0);
+    }
+
+    unsigned capacity () const
+    { return buffer ? mask + 1 : 0; }
+
+    /* Number of bytes which can be read right now */
+    unsigned readable () const
+    {
+      return (unsigned) g_atomic_int_get (&write_pos)
+	- (unsigned) g_atomic_int_get (&read_pos);
+    }
+
+    /* Number of bytes which can be written right now */
+    unsigned writable () const
+    { return capacity () - readable (); }
+
+    /* Producer side : copies at most size bytes in the ring,
+     * and returns how many were actually copied.
+     */
+    unsigned write (const char* data,
+		    unsigned size)
+    {
+      unsigned wpos = (unsigned) g_atomic_int_get (&write_pos);
+      unsigned rpos = (unsigned) g_atomic_int_get (&read_pos);
+      unsigned len = MIN (size, capacity () - (wpos - rpos));
+      unsigned offset = wpos & mask;
+      unsigned first = MIN (len, capacity () - offset);
+
+      if (len == 0)
+	return 0;
+
+      memcpy (buffer + offset, data, first);
+      memcpy (buffer, data + first, len - first);
+      g_atomic_int_set (&write_pos, (gint) (wpos + len));
+
+      return len;
+    }
+
+    /* Consumer side : copies at most size bytes out of the ring,
+     * and returns how many were actually copied.
+     */
+    unsigned read (char* data,
+		   unsigned size)
+    {
+      unsigned rpos = (unsigned) g_atomic_int_get (&read_pos);
+      unsigned wpos = (unsigned) g_atomic_int_get (&write_pos);
+      unsigned len = MIN (size, wpos - rpos);
+      unsigned offset = rpos & mask;
+      unsigned first = MIN (len, capacity () - offset);
+
+      if (len == 0)
+	return 0;
+
+      memcpy (data, buffer + offset, first);
+      memcpy (data + first, buffer, len - first);
+      g_atomic_int_set (&read_pos, (gint) (rpos + len));
+
+      return len;
+    }
+
+    /* Consumer side : drops at most size bytes from the ring,
+     * and returns how many were actually dropped.
+     */
+    unsigned skip (unsigned size)
+    {
+      unsigned rpos = (unsigned) g_atomic_int_get (&read_pos);
+      unsigned wpos = (unsigned) g_atomic_int_get (&write_pos);
+      unsigned len = MIN (size, wpos - rpos);
+
+      g_atomic_int_set (&read_pos, (gint) (rpos + len));
+
+      return len;
+    }
+
+  private:
+
+    char* buffer;
+    unsigned mask;
+    volatile gint read_pos;
+    volatile gint write_pos;
+  };
+
+  /**
+   * @}
+   */
+};
+
+#endif
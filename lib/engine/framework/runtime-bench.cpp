@@ -0,0 +1,234 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         runtime-bench.cpp  -  description
+ *                         ---------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Times how long actions given to run_in_main
+ *                          from several threads wait before they run, with
+ *                          the runtime and with the queue polled every
+ *                          100 ms as it used to be.
+ *
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#include <glib.h>
+
+#include "runtime.h"
+
+#define THREADS 4
+#define MESSAGES 1000
+#define MAX_PAUSE 2000 // microseconds between two messages of a thread
+
+/* what all messages update : only touched from the main thread */
+struct Latencies
+{
+  std::vector<gint64> values;
+  GMainLoop* loop; // NULL for the runtime's own loop
+};
+
+static void
+record (Latencies* latencies,
+	gint64 posted)
+{
+  latencies->values.push_back (g_get_monotonic_time () - posted);
+
+  if (latencies->values.size () < THREADS * MESSAGES)
+    return;
+
+  if (latencies->loop)
+    g_main_loop_quit (latencies->loop);
+  else
+    Ekiga::Runtime::quit ();
+}
+
+/* the run_in_main source as it was before the main context got woken up :
+ * the queue is checked at least every 100 ms, one message per iteration */
+struct polled_source
+{
+  GSource source;
+  GAsyncQueue* queue;
+};
+
+static gboolean
+polled_check (GSource* source)
+{
+  return g_async_queue_length (((polled_source*)source)->queue) > 0;
+}
+
+static gboolean
+polled_prepare (GSource* source,
+		gint* timeout)
+{
+  *timeout = 100;
+
+  return polled_check (source);
+}
+
+static gboolean
+polled_dispatch (GSource* source,
+		 GSourceFunc /*callback*/,
+		 gpointer /*data*/)
+{
+  boost::function0<void>* action =
+    (boost::function0<void>*)g_async_queue_pop (((polled_source*)source)->queue);
+
+  (*action) ();
+  delete action;
+
+  return TRUE;
+}
+
+static GSourceFuncs polled_source_funcs = {
+  polled_prepare,
+  polled_check,
+  polled_dispatch,
+  NULL,
+  NULL,
+  NULL
+};
+
+/* what posts the messages : either the polled queue, or run_in_main */
+struct Poster
+{
+  GAsyncQueue* queue;
+  Latencies* latencies;
+  guint32 seed;
+};
+
+static gpointer
+post_messages (gpointer data)
+{
+  Poster* poster = (Poster*)data;
+  GRand* rand = g_rand_new_with_seed (poster->seed);
+
+  for (unsigned ii = 0; ii < MESSAGES; ii++) {
+
+    g_usleep (g_rand_int_range (rand, 0, MAX_PAUSE));
+
+    boost::function0<void> action =
+      boost::bind (&record, poster->latencies, g_get_monotonic_time ());
+    if (poster->queue)
+      g_async_queue_push (poster->queue, new boost::function0<void> (action));
+    else
+      Ekiga::Runtime::run_in_main (action);
+  }
+
+  g_rand_free (rand);
+
+  return NULL;
+}
+
+static void
+start_posters (std::vector<GThread*>& threads,
+	       std::vector<Poster>& posters,
+	       GAsyncQueue* queue,
+	       Latencies* latencies)
+{
+  posters.resize (THREADS);
+  for (unsigned ii = 0; ii < THREADS; ii++) {
+
+    posters[ii].queue = queue;
+    posters[ii].latencies = latencies;
+    posters[ii].seed = 42 + ii;
+    threads.push_back (g_thread_new ("poster", post_messages, &posters[ii]));
+  }
+}
+
+static void
+join_posters (std::vector<GThread*>& threads)
+{
+  for (unsigned ii = 0; ii < threads.size (); ii++)
+    g_thread_join (threads[ii]);
+  threads.clear ();
+}
+
+static void
+print (const char* name,
+       std::vector<gint64>& values)
+{
+  gint64 sum = 0;
+
+  std::sort (values.begin (), values.end ());
+  for (unsigned ii = 0; ii < values.size (); ii++)
+    sum += values[ii];
+
+  printf ("%-20s mean %8.3f ms  median %8.3f ms  99%% %8.3f ms  max %8.3f ms\n",
+	  name,
+	  sum / 1e3 / values.size (),
+	  values[values.size () / 2] / 1e3,
+	  values[values.size () * 99 / 100] / 1e3,
+	  values.back () / 1e3);
+}
+
+int
+main (int /*argc*/,
+      char** /*argv*/)
+{
+  std::vector<GThread*> threads;
+  std::vector<Poster> posters;
+  Latencies polled;
+  Latencies woken;
+
+  /* before : a private context, so the runtime's sources don't interfere */
+  GMainContext* context = g_main_context_new ();
+  GAsyncQueue* queue = g_async_queue_new ();
+  polled_source* source = (polled_source*)g_source_new (&polled_source_funcs,
+							sizeof (polled_source));
+  source->queue = queue;
+  g_source_attach ((GSource*)source, context);
+  polled.loop = g_main_loop_new (context, FALSE);
+
+  start_posters (threads, posters, queue, &polled);
+  g_main_loop_run (polled.loop);
+  join_posters (threads);
+
+  g_source_destroy ((GSource*)source);
+  g_source_unref ((GSource*)source);
+  g_async_queue_unref (queue);
+  g_main_loop_unref (polled.loop);
+  g_main_context_unref (context);
+
+  /* after : the runtime itself, which quits once everything arrived */
+  Ekiga::Runtime::init ();
+  woken.loop = NULL;
+
+  start_posters (threads, posters, NULL, &woken);
+  Ekiga::Runtime::run ();
+  join_posters (threads);
+
+  printf ("%u threads posting %u messages each, up to %u us apart\n",
+	  THREADS, MESSAGES, MAX_PAUSE);
+  print ("polled queue", polled.values);
+  print ("run_in_main", woken.values);
+
+  return 0;
+}
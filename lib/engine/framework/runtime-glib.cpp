@@ -34,11 +34,25 @@
 
 #include "runtime.h"
 
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+
 #include <glib.h>
+#include <ptlib.h>
 
 static GAsyncQueue* queue;
 static GMainLoop* loop;
 
+/* the background work is network or disk i/o, not computation : the
+ * bound only avoids one thread per request when many come at once */
+#define BACKGROUND_THREADS 8
+
+/* how long (in microseconds) dispatch may run messages before letting
+ * the other sources (GTK redraws...) have their turn */
+#define DISPATCH_BUDGET (5 * G_TIME_SPAN_MILLISECOND)
+
 /* implementation of the helper functions
  *
  */
@@ -46,29 +60,284 @@ static GMainLoop* loop;
 struct message
 {
   message (boost::function0<void> _action,
-	   unsigned int _seconds): action(_action),
-				   seconds(_seconds)
+	   unsigned int _seconds,
+	   const char* _label): action(_action),
+				seconds(_seconds),
+				label(_label ? _label : "unlabelled"),
+				pushed(g_get_monotonic_time ())
   {}
 
   boost::function0<void> action;
   unsigned int seconds;
+  const char* label;
+  gint64 pushed;
+};
+
+/* Statistics about the run_in_main actions
+ *
+ * They are only touched from the main thread. The histograms have
+ * power-of-two buckets : bucket i counts the durations in [2^i, 2^(i+1))
+ * microseconds (the last one counts everything above).
+ */
+
+#define HISTOGRAM_BUCKETS 24
+#define TRACE_EVENTS 16384
+
+struct label_stats
+{
+  label_stats (): count(0), wait_total(0), wait_max(0), run_total(0), run_max(0)
+  {
+    for (unsigned ii = 0; ii < HISTOGRAM_BUCKETS; ii++)
+      wait_histogram[ii] = run_histogram[ii] = 0;
+  }
+
+  guint64 count;
+  gint64 wait_total;
+  gint64 wait_max;
+  gint64 run_total;
+  gint64 run_max;
+  guint64 wait_histogram[HISTOGRAM_BUCKETS];
+  guint64 run_histogram[HISTOGRAM_BUCKETS];
+};
+
+struct trace_event
+{
+  const char* label;
+  gint64 pushed;
+  gint64 started;
+  gint64 duration;
 };
 
+// labels are string literals : same pointer, same label (mostly)
+static std::map<const char*, label_stats> main_loop_stats;
+static std::vector<trace_event> trace_events;
+static unsigned trace_next = 0;
+static bool tracing = false;
+
+static unsigned
+histogram_bucket (gint64 duration)
+{
+  unsigned bucket = 0;
+
+  while (duration > 1 && bucket < HISTOGRAM_BUCKETS - 1) {
+
+    duration >>= 1;
+    bucket++;
+  }
+
+  return bucket;
+}
+
+static void
+record_message (const struct message* msg,
+		gint64 started,
+		gint64 duration)
+{
+  label_stats& stats = main_loop_stats[msg->label];
+  gint64 wait = started - msg->pushed;
+
+  stats.count++;
+  stats.wait_total += wait;
+  stats.wait_max = MAX (stats.wait_max, wait);
+  stats.run_total += duration;
+  stats.run_max = MAX (stats.run_max, duration);
+  stats.wait_histogram[histogram_bucket (wait)]++;
+  stats.run_histogram[histogram_bucket (duration)]++;
+
+  if (tracing) {
+
+    trace_event event = { msg->label, msg->pushed, started, duration };
+
+    if (trace_events.size () < TRACE_EVENTS)
+      trace_events.push_back (event);
+    else
+      trace_events[trace_next] = event;
+    trace_next = (trace_next + 1) % TRACE_EVENTS;
+  }
+}
+
+static void
+dump_json_string (std::ostream& os,
+		  const char* str)
+{
+  os << '"';
+  for (const char* ch = str; *ch; ch++) {
+
+    if (*ch == '"' || *ch == '\\')
+      os << '\\';
+    if ((unsigned char)*ch >= 0x20)
+      os << *ch;
+  }
+  os << '"';
+}
+
+static void
+dump_histogram (std::ostream& os,
+		const guint64* histogram)
+{
+  os << "[";
+  for (unsigned ii = 0; ii < HISTOGRAM_BUCKETS; ii++)
+    os << (ii ? "," : "") << histogram[ii];
+  os << "]";
+}
+
 static void
 free_message (struct message* msg)
 {
   delete msg;
 }
 
-static gboolean
-run_later_or_back_in_main_helper (gpointer data)
+/* Implementation of the background tasks
+ *
+ */
+
+class background_task: public Ekiga::Runtime::BackgroundTask
 {
-  struct message *msg = (struct message *)data;
+public:
+
+  background_task (boost::function0<void> _action,
+		   boost::function0<void> _continuation,
+		   Ekiga::Runtime::BackgroundPriority _priority,
+		   guint64 _serial): action(_action),
+				   continuation(_continuation),
+				   priority(_priority),
+				   serial(_serial),
+				   cancelled(0),
+				   done(false)
+  {
+    g_mutex_init (&mutex);
+    g_cond_init (&cond);
+  }
+
+  ~background_task ()
+  {
+    g_cond_clear (&cond);
+    g_mutex_clear (&mutex);
+  }
+
+  void cancel ()
+  { g_atomic_int_set (&cancelled, 1); }
+
+  bool is_cancelled () const
+  { return g_atomic_int_get (&cancelled) != 0; }
+
+  void wait ()
+  {
+    g_mutex_lock (&mutex);
+    while (!done)
+      g_cond_wait (&cond, &mutex);
+    g_mutex_unlock (&mutex);
+  }
+
+  void finish ()
+  {
+    g_mutex_lock (&mutex);
+    done = true;
+    g_cond_broadcast (&cond);
+    g_mutex_unlock (&mutex);
+  }
 
-  msg->action ();
-  free_message (msg);
+  void run_continuation ()
+  {
+    if (!is_cancelled ())
+      continuation ();
+  }
 
-  return FALSE;
+  boost::function0<void> action;
+  boost::function0<void> continuation;
+  Ekiga::Runtime::BackgroundPriority priority;
+  guint64 serial;
+
+private:
+
+  volatile gint cancelled;
+  bool done;
+  GMutex mutex;
+  GCond cond;
+};
+
+typedef boost::shared_ptr<background_task> background_task_ptr;
+
+/* higher priorities first, then first come, first served */
+struct background_task_order
+{
+  bool operator() (const background_task_ptr& a,
+		   const background_task_ptr& b) const
+  {
+    if (a->priority != b->priority)
+      return a->priority < b->priority;
+
+    return a->serial < b->serial;
+  }
+};
+
+/* The workers are PTLib threads, not glib ones : the tasks call into
+ * PTLib and OPAL, which expect to run in threads they know about. They
+ * are started when there is work and no idle worker, up to the bound.
+ */
+class background_worker: public PThread
+{
+  PCLASSINFO(background_worker, PThread);
+
+public:
+
+  background_worker (): PThread (1000, NoAutoDeleteThread,
+				 NormalPriority, "BackgroundWorker")
+  { Resume (); }
+
+  void Main ();
+};
+
+static GMutex background_mutex;
+static GCond background_cond;
+static std::set<background_task_ptr, background_task_order> background_tasks;
+static std::vector<background_worker*> background_workers;
+static unsigned idle_workers = 0;
+static guint64 background_serial = 0;
+static volatile gint background_quitting = 0;
+
+static bool
+pop_background_task (background_task_ptr& task)
+{
+  bool result = false;
+
+  g_mutex_lock (&background_mutex);
+
+  idle_workers++;
+  while (background_tasks.empty () && !g_atomic_int_get (&background_quitting))
+    g_cond_wait (&background_cond, &background_mutex);
+  idle_workers--;
+
+  if (!g_atomic_int_get (&background_quitting)) {
+
+    task = *background_tasks.begin ();
+    background_tasks.erase (background_tasks.begin ());
+    result = true;
+  }
+
+  g_mutex_unlock (&background_mutex);
+
+  return result;
+}
+
+void
+background_worker::Main ()
+{
+  background_task_ptr task;
+
+  while (pop_background_task (task)) {
+
+    if (!task->is_cancelled () && !g_atomic_int_get (&background_quitting)) {
+
+      task->action ();
+
+      if (!task->continuation.empty ())
+	Ekiga::Runtime::run_in_main (boost::bind (&background_task::run_continuation, task));
+    }
+
+    task->finish ();
+    task.reset ();
+  }
 }
 
 /* Implementation of the GSource
@@ -81,17 +350,23 @@ struct source
   GAsyncQueue *queue;
 };
 
+/* the thread which called init */
+static GThread* main_thread = NULL;
+
 static gboolean
 check (GSource *source)
 {
   return (g_async_queue_length (((struct source *)source)->queue) > 0);
 }
 
+/* run_in_main wakes the main context up when it pushes a message,
+ * so there is no need to poll the queue
+ */
 static gboolean
 prepare (GSource *source,
 	 gint *timeout)
 {
-  *timeout = 100;
+  *timeout = -1;
 
   return check (source);
 }
@@ -103,14 +378,31 @@ dispatch (GSource *source,
 {
   struct source *src = (struct source *)source;
   struct message *msg = NULL;
+  gint64 deadline = g_get_monotonic_time () + DISPATCH_BUDGET;
 
-  msg = (struct message *)g_async_queue_pop (src->queue);
+  /* drain the queue, but not for too long : what remains will make
+   * prepare return TRUE on the next iteration */
+  do {
+
+    msg = (struct message *)g_async_queue_try_pop (src->queue);
+    if (msg == NULL)
+      break;
+
+    if (msg->seconds == 0) {
+
+      gint64 started = g_get_monotonic_time ();
+      msg->action ();
+      record_message (msg, started, g_get_monotonic_time () - started);
+      free_message (msg);
+    }
+    else {
+
+      // like g_timeout_add_seconds, allow up to a second of slack
+      Ekiga::Runtime::add_timer (msg->action, msg->seconds * 1000, 1000);
+      free_message (msg);
+    }
+  } while (g_get_monotonic_time () < deadline);
 
-  if (msg->seconds == 0)
-    (void)run_later_or_back_in_main_helper ((gpointer)msg);
-  else
-    g_timeout_add_seconds (msg->seconds,
-			   run_later_or_back_in_main_helper, (gpointer)msg);
   return TRUE;
 }
 
@@ -131,9 +423,148 @@ static GSourceFuncs source_funcs = {
   NULL
 };
 
+/* Implementation of the timers
+ *
+ * The timers are ordered twice : by deadline, to know which are due, and by
+ * deadline + slack, to know when we must wake up at the latest. Whenever
+ * the main loop wakes up, all the timers which are due are run, so the
+ * timers with some slack get coalesced with the others.
+ *
+ * A due timer stays in the map until its action is started (one-shot timers
+ * are only unscheduled), and each action is looked up again just before it
+ * is started : an action cancelled by another thread or by an earlier
+ * action of the same batch is not run.
+ */
+
+struct timer
+{
+  gint64 deadline; // monotonic time, in microseconds
+  gint64 slack;
+  gint64 interval; // 0 if the timer doesn't repeat
+  guint64 serial; // ids can be reused, serials can't
+  boost::function0<void> action;
+};
+
+typedef std::pair<gint64, unsigned int> timer_key;
+
+static GMutex timers_mutex;
+static std::map<unsigned int, timer> timers;
+static std::set<timer_key> timers_by_deadline;
+static std::set<timer_key> timers_by_latest;
+static unsigned int last_timer = 0;
+static guint64 last_timer_serial = 0;
+
+static void
+schedule_timer (unsigned int id,
+		const timer& t)
+{
+  timers_by_deadline.insert (timer_key (t.deadline, id));
+  timers_by_latest.insert (timer_key (t.deadline + t.slack, id));
+}
+
+static void
+unschedule_timer (unsigned int id,
+		  const timer& t)
+{
+  timers_by_deadline.erase (timer_key (t.deadline, id));
+  timers_by_latest.erase (timer_key (t.deadline + t.slack, id));
+}
+
+static gboolean
+timers_check (GSource* /*source*/)
+{
+  gboolean result = FALSE;
+
+  g_mutex_lock (&timers_mutex);
+  result = (!timers_by_deadline.empty ()
+	    && timers_by_deadline.begin ()->first <= g_get_monotonic_time ());
+  g_mutex_unlock (&timers_mutex);
+
+  return result;
+}
+
+static gboolean
+timers_prepare (GSource* source,
+		gint* timeout)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  *timeout = -1;
+
+  g_mutex_lock (&timers_mutex);
+  if (!timers_by_latest.empty ())
+    *timeout = (gint) MAX ((timers_by_latest.begin ()->first - now + 999) / 1000, 0);
+  g_mutex_unlock (&timers_mutex);
+
+  return timers_check (source);
+}
+
+static gboolean
+timers_dispatch (GSource* /*source*/,
+		 GSourceFunc /*callback*/,
+		 gpointer /*data*/)
+{
+  std::vector<std::pair<unsigned int, guint64> > due; // id and serial
+  gint64 now = g_get_monotonic_time ();
+
+  g_mutex_lock (&timers_mutex);
+  while (!timers_by_deadline.empty ()
+	 && timers_by_deadline.begin ()->first <= now) {
+
+    unsigned int id = timers_by_deadline.begin ()->second;
+    std::map<unsigned int, timer>::iterator iter = timers.find (id);
+
+    unschedule_timer (id, iter->second);
+    due.push_back (std::make_pair (id, iter->second.serial));
+
+    if (iter->second.interval > 0) {
+
+      iter->second.deadline += iter->second.interval;
+      if (iter->second.deadline < now)
+	iter->second.deadline = now + iter->second.interval;
+      schedule_timer (id, iter->second);
+    }
+  }
+  g_mutex_unlock (&timers_mutex);
+
+  // the actions may add or cancel timers
+  for (std::vector<std::pair<unsigned int, guint64> >::iterator key = due.begin ();
+       key != due.end ();
+       ++key) {
+
+    boost::function0<void> action;
+
+    g_mutex_lock (&timers_mutex);
+    std::map<unsigned int, timer>::iterator iter = timers.find (key->first);
+    if (iter != timers.end () && iter->second.serial == key->second) {
+
+      action = iter->second.action;
+      if (iter->second.interval == 0)
+	timers.erase (iter);
+    }
+    g_mutex_unlock (&timers_mutex);
+
+    if (action)
+      action ();
+  }
+
+  return TRUE;
+}
+
+static GSourceFuncs timers_source_funcs = {
+  timers_prepare,
+  timers_check,
+  timers_dispatch,
+  NULL,
+  NULL,
+  NULL
+};
+
 void
 Ekiga::Runtime::init ()
 {
+  g_atomic_pointer_set (&main_thread, g_thread_self ());
+
   // here we get a ref to the queue, which we'll release in quit
   queue = g_async_queue_new_full ((GDestroyNotify)free_message);
 
@@ -143,7 +574,15 @@ Ekiga::Runtime::init ()
   g_async_queue_ref (queue); // give a ref to the source
   g_source_attach ((GSource *)source, g_main_context_default ());
 
+  GSource* timers_source = g_source_new (&timers_source_funcs, sizeof (GSource));
+  g_source_attach (timers_source, g_main_context_default ());
+  g_source_unref (timers_source);
+
   loop = g_main_loop_new (NULL, FALSE);
+
+  tracing = (g_getenv ("EKIGA_MAINLOOP_TRACE") != NULL);
+
+  g_atomic_int_set (&background_quitting, 0);
 }
 
 void
@@ -155,6 +594,30 @@ Ekiga::Runtime::run ()
 void
 Ekiga::Runtime::quit ()
 {
+  std::set<background_task_ptr, background_task_order> pending;
+  std::vector<background_worker*> workers;
+
+  // the pending tasks are only dropped, the running ones are waited for
+  g_mutex_lock (&background_mutex);
+  g_atomic_int_set (&background_quitting, 1);
+  pending.swap (background_tasks);
+  workers.swap (background_workers);
+  g_cond_broadcast (&background_cond);
+  g_mutex_unlock (&background_mutex);
+
+  for (std::set<background_task_ptr, background_task_order>::iterator iter = pending.begin ();
+       iter != pending.end ();
+       ++iter)
+    (*iter)->finish ();
+
+  for (std::vector<background_worker*>::iterator iter = workers.begin ();
+       iter != workers.end ();
+       ++iter) {
+
+    (*iter)->WaitForTermination ();
+    delete *iter;
+  }
+
   g_async_queue_unref (queue);
   queue = NULL;
   g_main_loop_quit (loop);
@@ -162,10 +625,172 @@ Ekiga::Runtime::quit ()
   loop = NULL;
 }
 
+bool
+Ekiga::Runtime::is_main_thread ()
+{
+  GThread* thread = (GThread*) g_atomic_pointer_get (&main_thread);
+
+  return (thread == NULL || thread == g_thread_self ());
+}
+
 void
 Ekiga::Runtime::run_in_main (boost::function0<void> action,
-			     unsigned int seconds)
+			     unsigned int seconds,
+			     const char* label)
+{
+  if (queue != NULL) {
+
+    g_async_queue_push (queue, (gpointer)(new struct message (action, seconds, label)));
+    g_main_context_wakeup (g_main_context_default ());
+  }
+}
+
+Ekiga::Runtime::BackgroundTaskPtr
+Ekiga::Runtime::run_in_background (boost::function0<void> action,
+				   boost::function0<void> continuation,
+				   BackgroundPriority priority)
+{
+  background_task_ptr task;
+  bool queued = false;
+
+  g_mutex_lock (&background_mutex);
+  task = background_task_ptr (new background_task (action, continuation, priority,
+						   background_serial++));
+  if (!g_atomic_int_get (&background_quitting)) {
+
+    background_tasks.insert (task);
+    if (background_tasks.size () > idle_workers
+	&& background_workers.size () < BACKGROUND_THREADS)
+      background_workers.push_back (new background_worker);
+    g_cond_signal (&background_cond);
+    queued = true;
+  }
+  g_mutex_unlock (&background_mutex);
+
+  if (!queued)
+    task->finish ();
+
+  return task;
+}
+
+unsigned int
+Ekiga::Runtime::add_timer (boost::function0<void> action,
+			   unsigned int ms,
+			   unsigned int slack,
+			   bool repeat)
 {
-  if (queue != NULL)
-    g_async_queue_push (queue, (gpointer)(new struct message (action, seconds)));
+  timer t;
+  unsigned int id = 0;
+
+  t.deadline = g_get_monotonic_time () + (gint64) ms * G_TIME_SPAN_MILLISECOND;
+  t.slack = (gint64) slack * G_TIME_SPAN_MILLISECOND;
+  t.interval = repeat ? MAX ((gint64) ms * G_TIME_SPAN_MILLISECOND, 1) : 0;
+  t.action = action;
+
+  g_mutex_lock (&timers_mutex);
+  do {
+    id = ++last_timer;
+  } while (id == 0 || timers.find (id) != timers.end ());
+  t.serial = ++last_timer_serial;
+  timers[id] = t;
+  schedule_timer (id, t);
+  g_mutex_unlock (&timers_mutex);
+
+  // the main loop may be sleeping longer than this one needs
+  g_main_context_wakeup (g_main_context_default ());
+
+  return id;
+}
+
+void
+Ekiga::Runtime::cancel_timer (unsigned int id)
+{
+  g_mutex_lock (&timers_mutex);
+  std::map<unsigned int, timer>::iterator iter = timers.find (id);
+  if (iter != timers.end ()) {
+
+    unschedule_timer (id, iter->second);
+    timers.erase (iter);
+  }
+  g_mutex_unlock (&timers_mutex);
+}
+
+void
+Ekiga::Runtime::set_main_loop_tracing (bool on)
+{
+  tracing = on;
+  if (!tracing) {
+
+    trace_events.clear ();
+    trace_next = 0;
+  }
+}
+
+std::string
+Ekiga::Runtime::dump_main_loop_stats ()
+{
+  std::ostringstream os;
+  std::map<std::string, label_stats> by_name;
+  bool first = true;
+
+  /* the timestamps are in microseconds, on the monotonic clock ; each action
+   * appears on thread 1 when it runs, and on thread 2 while it waits */
+  os << "{\"traceEvents\":[";
+  for (unsigned ii = 0; ii < trace_events.size (); ii++) {
+
+    // oldest first
+    const trace_event& event = trace_events[(trace_next + ii) % trace_events.size ()];
+
+    os << (first ? "" : ",") << "{\"name\":";
+    dump_json_string (os, event.label);
+    os << ",\"cat\":\"run_in_main\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+       << ",\"ts\":" << event.started << ",\"dur\":" << event.duration
+       << ",\"args\":{\"queued_us\":" << event.started - event.pushed << "}}";
+    os << ",{\"name\":";
+    dump_json_string (os, event.label);
+    os << ",\"cat\":\"queued\",\"ph\":\"X\",\"pid\":1,\"tid\":2"
+       << ",\"ts\":" << event.pushed << ",\"dur\":" << event.started - event.pushed << "}";
+    first = false;
+  }
+  os << "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"run_in_main\":{";
+
+  for (std::map<const char*, label_stats>::const_iterator iter = main_loop_stats.begin ();
+       iter != main_loop_stats.end ();
+       ++iter) {
+
+    label_stats& stats = by_name[iter->first];
+    stats.count += iter->second.count;
+    stats.wait_total += iter->second.wait_total;
+    stats.wait_max = MAX (stats.wait_max, iter->second.wait_max);
+    stats.run_total += iter->second.run_total;
+    stats.run_max = MAX (stats.run_max, iter->second.run_max);
+    for (unsigned ii = 0; ii < HISTOGRAM_BUCKETS; ii++) {
+
+      stats.wait_histogram[ii] += iter->second.wait_histogram[ii];
+      stats.run_histogram[ii] += iter->second.run_histogram[ii];
+    }
+  }
+
+  first = true;
+  for (std::map<std::string, label_stats>::const_iterator iter = by_name.begin ();
+       iter != by_name.end ();
+       ++iter) {
+
+    os << (first ? "" : ",");
+    dump_json_string (os, iter->first.c_str ());
+    os << ":{\"count\":" << iter->second.count
+       << ",\"wait_total_us\":" << iter->second.wait_total
+       << ",\"wait_max_us\":" << iter->second.wait_max
+       << ",\"run_total_us\":" << iter->second.run_total
+       << ",\"run_max_us\":" << iter->second.run_max
+       << ",\"wait_histogram\":";
+    dump_histogram (os, iter->second.wait_histogram);
+    os << ",\"run_histogram\":";
+    dump_histogram (os, iter->second.run_histogram);
+    os << "}";
+    first = false;
+  }
+  os << "}}}";
+
+  return os.str ();
 }
@@ -35,6 +35,9 @@
 
 #include <boost/signals2.hpp>
 #include <boost/bind.hpp>
+#include <boost/smart_ptr.hpp>
+
+#include <string>
 
 #ifndef __RUNTIME_H__
 #define __RUNTIME_H__
@@ -57,8 +60,71 @@ namespace Ekiga
 
     void quit (); // depends on the implementation
 
+    /* Whether this is the thread which called init, and will run the main
+     * loop ; before init, this is true from any thread.
+     */
+    bool is_main_thread (); // depends on the implementation
+
+    /* The label (a string literal) tells where the action comes from in
+     * the main loop statistics.
+     */
     void run_in_main (boost::function0<void> action,
-		      unsigned int seconds = 0); // depends on the implementation
+		      unsigned int seconds = 0,
+		      const char* label = 0); // depends on the implementation
+
+    /* How long the run_in_main actions wait and run is always collected as
+     * per-label histograms ; with tracing on (or EKIGA_MAINLOOP_TRACE set in
+     * the environment), the last actions are also recorded one by one.
+     * Both can be dumped as a JSON trace (chrome://tracing format).
+     * Main thread only.
+     */
+    void set_main_loop_tracing (bool on); // depends on the implementation
+
+    std::string dump_main_loop_stats (); // depends on the implementation
+
+    /* Runs the action in the main thread in ms milliseconds, and then every
+     * ms milliseconds if repeat is true. It may run up to slack milliseconds
+     * late, so that timers due at about the same time share one wakeup.
+     * Can be called from any thread ; the returned handle is never 0.
+     */
+    unsigned int add_timer (boost::function0<void> action,
+			    unsigned int ms,
+			    unsigned int slack = 0,
+			    bool repeat = false); // depends on the implementation
+
+    /* Makes sure the action won't be started anymore (it may be running in
+     * the main thread right now). Can be called from any thread. */
+    void cancel_timer (unsigned int timer); // depends on the implementation
+
+    /* Handle on some work given to run_in_background.
+     * Cancelling it means the action won't run if it didn't start yet,
+     * and the continuation won't run at all ; a running action is not
+     * interrupted, but it can check is_cancelled () if it has the handle.
+     */
+    class BackgroundTask
+    {
+    public:
+
+      virtual ~BackgroundTask () {}
+
+      virtual void cancel () = 0;
+
+      virtual bool is_cancelled () const = 0;
+
+      /* waits until the action ran, or was dropped */
+      virtual void wait () = 0;
+    };
+
+    typedef boost::shared_ptr<BackgroundTask> BackgroundTaskPtr;
+
+    enum BackgroundPriority { HighPriority, NormalPriority, LowPriority };
+
+    /* Runs the (blocking) action in a shared pool of threads, higher
+     * priorities first, then the continuation (if any) in the main thread.
+     */
+    BackgroundTaskPtr run_in_background (boost::function0<void> action,
+					 boost::function0<void> continuation = boost::function0<void> (),
+					 BackgroundPriority priority = NormalPriority); // depends on the implementation
   };
 
   /**
@@ -39,6 +39,8 @@
 #include <list>
 #include <boost/signals2.hpp>
 
+#include "light-signal.h"
+
 /* The boost signals2 library has several tricks to disconnect connections on signals
  * automatically, namely :
  * - inherit from boost::signals2::trackable, which is good to get rid of
@@ -69,6 +71,9 @@ namespace Ekiga {
     void add (boost::signals2::connection conn)
     { conns.push_front (conn); }
 
+    void add (light_connection conn)
+    { light_conns.push_front (conn); }
+
     void clear ()
     {
       for (std::list<boost::signals2::connection>::iterator iter = conns.begin ();
@@ -76,11 +81,18 @@ namespace Ekiga {
 	   ++iter)
 	iter->disconnect ();
       conns.clear ();
+
+      for (std::list<light_connection>::iterator iter = light_conns.begin ();
+	   iter != light_conns.end ();
+	   ++iter)
+	iter->disconnect ();
+      light_conns.clear ();
     }
 
   private:
 
     std::list<boost::signals2::connection> conns;
+    std::list<light_connection> light_conns;
   };
 };
 
@@ -0,0 +1,155 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         services-bench.cpp  -  description
+ *                         ----------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Times looking services up in a ServiceCore, by
+ *                          name, by name and type, through ServiceHandle,
+ *                          and by going through all of them as it used to.
+ *
+ */
+
+#include <stdio.h>
+#include <list>
+#include <vector>
+
+#include <glib.h>
+
+#include "services.h"
+
+#define SERVICES 128
+#define LOOKUPS 1000000
+
+class Sample: public Ekiga::BasicService
+{
+public:
+
+  Sample (const std::string name):
+    Ekiga::BasicService (name, "\tService to benchmark lookups")
+  {}
+};
+
+typedef boost::shared_ptr<Sample> SamplePtr;
+typedef std::list<Ekiga::ServicePtr> Services;
+
+/* what ServiceCore::get did before it had an index */
+static Ekiga::ServicePtr
+get_by_scan (const Services& services,
+	     const std::string name)
+{
+  Ekiga::ServicePtr result;
+
+  for (Services::const_iterator iter = services.begin ();
+       iter != services.end () && !result;
+       iter++)
+    if (name == (*iter)->get_name ()) {
+
+      result = *iter;
+    }
+
+  return result;
+}
+
+int
+main (int /*argc*/,
+      char** /*argv*/)
+{
+  Ekiga::ServiceCore core;
+  Services services;
+  std::vector<std::string> names;
+  std::vector<boost::shared_ptr<Ekiga::ServiceHandle<Sample> > > handles;
+  std::vector<unsigned int> order;
+  GRand* rand = g_rand_new_with_seed (42);
+  bool success = true;
+
+  // as the core does, the last added comes first
+  for (unsigned ii = 0; ii < SERVICES; ii++) {
+
+    gchar* name = g_strdup_printf ("sample-core-%u", ii);
+    SamplePtr service (new Sample (name));
+    core.add (service);
+    services.push_front (service);
+    names.push_back (name);
+    handles.push_back (boost::shared_ptr<Ekiga::ServiceHandle<Sample> > (new Ekiga::ServiceHandle<Sample> (core, name)));
+    g_free (name);
+  }
+
+  for (unsigned ii = 0; ii < LOOKUPS; ii++)
+    order.push_back (g_rand_int_range (rand, 0, SERVICES));
+  g_rand_free (rand);
+
+  GTimer* timer = g_timer_new ();
+  double scan_time = 0;
+  double get_time = 0;
+  double typed_time = 0;
+  double handle_time = 0;
+
+  g_timer_start (timer);
+  for (unsigned ii = 0; ii < LOOKUPS; ii++)
+    success = (get_by_scan (services, names[order[ii]]) != NULL) && success;
+  scan_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (unsigned ii = 0; ii < LOOKUPS; ii++)
+    success = (core.get (names[order[ii]]) != NULL) && success;
+  get_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (unsigned ii = 0; ii < LOOKUPS; ii++)
+    success = (core.get<Sample> (names[order[ii]]) != NULL) && success;
+  typed_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (unsigned ii = 0; ii < LOOKUPS; ii++)
+    success = (handles[order[ii]]->get () != NULL) && success;
+  handle_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_destroy (timer);
+
+  // they must all find the same services
+  for (unsigned ii = 0; ii < SERVICES; ii++) {
+
+    Ekiga::ServicePtr service = get_by_scan (services, names[ii]);
+    success = success
+      && core.get (names[ii]) == service
+      && core.get<Sample> (names[ii]) == service
+      && handles[ii]->get () == service;
+  }
+
+  printf ("%u lookups among %u services\n", LOOKUPS, SERVICES);
+  printf ("%-24s %8.3f ms\n", "scanning the services", scan_time * 1e3);
+  printf ("%-24s %8.3f ms\n", "ServiceCore::get", get_time * 1e3);
+  printf ("%-24s %8.3f ms\n", "ServiceCore::get<T>", typed_time * 1e3);
+  printf ("%-24s %8.3f ms\n", "ServiceHandle<T>::get", handle_time * 1e3);
+
+  if ( !success)
+    printf ("THE LOOKUPS DIDN'T FIND THE SAME SERVICES\n");
+
+  return success ? 0 : 1;
+}
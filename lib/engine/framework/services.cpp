@@ -44,7 +44,7 @@
 
 #include "services.h"
 
-Ekiga::ServiceCore::ServiceCore (): closed(false)
+Ekiga::ServiceCore::ServiceCore (): closed(false), generation(0)
 {
 }
 
@@ -59,6 +59,7 @@ Ekiga::ServiceCore::~ServiceCore ()
 #endif
 
   /* this is supposed to free everything */
+  services_index.clear ();
   services.clear ();
 
 #if DEBUG
@@ -94,15 +95,19 @@ bool
 Ekiga::ServiceCore::add (ServicePtr service)
 {
   bool result = false;
+  const std::string name = service->get_name ();
 
-  if ( !get (service->get_name ())) {
+  mutex.lock ();
+  if (services_index.find (name) == services_index.end ()) {
     services.push_front (service);
-    service_added (service);
+    services_index[name] = services.begin ();
+    generation++;
     result = true;
-  } else {
-
-    result = false;
   }
+  mutex.unlock ();
+
+  if (result)
+    service_added (service);
 #if DEBUG
   if (result)
     std::cout << "Ekiga::ServiceCore added " << service->get_name () << std::endl;
@@ -116,8 +121,19 @@ Ekiga::ServiceCore::add (ServicePtr service)
 void
 Ekiga::ServiceCore::remove (ServicePtr service)
 {
+  services_index_type::iterator iter;
+
   service_removed (service);
-  services.remove (service);
+
+  mutex.lock ();
+  iter = services_index.find (service->get_name ());
+  if (iter != services_index.end () && *iter->second == service) {
+
+    services.erase (iter->second);
+    services_index.erase (iter);
+    generation++;
+  }
+  mutex.unlock ();
 }
 
 void
@@ -147,13 +163,11 @@ Ekiga::ServiceCore::get (const std::string name) const
 {
   ServicePtr result;
 
-  for (services_type::const_iterator iter = services.begin ();
-       iter != services.end () && !result;
-       iter++)
-    if (name == (*iter)->get_name ()) {
-
-      result = *iter;
-    }
+  mutex.lock ();
+  services_index_type::const_iterator iter = services_index.find (name);
+  if (iter != services_index.end ())
+    result = *iter->second;
+  mutex.unlock ();
 
 
 #if DEBUG
@@ -169,9 +183,22 @@ Ekiga::ServiceCore::get (const std::string name) const
 
 }
 
+unsigned int
+Ekiga::ServiceCore::get_generation () const
+{
+  unsigned int result;
+
+  mutex.lock ();
+  result = generation;
+  mutex.unlock ();
+
+  return result;
+}
+
 void
 Ekiga::ServiceCore::dump (std::ostream &stream) const
 {
+  mutex.lock ();
   for (services_type::const_reverse_iterator iter = services.rbegin ();
        iter != services.rend ();
        iter++)
@@ -180,4 +207,5 @@ Ekiga::ServiceCore::dump (std::ostream &stream) const
 	   << std::endl
 	   << (*iter)->get_description ()
 	   << std::endl;
+  mutex.unlock ();
 }
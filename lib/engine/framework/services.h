@@ -45,7 +45,9 @@
 #include <list>
 #include <string>
 #include <boost/signals2.hpp>
+#include <boost/signals2/mutex.hpp>
 #include <boost/bind.hpp>
+#include <boost/unordered_map.hpp>
 
 namespace Ekiga
 {
@@ -90,16 +92,71 @@ namespace Ekiga
 
     void dump (std::ostream &stream) const;
 
+    /* changes whenever a service is added or removed */
+    unsigned int get_generation () const;
+
     boost::signals2::signal<void(ServicePtr)> service_added;
     boost::signals2::signal<void(ServicePtr)> service_removed;
 
   private:
 
+    /* services can be added and looked up from several threads at once
+     * during startup (see KickStart)
+     */
+    mutable boost::signals2::mutex mutex;
+
     bool closed;
+    unsigned int generation;
 
+    /* the list keeps the services in order (for dump and destruction),
+     * the index finds them by name */
     typedef std::list<ServicePtr> services_type;
     services_type services;
+    typedef boost::unordered_map<std::string, services_type::iterator> services_index_type;
+    services_index_type services_index;
+
+  };
+
+  /* A service looked up by name once, and then only again when services
+   * were added to or removed from the core : hold one of these instead of
+   * calling ServiceCore::get on a hot path. The core must outlive it.
+   */
+  template<typename T>
+  class ServiceHandle
+  {
+  public:
+
+    ServiceHandle (const ServiceCore& core_,
+		   const std::string& name_):
+      core(core_), name(name_), generation(0), resolved(false)
+    {}
+
+    boost::shared_ptr<T> get () const
+    {
+      boost::shared_ptr<T> result;
+
+      mutex.lock ();
+      result = service.lock ();
+      if (!resolved || generation != core.get_generation () || !result) {
+
+	generation = core.get_generation ();
+	result = core.get<T> (name);
+	service = result;
+	resolved = true;
+      }
+      mutex.unlock ();
+
+      return result;
+    }
+
+  private:
 
+    const ServiceCore& core;
+    const std::string name;
+    mutable boost::signals2::mutex mutex;
+    mutable unsigned int generation;
+    mutable bool resolved;
+    mutable boost::weak_ptr<T> service;
   };
 
   typedef boost::shared_ptr<ServiceCore> ServiceCorePtr;
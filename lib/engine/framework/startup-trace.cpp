@@ -0,0 +1,224 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2009 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         startup-trace.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : timeline of the startup, as a Chrome trace
+ *
+ */
+
+#include "startup-trace.h"
+
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <glib.h>
+
+namespace
+{
+  struct trace_event
+  {
+    std::string name;
+    const char* category;
+    unsigned int thread;
+    gint64 start;
+    gint64 duration; // -1 for marks
+  };
+
+  G_LOCK_DEFINE_STATIC (startup_trace);
+
+  // only changed by init and finish
+  bool enabled = false;
+  gchar* output = NULL;
+  gint64 origin = 0;
+
+  std::vector<trace_event> events;
+  std::map<GThread*, unsigned int> threads;
+
+  void
+  record (const std::string& name,
+	  const char* category,
+	  gint64 start,
+	  gint64 duration)
+  {
+    trace_event event;
+
+    event.name = name;
+    event.category = category;
+    event.start = start - origin;
+    event.duration = duration;
+
+    G_LOCK (startup_trace);
+    std::map<GThread*, unsigned int>::iterator iter = threads.find (g_thread_self ());
+    if (iter == threads.end ())
+      iter = threads.insert (std::make_pair (g_thread_self (),
+					     (unsigned int) threads.size () + 1)).first;
+    event.thread = iter->second;
+    events.push_back (event);
+    G_UNLOCK (startup_trace);
+  }
+
+  void
+  dump_json_string (std::ostream& os,
+		    const char* str)
+  {
+    os << '"';
+    for (const char* ch = str; *ch; ch++) {
+
+      if (*ch == '"' || *ch == '\\')
+	os << '\\';
+      if ((unsigned char)*ch >= 0x20)
+	os << *ch;
+    }
+    os << '"';
+  }
+};
+
+void
+Ekiga::StartupTrace::init (int argc,
+			   char* argv[])
+{
+  const gchar* path = g_getenv ("EKIGA_STARTUP_TRACE");
+
+  /* GOption parses the command line much later, but accepts the same
+   * two forms of the option */
+  for (int arg = 1; arg < argc; arg++)
+    if (g_str_has_prefix (argv[arg], "--startup-trace="))
+      path = argv[arg] + strlen ("--startup-trace=");
+    else if (g_str_equal (argv[arg], "--startup-trace") && arg + 1 < argc)
+      path = argv[++arg];
+
+  if (path == NULL || *path == '\0' || enabled)
+    return;
+
+  output = g_strdup (path);
+  origin = g_get_monotonic_time ();
+  enabled = true;
+  mark ("start", "process");
+}
+
+bool
+Ekiga::StartupTrace::is_enabled ()
+{
+  return enabled;
+}
+
+void
+Ekiga::StartupTrace::mark (const std::string& name,
+			   const char* category)
+{
+  if (enabled)
+    record (name, category, g_get_monotonic_time (), -1);
+}
+
+void
+Ekiga::StartupTrace::finish ()
+{
+  std::ostringstream os;
+  GError* error = NULL;
+
+  if (!enabled)
+    return;
+
+  mark ("done", "process");
+
+  G_LOCK (startup_trace);
+  enabled = false;
+
+  /* the timestamps are in microseconds since init */
+  os << "{\"traceEvents\":[";
+  for (std::map<GThread*, unsigned int>::const_iterator iter = threads.begin ();
+       iter != threads.end ();
+       ++iter)
+    os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << iter->second
+       << ",\"args\":{\"name\":\"" << (iter->second == 1 ? "main" : "worker") << "\"}},";
+
+  for (std::vector<trace_event>::const_iterator iter = events.begin ();
+       iter != events.end ();
+       ++iter) {
+
+    os << (iter == events.begin () ? "" : ",") << "{\"name\":";
+    dump_json_string (os, iter->name.c_str ());
+    os << ",\"cat\":";
+    dump_json_string (os, iter->category);
+    if (iter->duration < 0)
+      os << ",\"ph\":\"i\",\"s\":\"p\"";
+    else
+      os << ",\"ph\":\"X\",\"dur\":" << iter->duration;
+    os << ",\"pid\":1,\"tid\":" << iter->thread << ",\"ts\":" << iter->start << "}";
+  }
+  os << "],\"displayTimeUnit\":\"ms\"}";
+
+  events.clear ();
+  threads.clear ();
+  G_UNLOCK (startup_trace);
+
+  if (!g_file_set_contents (output, os.str ().c_str (), -1, &error)) {
+
+    g_warning ("Couldn't write the startup trace: %s", error->message);
+    g_error_free (error);
+  }
+
+  g_free (output);
+  output = NULL;
+}
+
+Ekiga::StartupTrace::Span::Span (const std::string& name_,
+				 const char* category_):
+  name(name_), category(category_), start(0)
+{
+  if (enabled)
+    start = g_get_monotonic_time ();
+}
+
+Ekiga::StartupTrace::Span::~Span ()
+{
+  end ();
+}
+
+void
+Ekiga::StartupTrace::Span::next (const std::string& name_)
+{
+  end ();
+  name = name_;
+  if (enabled)
+    start = g_get_monotonic_time ();
+}
+
+void
+Ekiga::StartupTrace::Span::end ()
+{
+  if (enabled && start != 0) {
+
+    gint64 now = g_get_monotonic_time ();
+    record (name, category, start, now - start);
+  }
+  start = 0;
+}
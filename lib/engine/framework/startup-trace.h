@@ -0,0 +1,96 @@
+/*
+ * Ekiga -- A VoIP application
+ * Copyright (C) 2000-2009 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         startup-trace.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : timeline of the startup, as a Chrome trace
+ *
+ */
+
+#ifndef __STARTUP_TRACE_H__
+#define __STARTUP_TRACE_H__
+
+/* This records what happens while ekiga starts (the engine services, the
+ * sparks, the plugins, the gui...) and writes it as a JSON timeline in the
+ * Chrome trace format, which chrome://tracing and similar viewers read.
+ *
+ * It is enabled by setting the EKIGA_STARTUP_TRACE environment variable, or
+ * by giving the --startup-trace=FILE command line option, to the name of the
+ * file to write ; otherwise it records nothing.
+ *
+ * It can be used from any thread.
+ */
+
+#include <string>
+
+namespace Ekiga
+{
+  namespace StartupTrace
+  {
+    /* looks at the environment and at the command line, and starts the
+     * clock if tracing was asked for
+     */
+    void init (int argc,
+	       char* argv[]);
+
+    bool is_enabled ();
+
+    /* records that something just happened */
+    void mark (const std::string& name,
+	       const char* category);
+
+    /* stops recording, and writes the timeline */
+    void finish ();
+
+    /* records the time between its construction and its destruction ;
+     * next closes the current span and opens another one right after, which
+     * is handy to time a sequence of steps
+     */
+    class Span
+    {
+    public:
+
+      Span (const std::string& name,
+	    const char* category);
+
+      ~Span ();
+
+      void next (const std::string& name);
+
+    private:
+
+      void end ();
+
+      std::string name;
+      const char* category;
+      long long start;
+    };
+  };
+};
+
+#endif
@@ -58,6 +58,7 @@
 #include "call-core.h"
 #include "engine.h"
 #include "runtime.h"
+#include "startup-trace.h"
 #include "platform/platform.h"
 
 #include "gmwindow.h"
@@ -257,11 +258,23 @@ account_activated (GSimpleAction *action,
 }
 
 
+static gboolean
+first_main_loop_iteration_cb (G_GNUC_UNUSED gpointer data)
+{
+  Ekiga::StartupTrace::mark ("first main loop iteration", "gui");
+  Ekiga::StartupTrace::finish ();
+
+  return FALSE;
+}
+
+
 /* Public api */
 void
 ekiga_main (int argc,
             char **argv)
 {
+  Ekiga::StartupTrace::init (argc, argv);
+
   GmApplication *app = gm_application_new ();
 
   g_application_set_inactivity_timeout (G_APPLICATION (app), 10000);
@@ -284,14 +297,19 @@ ekiga_main (int argc,
   }
 
   /* Create the main application window */
-  app->priv->ekiga_window = gm_ekiga_window_new (app);
-  gm_application_show_ekiga_window (app);
+  {
+    Ekiga::StartupTrace::Span trace ("main window", "gui");
+    app->priv->ekiga_window = gm_ekiga_window_new (app);
+    gm_application_show_ekiga_window (app);
 
-  status_icon_new (app);
+    trace.next ("status icon");
+    status_icon_new (app);
 
 #ifdef HAVE_DBUS
-  app->priv->dbus_component = ekiga_dbus_component_new (app);
+    trace.next ("dbus");
+    app->priv->dbus_component = ekiga_dbus_component_new (app);
 #endif
+  }
 
   boost::shared_ptr<Ekiga::Settings> general_settings (new Ekiga::Settings (GENERAL_SCHEMA));
   const int schema_version = MAJOR_VERSION * 1000 + MINOR_VERSION * 10 + BUILD_NUMBER;
@@ -299,6 +317,9 @@ ekiga_main (int argc,
     general_settings->set_int ("version", schema_version);
   }
 
+  if (Ekiga::StartupTrace::is_enabled ())
+    g_idle_add (first_main_loop_iteration_cb, NULL);
+
   g_application_run (G_APPLICATION (app), argc, argv);
 
   g_object_unref (app);
@@ -485,6 +506,13 @@ gm_application_init (G_GNUC_UNUSED GmApplication *self)
           N_("Hangup the current call (if any)"),
           NULL
         },
+        /* parsed early by Ekiga::StartupTrace::init, declared so GOption
+         * does not reject it */
+        {
+          "startup-trace", '\0', 0, G_OPTION_ARG_FILENAME, NULL,
+          N_("Writes a trace of the startup to the given file"),
+          N_("FILE")
+        },
         {
           NULL, 0, 0, (GOptionArg)0, NULL,
           NULL,
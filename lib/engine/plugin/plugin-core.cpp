@@ -35,8 +35,12 @@
  */
 
 #include "plugin-core.h"
+#include "startup-trace.h"
+
+#include <set>
 
 #include <gmodule.h>
+#include <glib/gstdio.h>
 
 #if DEBUG
 #include <iostream>
@@ -61,11 +65,124 @@
 // dependancies) in the ekiga_debug_plugins/ directory in your temporary
 // directory ("/tmp" on unix-like systems) : that way ekiga will only load that
 // and be verbose about it.
+//
+// Loading every plugin at each startup is slow, so what each plugin adds to
+// the kickstart is remembered in a manifest, in the user cache directory :
+// as long as a plugin file keeps the same size and modification time, its
+// sparks are known without opening it, and it is only loaded when one of
+// them is really tried -- which doesn't happen if it was disabled, or if
+// what it requires isn't there. Plugins which don't add any spark are
+// always loaded, since their init function could do anything.
 
-static void
-plugin_parse_file (Ekiga::KickStart& kickstart,
-                   const gchar* filename)
+#define PLUGIN_MANIFEST_VERSION 1
+
+namespace
 {
+  struct PluginScan
+  {
+    GKeyFile* manifest;
+    std::set<std::string> seen;
+    bool dirty;
+  };
+
+  /* what a plugin spark told about itself when it was first loaded */
+  struct SparkInfo
+  {
+    std::string name;
+    std::list<std::string> provides;
+    std::list<std::string> requires;
+    bool main_thread_only;
+  };
+
+  /* a plugin known from the manifest, loaded the first time one of its
+   * sparks is needed
+   */
+  class LazyPlugin
+  {
+  public:
+
+    LazyPlugin (const std::string& filename_);
+
+    ~LazyPlugin ();
+
+    boost::shared_ptr<Ekiga::Spark> get_spark (const std::string& name);
+
+  private:
+
+    std::string filename;
+    GMutex mutex; // sparks of a plugin can be tried from several threads
+    bool loaded;
+    std::list<boost::shared_ptr<Ekiga::Spark> > sparks;
+  };
+
+  /* stands for a spark of a plugin which wasn't loaded */
+  class LazySpark: public Ekiga::Spark
+  {
+  public:
+
+    LazySpark (boost::shared_ptr<LazyPlugin> plugin_,
+	       const SparkInfo& info_):
+      plugin(plugin_), info(info_)
+    {}
+
+    bool try_initialize_more (Ekiga::ServiceCore& core,
+			      int* argc,
+			      char** argv[])
+    {
+      if ( !spark) {
+
+	// no need to load the plugin if the spark can't do anything yet
+	for (std::list<std::string>::const_iterator iter = info.requires.begin ();
+	     iter != info.requires.end ();
+	     ++iter)
+	  if ( !core.get (*iter))
+	    return false;
+
+	spark = plugin->get_spark (info.name);
+      }
+
+      return spark && spark->try_initialize_more (core, argc, argv);
+    }
+
+    void finish_initialization (Ekiga::ServiceCore& core)
+    {
+      if (spark)
+	spark->finish_initialization (core);
+    }
+
+    Ekiga::Spark::state get_state () const
+    { return spark ? spark->get_state () : BLANK; }
+
+    const std::string get_name () const
+    { return info.name; }
+
+    void get_provides (std::list<std::string>& names) const
+    { names = info.provides; }
+
+    void get_requires (std::list<std::string>& names) const
+    { names = info.requires; }
+
+    bool main_thread_only () const
+    { return info.main_thread_only; }
+
+  private:
+
+    boost::shared_ptr<LazyPlugin> plugin;
+    SparkInfo info;
+    boost::shared_ptr<Ekiga::Spark> spark;
+  };
+};
+
+/* loads a plugin, and lets it add its sparks to the kickstart object ;
+ * returns false if that's not a plugin
+ */
+static bool
+plugin_load_file (Ekiga::KickStart& kickstart,
+		  const gchar* filename)
+{
+  Ekiga::StartupTrace::Span trace (filename, "plugin");
+  bool result = false;
+
 #if DEBUG
   std::cout << "Trying to load " << filename << "... ";
 #endif
@@ -85,6 +202,7 @@ plugin_parse_file (Ekiga::KickStart& kickstart,
 #endif
       g_module_make_resident (plugin);
       ((void (*)(Ekiga::KickStart&))init_func) (kickstart);
+      result = true;
     } else {
 
 #if DEBUG
@@ -98,11 +216,179 @@ plugin_parse_file (Ekiga::KickStart& kickstart,
     std::cout << "failed to load the module: " << g_module_error () << std::endl;
 #endif
   }
+
+  return result;
+}
+
+LazyPlugin::LazyPlugin (const std::string& filename_):
+  filename(filename_), loaded(false)
+{
+  g_mutex_init (&mutex);
+}
+
+LazyPlugin::~LazyPlugin ()
+{
+  g_mutex_clear (&mutex);
+}
+
+boost::shared_ptr<Ekiga::Spark>
+LazyPlugin::get_spark (const std::string& name)
+{
+  boost::shared_ptr<Ekiga::Spark> result;
+
+  g_mutex_lock (&mutex);
+
+  if ( !loaded) {
+
+    Ekiga::KickStart kickstart;
+    plugin_load_file (kickstart, filename.c_str ());
+    kickstart.take_sparks (sparks);
+    loaded = true;
+  }
+
+  for (std::list<boost::shared_ptr<Ekiga::Spark> >::iterator iter = sparks.begin ();
+       iter != sparks.end () && !result;
+       ++iter)
+    if ((*iter)->get_name () == name)
+      result = *iter;
+
+  g_mutex_unlock (&mutex);
+
+  return result;
+}
+
+static std::list<std::string>
+manifest_get_list (GKeyFile* manifest,
+		   const gchar* group,
+		   const std::string& key)
+{
+  std::list<std::string> result;
+  gchar** values = g_key_file_get_string_list (manifest, group,
+					       key.c_str (), NULL, NULL);
+
+  for (gchar** value = values; value != NULL && *value != NULL; value++)
+    result.push_back (*value);
+  g_strfreev (values);
+
+  return result;
+}
+
+static void
+manifest_set_list (GKeyFile* manifest,
+		   const gchar* group,
+		   const std::string& key,
+		   const std::list<std::string>& values)
+{
+  const gchar** array = g_new0 (const gchar*, values.size () + 1);
+  unsigned int ii = 0;
+
+  for (std::list<std::string>::const_iterator iter = values.begin ();
+       iter != values.end ();
+       ++iter)
+    array[ii++] = iter->c_str ();
+  g_key_file_set_string_list (manifest, group, key.c_str (), array, ii);
+  g_free (array);
+}
+
+/* adds the sparks of an unchanged plugin from what the manifest says ;
+ * returns false if the plugin has to be loaded
+ */
+static bool
+plugin_parse_manifest (Ekiga::KickStart& kickstart,
+		       GKeyFile* manifest,
+		       const gchar* filename,
+		       const GStatBuf& info)
+{
+  if ( !g_key_file_has_group (manifest, filename)
+      || g_key_file_get_int64 (manifest, filename, "mtime", NULL) != (gint64) info.st_mtime
+      || g_key_file_get_int64 (manifest, filename, "size", NULL) != (gint64) info.st_size)
+    return false;
+
+  // not a plugin : no need to look again
+  if ( !g_key_file_get_boolean (manifest, filename, "valid", NULL))
+    return true;
+
+  std::list<std::string> names = manifest_get_list (manifest, filename, "sparks");
+  if (names.empty ())
+    return false;
+
+  boost::shared_ptr<LazyPlugin> plugin (new LazyPlugin (filename));
+  for (std::list<std::string>::iterator name = names.begin ();
+       name != names.end ();
+       ++name) {
+
+    SparkInfo spark_info;
+    spark_info.name = *name;
+    spark_info.provides = manifest_get_list (manifest, filename, *name + "-provides");
+    spark_info.requires = manifest_get_list (manifest, filename, *name + "-requires");
+    spark_info.main_thread_only = g_key_file_get_boolean (manifest, filename,
+							  (*name + "-main-thread-only").c_str (),
+							  NULL);
+
+    boost::shared_ptr<Ekiga::Spark> spark (new LazySpark (plugin, spark_info));
+    kickstart.add_spark (spark);
+  }
+
+#if DEBUG
+  std::cout << filename << " is known from the manifest" << std::endl;
+#endif
+
+  return true;
+}
+
+static void
+plugin_parse_file (Ekiga::KickStart& kickstart,
+		   PluginScan& scan,
+		   const gchar* filename)
+{
+  GStatBuf info;
+
+  if (g_stat (filename, &info) != 0)
+    return;
+
+  scan.seen.insert (filename);
+
+  if (plugin_parse_manifest (kickstart, scan.manifest, filename, info))
+    return;
+
+  // new or changed plugin : load it, and remember what it added
+  Ekiga::KickStart plugin_kickstart;
+  std::list<boost::shared_ptr<Ekiga::Spark> > sparks;
+  std::list<std::string> names;
+
+  bool valid = plugin_load_file (plugin_kickstart, filename);
+  plugin_kickstart.take_sparks (sparks);
+
+  for (std::list<boost::shared_ptr<Ekiga::Spark> >::iterator iter = sparks.begin ();
+       iter != sparks.end ();
+       ++iter) {
+
+    std::list<std::string> provides;
+    std::list<std::string> requires;
+    std::string name = (*iter)->get_name ();
+
+    (*iter)->get_provides (provides);
+    (*iter)->get_requires (requires);
+    manifest_set_list (scan.manifest, filename, name + "-provides", provides);
+    manifest_set_list (scan.manifest, filename, name + "-requires", requires);
+    g_key_file_set_boolean (scan.manifest, filename,
+			    (name + "-main-thread-only").c_str (),
+			    (*iter)->main_thread_only ());
+    names.push_back (name);
+    kickstart.add_spark (*iter);
+  }
+
+  g_key_file_set_int64 (scan.manifest, filename, "mtime", info.st_mtime);
+  g_key_file_set_int64 (scan.manifest, filename, "size", info.st_size);
+  g_key_file_set_boolean (scan.manifest, filename, "valid", valid);
+  manifest_set_list (scan.manifest, filename, "sparks", names);
+  scan.dirty = true;
 }
 
 static void
 plugin_parse_directory (Ekiga::KickStart& kickstart,
-                        const gchar* path)
+			PluginScan& scan,
+			const gchar* path)
 {
   g_return_if_fail (path != NULL);
 
@@ -131,9 +417,9 @@ plugin_parse_directory (Ekiga::KickStart& kickstart,
        */
 
       if (g_str_has_suffix (filename, G_MODULE_SUFFIX))
-        plugin_parse_file (kickstart, filename);
+        plugin_parse_file (kickstart, scan, filename);
       else
-        plugin_parse_directory (kickstart, filename);
+        plugin_parse_directory (kickstart, scan, filename);
 
       g_free (filename);
       name = g_dir_read_name (directory);
@@ -152,14 +438,61 @@ plugin_parse_directory (Ekiga::KickStart& kickstart,
 void
 plugin_init (Ekiga::KickStart& kickstart)
 {
+  PluginScan scan;
+  gchar* manifest_path = g_build_filename (g_get_user_cache_dir (), "ekiga",
+					   "plugins.manifest", NULL);
+
+  scan.manifest = g_key_file_new ();
+  scan.dirty = false;
+  if ( !g_key_file_load_from_file (scan.manifest, manifest_path,
+				   G_KEY_FILE_NONE, NULL)
+      || g_key_file_get_integer (scan.manifest, "manifest", "version", NULL)
+      != PLUGIN_MANIFEST_VERSION) {
+
+    g_key_file_free (scan.manifest);
+    scan.manifest = g_key_file_new ();
+    scan.dirty = true;
+  }
+
 #if DEBUG
   // should make it easier to test ekiga without installing
   gchar* path = g_build_path (G_DIR_SEPARATOR_S,
                               g_get_tmp_dir (), "ekiga_debug_plugins", NULL);
-  plugin_parse_directory (kickstart, path);
+  plugin_parse_directory (kickstart, scan, path);
   g_free (path);
 #else
-  plugin_parse_directory (kickstart,
+  plugin_parse_directory (kickstart, scan,
                           EKIGA_PLUGIN_DIR);
 #endif
+
+  // forget about the plugins which went away
+  gchar** groups = g_key_file_get_groups (scan.manifest, NULL);
+  for (gchar** group = groups; *group != NULL; group++) {
+
+    if (g_strcmp0 (*group, "manifest") != 0
+	&& scan.seen.find (*group) == scan.seen.end ()) {
+
+      g_key_file_remove_group (scan.manifest, *group, NULL);
+      scan.dirty = true;
+    }
+  }
+  g_strfreev (groups);
+
+  if (scan.dirty) {
+
+    gchar* dirname = g_path_get_dirname (manifest_path);
+    gchar* data = NULL;
+    gsize length = 0;
+
+    g_key_file_set_integer (scan.manifest, "manifest", "version",
+			    PLUGIN_MANIFEST_VERSION);
+    data = g_key_file_to_data (scan.manifest, &length, NULL);
+    g_mkdir_with_parents (dirname, 0700);
+    g_file_set_contents (manifest_path, data, length, NULL);
+    g_free (data);
+    g_free (dirname);
+  }
+
+  g_key_file_free (scan.manifest);
+  g_free (manifest_path);
 }
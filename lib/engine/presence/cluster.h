@@ -38,6 +38,7 @@
 
 #include "heap.h"
 #include "actor.h"
+#include "light-signal.h"
 
 namespace Ekiga
 {
@@ -64,17 +65,17 @@ namespace Ekiga
 
     /** This signal is emitted when a Heap has been added to the Source.
      */
-    boost::signals2::signal<void(HeapPtr)> heap_added;
+    light_signal<void(HeapPtr)> heap_added;
 
 
     /** This signal is emitted when a Heap has been updated in the Source.
      */
-    boost::signals2::signal<void(HeapPtr)> heap_updated;
+    light_signal<void(HeapPtr)> heap_updated;
 
 
     /** This signal is emitted when a Heap has been removed in the Source.
      */
-    boost::signals2::signal<void(HeapPtr)> heap_removed;
+    light_signal<void(HeapPtr)> heap_removed;
   };
 
   typedef boost::shared_ptr<Cluster> ClusterPtr;
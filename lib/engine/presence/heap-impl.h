@@ -36,7 +36,7 @@
 #ifndef __HEAP_IMPL_H__
 #define __HEAP_IMPL_H__
 
-#include "dynamic-object-store.h"
+#include "flat-object-store.h"
 #include "heap.h"
 
 namespace Ekiga
@@ -68,8 +68,8 @@ namespace Ekiga
 
   public:
 
-    typedef typename DynamicObjectStore<PresentityType>::iterator iterator;
-    typedef typename DynamicObjectStore<PresentityType>::const_iterator const_iterator;
+    typedef typename FlatObjectStore<PresentityType>::iterator iterator;
+    typedef typename FlatObjectStore<PresentityType>::const_iterator const_iterator;
 
     HeapImpl ();
 
@@ -85,13 +85,27 @@ namespace Ekiga
 
     iterator end ();
 
-    DynamicObjectStore<PresentityType> presentities;
+    FlatObjectStore<PresentityType> presentities;
 
   protected:
 
     void add_presentity (boost::shared_ptr<PresentityType> presentity);
 
     void remove_presentity (boost::shared_ptr<PresentityType> presentity);
+
+    /** Start adding and removing presentities in bulk: until the matching
+     * commit_presentities_update, they are notified all at once by
+     * presentities_changed.
+     * @param How many presentities are about to be added (if known).
+     */
+    void begin_presentities_update (unsigned int expected = 0);
+
+    void commit_presentities_update ();
+
+  private:
+
+    void on_presentities_changed (const typename FlatObjectStore<PresentityType>::objects_list& added,
+				  const typename FlatObjectStore<PresentityType>::objects_list& removed);
   };
 
 /**
@@ -108,6 +122,7 @@ Ekiga::HeapImpl<PresentityType>::HeapImpl ()
   presentities.object_added.connect (boost::bind (boost::ref (presentity_added), _1));
   presentities.object_removed.connect (boost::bind (boost::ref (presentity_removed), _1));
   presentities.object_updated.connect (boost::bind (boost::ref (presentity_updated), _1));
+  presentities.objects_changed.connect (boost::bind (&Ekiga::HeapImpl<PresentityType>::on_presentities_changed, this, _1, _2));
 }
 
 
@@ -166,4 +181,29 @@ Ekiga::HeapImpl<PresentityType>::remove_presentity (boost::shared_ptr<Presentity
   presentities.remove_object (presentity);
 }
 
+template<typename PresentityType>
+void
+Ekiga::HeapImpl<PresentityType>::begin_presentities_update (unsigned int expected)
+{
+  presentities.begin_bulk (expected);
+}
+
+template<typename PresentityType>
+void
+Ekiga::HeapImpl<PresentityType>::commit_presentities_update ()
+{
+  presentities.commit_bulk ();
+}
+
+template<typename PresentityType>
+void
+Ekiga::HeapImpl<PresentityType>::on_presentities_changed (const typename FlatObjectStore<PresentityType>::objects_list& added,
+							  const typename FlatObjectStore<PresentityType>::objects_list& removed)
+{
+  std::list<PresentityPtr> added_presentities (added.begin (), added.end ());
+  std::list<PresentityPtr> removed_presentities (removed.begin (), removed.end ());
+
+  presentities_changed (added_presentities, removed_presentities);
+}
+
 #endif
@@ -38,6 +38,7 @@
 #define __HEAP_H__
 
 #include "presentity.h"
+#include "light-signal.h"
 
 namespace Ekiga
 {
@@ -73,15 +74,24 @@ namespace Ekiga
 
     /** This signal is emitted  when a Presentity has been added to the Heap.
      */
-    boost::signals2::signal<void(PresentityPtr)> presentity_added;
+    light_signal<void(PresentityPtr)> presentity_added;
 
     /** This signal is emitted when a Presentity has been updated in the Heap.
      */
-    boost::signals2::signal<void(PresentityPtr)> presentity_updated;
+    light_signal<void(PresentityPtr)> presentity_updated;
 
     /** This signal is emitted when a Presentity has been removed from the Heap.
      */
-    boost::signals2::signal<void(PresentityPtr)> presentity_removed;
+    light_signal<void(PresentityPtr)> presentity_removed;
+
+    /** This signal is emitted when Presentities have been added to and
+     * removed from the Heap in bulk, instead of presentity_added and
+     * presentity_removed for each of them: what listens to those must
+     * listen to this one too.
+     * @param The added Presentities, in the order they were added
+     * @param The removed Presentities
+     */
+    light_signal<void(const std::list<PresentityPtr>&, const std::list<PresentityPtr>&)> presentities_changed;
   };
 
   typedef boost::shared_ptr<Heap> HeapPtr;
@@ -43,7 +43,7 @@
 #include "personal-details.h"
 
 
-Ekiga::PresenceCore::PresenceCore (boost::shared_ptr<Ekiga::PersonalDetails> _details): details(_details)
+Ekiga::PresenceCore::PresenceCore (boost::shared_ptr<Ekiga::PersonalDetails> _details): merged_presences(0), details(_details)
 {
   conns.add (details->updated.connect(boost::bind (&Ekiga::PresenceCore::publish, this)));
 }
@@ -79,6 +79,7 @@ Ekiga::PresenceCore::add_presence_fetcher (boost::shared_ptr<PresenceFetcher> fe
   presence_fetchers.push_back (fetcher);
   conns.add (fetcher->presence_received.connect (boost::bind (&Ekiga::PresenceCore::on_presence_received, this, _1, _2)));
   conns.add (fetcher->status_received.connect (boost::bind (&Ekiga::PresenceCore::on_status_received, this, _1, _2)));
+  conns.add (fetcher->presences_received.connect (boost::bind (&Ekiga::PresenceCore::on_presences_received, this, _1, _2)));
   for (std::map<std::string, uri_info>::const_iterator iter
          = uri_infos.begin ();
        iter != uri_infos.end ();
@@ -154,6 +155,23 @@ Ekiga::PresenceCore::on_status_received (const std::string uri,
   status_received (uri, status);
 }
 
+void
+Ekiga::PresenceCore::on_presences_received (const std::list<PresenceUpdate>& updates,
+                                            unsigned int merged)
+{
+  for (std::list<PresenceUpdate>::const_iterator iter = updates.begin ();
+       iter != updates.end ();
+       ++iter) {
+
+    uri_info& info = uri_infos[iter->uri];
+    info.presence = iter->presence;
+    info.status = iter->status;
+  }
+  merged_presences += merged;
+
+  presences_received (updates);
+}
+
 void
 Ekiga::PresenceCore::add_presence_publisher (boost::shared_ptr<PresencePublisher> publisher)
 {
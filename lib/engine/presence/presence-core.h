@@ -50,6 +50,17 @@ namespace Ekiga
  * @defgroup presence Presence
  * @{
  */
+
+  /** What a presence fetcher got to know about an uri, when it delivers
+   * several of those at once.
+   */
+  struct PresenceUpdate
+  {
+    std::string uri;
+    std::string presence;
+    std::string status;
+  };
+
   class PresenceFetcher
   {
   public:
@@ -82,6 +93,14 @@ namespace Ekiga
      */
     boost::signals2::signal<void(std::string, std::string)> presence_received;
     boost::signals2::signal<void(std::string, std::string)> status_received;
+
+    /** This signal is emitted instead of the above when a presence fetcher
+     * delivers presence information in batches (at most one update for
+     * each uri).
+     * @param The updates
+     * @param How many older updates for the same uris were dropped
+     */
+    boost::signals2::signal<void(const std::list<PresenceUpdate>&, unsigned int)> presences_received;
   };
 
   class PresencePublisher
@@ -162,12 +181,12 @@ namespace Ekiga
     /** This signal is emitted when an Ekiga::Cluster has been added
      * to the PresenceCore Service.
      */
-    boost::signals2::signal<void(ClusterPtr)> cluster_added;
+    light_signal<void(ClusterPtr)> cluster_added;
 
     /** This signal is emitted when an Ekiga::Cluster has been removed
      * to the PresenceCore Service.
      */
-    boost::signals2::signal<void(ClusterPtr)> cluster_removed;
+    light_signal<void(ClusterPtr)> cluster_removed;
 
   private:
     std::set<ClusterPtr > clusters;
@@ -210,6 +229,21 @@ namespace Ekiga
     boost::signals2::signal<void(std::string, std::string)> presence_received;
     boost::signals2::signal<void(std::string, std::string)> status_received;
 
+    /** This signal is emitted when a presence fetcher delivered presence
+     * information about several uris at once, instead of presence_received
+     * and status_received for each of them : what listens to those must
+     * listen to this one too, and can redraw once for the whole batch.
+     * @param The updates (at most one for each uri)
+     */
+    boost::signals2::signal<void(const std::list<PresenceUpdate>&)> presences_received;
+
+    /** Returns how many presence updates were dropped by the presence
+     * fetchers because a newer one for the same uri came in the same
+     * batch.
+     */
+    unsigned int get_merged_presences () const
+    { return merged_presences; }
+
     /** This chain allows the core to present forms to the user
      */
     ChainOfResponsibility<FormRequestPtr> questions;
@@ -221,6 +255,9 @@ namespace Ekiga
                                const std::string presence);
     void on_status_received (const std::string uri,
                              const std::string status);
+    void on_presences_received (const std::list<PresenceUpdate>& updates,
+                                unsigned int merged);
+    unsigned int merged_presences;
     struct uri_info
     {
       uri_info (): count(0), presence("unknown"), status("")
@@ -45,7 +45,9 @@
 #include <string.h>
 
 GST::AudioInputManager::AudioInputManager ():
-  already_detected_devices(false), worker(NULL)
+  devices(boost::bind (&GST::AudioInputManager::detect_devices, this, _1),
+	  boost::bind (boost::ref (devices_detected))),
+  worker(NULL)
 {
 }
 
@@ -54,11 +56,13 @@ GST::AudioInputManager::~AudioInputManager ()
 }
 
 void
-GST::AudioInputManager::get_devices (std::vector<Ekiga::AudioInputDevice>& devices)
+GST::AudioInputManager::get_devices (std::vector<Ekiga::AudioInputDevice>& result)
 {
-  detect_devices ();
+  DeviceCache::Devices devices_by_name;
 
-  for (std::map<std::pair<std::string, std::string>, std::string>::const_iterator iter
+  devices.get (devices_by_name);
+
+  for (DeviceCache::Devices::const_iterator iter
 	 = devices_by_name.begin ();
        iter != devices_by_name.end ();
        ++iter) {
@@ -67,7 +71,7 @@ GST::AudioInputManager::get_devices (std::vector<Ekiga::AudioInputDevice>& devic
     device.type = "GStreamer";
     device.source = iter->first.first;
     device.name = iter->first.second;
-    devices.push_back (device);
+    result.push_back (device);
   }
 }
 
@@ -76,11 +80,8 @@ GST::AudioInputManager::set_device (const Ekiga::AudioInputDevice& device)
 {
   bool result = false;
 
-  if ( !already_detected_devices)
-    detect_devices ();
-
   if (device.type == "GStreamer"
-      && devices_by_name.find (std::pair<std::string, std::string>(device.source, device.name)) != devices_by_name.end ()) {
+      && devices.might_have (device.source, device.name)) {
 
     current_state.opened = false;
     current_state.device = device;
@@ -94,21 +95,19 @@ GST::AudioInputManager::open (unsigned channels,
 			      unsigned samplerate,
 			      unsigned bits_per_sample)
 {
+  std::string device = devices.lookup (current_state.device.source, current_state.device.name);
   gchar* command = NULL;
 
-  if ( !already_detected_devices)
-    detect_devices ();
-
   command = g_strdup_printf ("%s ! appsink max_buffers=2 drop=true"
 			     " caps=audio/x-raw-int"
 			     ",rate=%d"
 			     ",channels=%d"
 			     ",width=%d"
 			     " name=ekiga_sink",
-			     devices_by_name[std::pair<std::string,std::string>(current_state.device.source, current_state.device.name)].c_str (),
+			     device.c_str (),
 			     samplerate, channels, bits_per_sample);
 
-  worker = gst_helper_new (command);
+  worker = gst_helper_new (device.c_str (), command);
   g_free (command);
 
   Ekiga::AudioInputSettings settings;
@@ -166,25 +165,48 @@ GST::AudioInputManager::set_volume (unsigned valu)
   gst_helper_set_volume (worker, valu / 255.0);
 }
 
+bool
+GST::AudioInputManager::get_latency (unsigned& latency)
+{
+  gint result = -1;
+
+  if (worker)
+    result = gst_helper_get_latency (worker);
+  if (result >= 0)
+    latency = result;
+
+  return result >= 0;
+}
+
 bool
 GST::AudioInputManager::has_device (const std::string& source,
 				    const std::string& device_name,
 				    Ekiga::AudioInputDevice& /*device*/)
 {
-  return (devices_by_name.find (std::pair<std::string,std::string>(source, device_name)) != devices_by_name.end ());
+  return devices.has (source, device_name);
+}
+
+void
+GST::AudioInputManager::refresh_devices ()
+{
+  devices.refresh ();
+}
+
+bool
+GST::AudioInputManager::detecting_devices ()
+{
+  return devices.is_probing ();
 }
 
 void
-GST::AudioInputManager::detect_devices ()
+GST::AudioInputManager::detect_devices (DeviceCache::Devices& devices_by_name)
 {
-  already_detected_devices = true;
-  devices_by_name.clear ();
-  detect_audiotestsrc_devices ();
-  detect_alsasrc_devices ();
+  detect_audiotestsrc_devices (devices_by_name);
+  detect_alsasrc_devices (devices_by_name);
 }
 
 void
-GST::AudioInputManager::detect_audiotestsrc_devices ()
+GST::AudioInputManager::detect_audiotestsrc_devices (DeviceCache::Devices& devices_by_name)
 {
   GstElement* elt = NULL;
 
@@ -198,7 +220,7 @@ GST::AudioInputManager::detect_audiotestsrc_devices ()
 }
 
 void
-GST::AudioInputManager::detect_alsasrc_devices ()
+GST::AudioInputManager::detect_alsasrc_devices (DeviceCache::Devices& devices_by_name)
 {
   GstElement* elt = NULL;
 
@@ -247,7 +269,7 @@ GST::AudioInputManager::detect_alsasrc_devices ()
 }
 
 void
-GST::AudioInputManager::detect_pulsesrc_devices ()
+GST::AudioInputManager::detect_pulsesrc_devices (DeviceCache::Devices& devices_by_name)
 {
   GstElement* elt = NULL;
 
@@ -44,6 +44,7 @@
 #include <map>
 
 #include "gst-helper.h"
+#include "gst-device-cache.h"
 
 namespace GST
 {
@@ -74,20 +75,23 @@ namespace GST
 
     void set_volume (unsigned volume);
 
+    void refresh_devices ();
+
+    bool detecting_devices ();
+
+    bool get_latency (unsigned& latency);
+
     bool has_device (const std::string& source,
 		     const std::string& device_name,
 		     Ekiga::AudioInputDevice& device);
   private:
 
-    bool already_detected_devices;
-    void detect_devices ();
-    void detect_audiotestsrc_devices ();
-    void detect_alsasrc_devices ();
-    void detect_pulsesrc_devices ();
+    void detect_devices (DeviceCache::Devices& devices_by_name);
+    void detect_audiotestsrc_devices (DeviceCache::Devices& devices_by_name);
+    void detect_alsasrc_devices (DeviceCache::Devices& devices_by_name);
+    void detect_pulsesrc_devices (DeviceCache::Devices& devices_by_name);
 
-    /* we take a user-readable name, and get the string describing
-     * the actual device */
-    std::map<std::pair<std::string, std::string>, std::string> devices_by_name;
+    DeviceCache devices;
 
     gst_helper* worker;
   };
@@ -45,7 +45,8 @@
 #include "gst-audiooutput.h"
 
 GST::AudioOutputManager::AudioOutputManager ():
-  already_detected_devices(false)
+  devices(boost::bind (&GST::AudioOutputManager::detect_devices, this, _1),
+	  boost::bind (boost::ref (devices_detected)))
 {
   worker[0]=NULL;
   worker[1]=NULL;
@@ -56,11 +57,13 @@ GST::AudioOutputManager::~AudioOutputManager ()
 }
 
 void
-GST::AudioOutputManager::get_devices (std::vector<Ekiga::AudioOutputDevice>& devices)
+GST::AudioOutputManager::get_devices (std::vector<Ekiga::AudioOutputDevice>& result)
 {
-  detect_devices ();
+  DeviceCache::Devices devices_by_name;
 
-  for (std::map<std::pair<std::string, std::string>, std::string>::const_iterator iter
+  devices.get (devices_by_name);
+
+  for (DeviceCache::Devices::const_iterator iter
 	 = devices_by_name.begin ();
        iter != devices_by_name.end ();
        ++iter) {
@@ -69,7 +72,7 @@ GST::AudioOutputManager::get_devices (std::vector<Ekiga::AudioOutputDevice>& dev
     device.type = "GStreamer";
     device.source = iter->first.first;
     device.name = iter->first.second;
-    devices.push_back (device);
+    result.push_back (device);
   }
 }
 
@@ -79,11 +82,8 @@ GST::AudioOutputManager::set_device (Ekiga::AudioOutputPS ps,
 {
   bool result = false;
 
-  if ( !already_detected_devices)
-    detect_devices ();
-
   if (device.type == "GStreamer"
-      && devices_by_name.find (std::pair<std::string,std::string>(device.source, device.name)) != devices_by_name.end ()) {
+      && devices.might_have (device.source, device.name)) {
 
     unsigned ii = (ps == Ekiga::primary)?0:1;
     current_state[ii].opened = false;
@@ -100,11 +100,9 @@ GST::AudioOutputManager::open (Ekiga::AudioOutputPS ps,
 			       unsigned bits_per_sample)
 {
   unsigned ii = (ps == Ekiga::primary)?0:1;
+  std::string device = devices.lookup (current_state[ii].device.source, current_state[ii].device.name);
   gchar* command = NULL;
 
-  if ( !already_detected_devices)
-    detect_devices ();
-
   command = g_strdup_printf ("appsrc"
 			     " is-live=true format=time do-timestamp=true"
 			     " min-latency=1 max-latency=5000000"
@@ -117,8 +115,8 @@ GST::AudioOutputManager::open (Ekiga::AudioOutputPS ps,
 			     ",signed=true,endianness=1234"
 			     " ! %s",
 			     samplerate, channels, bits_per_sample, bits_per_sample,
-			     devices_by_name[std::pair<std::string,std::string>(current_state[ii].device.source, current_state[ii].device.name)].c_str ());
-  worker[ii] = gst_helper_new (command);
+			     device.c_str ());
+  worker[ii] = gst_helper_new (device.c_str (), command);
   g_free (command);
 
   Ekiga::AudioOutputSettings settings;
@@ -184,6 +182,21 @@ GST::AudioOutputManager::set_frame_data (Ekiga::AudioOutputPS ps,
   return result;
 }
 
+bool
+GST::AudioOutputManager::get_latency (Ekiga::AudioOutputPS ps,
+				      unsigned& latency)
+{
+  unsigned ii = (ps == Ekiga::primary)?0:1;
+  gint result = -1;
+
+  if (worker[ii])
+    result = gst_helper_get_latency (worker[ii]);
+  if (result >= 0)
+    latency = result;
+
+  return result >= 0;
+}
+
 void
 GST::AudioOutputManager::set_volume (Ekiga::AudioOutputPS ps,
 				     unsigned valu)
@@ -198,23 +211,34 @@ GST::AudioOutputManager::has_device (const std::string& source,
 				     const std::string& device_name,
 				     Ekiga::AudioOutputDevice& /*device*/)
 {
-  return (devices_by_name.find (std::pair<std::string,std::string>(source, device_name)) != devices_by_name.end ());
+  return devices.has (source, device_name);
+}
+
+void
+GST::AudioOutputManager::refresh_devices ()
+{
+  devices.refresh ();
+}
+
+bool
+GST::AudioOutputManager::detecting_devices ()
+{
+  return devices.is_probing ();
 }
 
 void
-GST::AudioOutputManager::detect_devices ()
+GST::AudioOutputManager::detect_devices (DeviceCache::Devices& devices_by_name)
 {
-  devices_by_name.clear ();
-  detect_fakesink_devices ();
-  detect_alsasink_devices ();
-  detect_pulsesink_devices ();
-  detect_sdlsink_devices ();
+  detect_fakesink_devices (devices_by_name);
+  detect_alsasink_devices (devices_by_name);
+  detect_pulsesink_devices (devices_by_name);
+  detect_sdlsink_devices (devices_by_name);
   devices_by_name[std::pair<std::string,std::string>("FILE","event")] = "volume name=ekiga_volume ! filesink location=/tmp/event";
   devices_by_name[std::pair<std::string,std::string>("FILE","in_a_call")] = "volume name=ekiga_volume ! filesink location=/tmp/in_a_call";
 }
 
 void
-GST::AudioOutputManager::detect_fakesink_devices ()
+GST::AudioOutputManager::detect_fakesink_devices (DeviceCache::Devices& devices_by_name)
 {
   GstElement* elt = NULL;
 
@@ -228,7 +252,7 @@ GST::AudioOutputManager::detect_fakesink_devices ()
 }
 
 void
-GST::AudioOutputManager::detect_alsasink_devices ()
+GST::AudioOutputManager::detect_alsasink_devices (DeviceCache::Devices& devices_by_name)
 {
   GstElement* elt = NULL;
 
@@ -277,7 +301,7 @@ GST::AudioOutputManager::detect_alsasink_devices ()
 }
 
 void
-GST::AudioOutputManager::detect_pulsesink_devices ()
+GST::AudioOutputManager::detect_pulsesink_devices (DeviceCache::Devices& devices_by_name)
 {
   GstElement* elt = NULL;
 
@@ -292,7 +316,7 @@ GST::AudioOutputManager::detect_pulsesink_devices ()
 }
 
 void
-GST::AudioOutputManager::detect_sdlsink_devices ()
+GST::AudioOutputManager::detect_sdlsink_devices (DeviceCache::Devices& devices_by_name)
 {
   gchar* descr = NULL;
   descr = g_strdup_printf ("volume name=ekiga_volume ! sdlaudiosink");
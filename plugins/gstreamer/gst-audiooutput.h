@@ -40,6 +40,7 @@
 #include "audiooutput-manager.h"
 #include <gst/gst.h>
 #include "gst-helper.h"
+#include "gst-device-cache.h"
 
 #include <map>
 
@@ -74,24 +75,28 @@ namespace GST
 			 unsigned size,
 			 unsigned& written);
 
+    bool get_latency (Ekiga::AudioOutputPS ps,
+		      unsigned& latency);
+
     void set_volume (Ekiga::AudioOutputPS ps,
 		     unsigned volume);
 
+    void refresh_devices ();
+
+    bool detecting_devices ();
+
     bool has_device (const std::string& source,
 		     const std::string& device_name,
 		     Ekiga::AudioOutputDevice& device);
   private:
 
-    bool already_detected_devices;
-    void detect_devices ();
-    void detect_fakesink_devices ();
-    void detect_alsasink_devices ();
-    void detect_pulsesink_devices ();
-    void detect_sdlsink_devices ();
+    void detect_devices (DeviceCache::Devices& devices_by_name);
+    void detect_fakesink_devices (DeviceCache::Devices& devices_by_name);
+    void detect_alsasink_devices (DeviceCache::Devices& devices_by_name);
+    void detect_pulsesink_devices (DeviceCache::Devices& devices_by_name);
+    void detect_sdlsink_devices (DeviceCache::Devices& devices_by_name);
 
-    /* we take a user-readable name, and get the string describing
-     * the actual device */
-    std::map<std::pair<std::string, std::string>, std::string> devices_by_name;
+    DeviceCache devices;
 
     gst_helper* worker[2];
   };
@@ -0,0 +1,192 @@
+/* Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2009 Damien Sandras <dsandras@seconix.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * Ekiga is licensed under the GPL license and as a special exception,
+ * you have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination,
+ * without applying the requirements of the GNU GPL to the OPAL, OpenH323
+ * and PWLIB programs, as long as you do follow the requirements of the
+ * GNU GPL for all the rest of the software thus combined.
+ */
+
+/*
+ *                         gst-device-cache.cpp  -  description
+ *                         ------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Gstreamer device list, probed in the background
+ *
+ */
+
+#include "gst-device-cache.h"
+
+GST::DeviceCache::DeviceCache (boost::function1<void, Devices&> detect_,
+			       boost::function0<void> probed_):
+  detect(detect_), probed(probed_), thread(NULL), probing(false),
+  probe_again(false)
+{
+  g_mutex_init (&mutex);
+  g_cond_init (&cond);
+
+  refresh ();
+}
+
+GST::DeviceCache::~DeviceCache ()
+{
+  GThread* last = NULL;
+
+  g_mutex_lock (&mutex);
+  probe_again = false;
+  last = thread;
+  thread = NULL;
+  g_mutex_unlock (&mutex);
+
+  if (last)
+    g_thread_join (last);
+
+  g_cond_clear (&cond);
+  g_mutex_clear (&mutex);
+}
+
+void
+GST::DeviceCache::refresh ()
+{
+  GThread* previous = NULL;
+
+  g_mutex_lock (&mutex);
+
+  if (probing) {
+
+    /* the running probe may have missed the change */
+    probe_again = true;
+  } else {
+
+    probing = true;
+    previous = thread;
+    thread = g_thread_new ("gst-device-probe", probe_thread, this);
+  }
+
+  g_mutex_unlock (&mutex);
+
+  /* it is done already : this only frees it */
+  if (previous)
+    g_thread_join (previous);
+}
+
+void
+GST::DeviceCache::get (Devices& result)
+{
+  g_mutex_lock (&mutex);
+  wait_for_probe ();
+  result = devices;
+  g_mutex_unlock (&mutex);
+}
+
+bool
+GST::DeviceCache::has (const std::string& source,
+		       const std::string& device_name)
+{
+  bool result = false;
+
+  g_mutex_lock (&mutex);
+  wait_for_probe ();
+  result = (devices.find (std::pair<std::string, std::string> (source, device_name)) != devices.end ());
+  g_mutex_unlock (&mutex);
+
+  return result;
+}
+
+std::string
+GST::DeviceCache::lookup (const std::string& source,
+			  const std::string& device_name)
+{
+  std::string result;
+  Devices::const_iterator iter;
+
+  g_mutex_lock (&mutex);
+  wait_for_probe ();
+  iter = devices.find (std::pair<std::string, std::string> (source, device_name));
+  if (iter != devices.end ())
+    result = iter->second;
+  g_mutex_unlock (&mutex);
+
+  return result;
+}
+
+bool
+GST::DeviceCache::is_probing ()
+{
+  bool result = false;
+
+  g_mutex_lock (&mutex);
+  result = probing;
+  g_mutex_unlock (&mutex);
+
+  return result;
+}
+
+bool
+GST::DeviceCache::might_have (const std::string& source,
+			      const std::string& device_name)
+{
+  bool result = false;
+
+  g_mutex_lock (&mutex);
+  result = (probing
+	    || devices.find (std::pair<std::string, std::string> (source, device_name)) != devices.end ());
+  g_mutex_unlock (&mutex);
+
+  return result;
+}
+
+gpointer
+GST::DeviceCache::probe_thread (gpointer data)
+{
+  DeviceCache* self = (DeviceCache*)data;
+  bool again = false;
+
+  do {
+
+    Devices found;
+
+    self->detect (found);
+
+    g_mutex_lock (&self->mutex);
+    self->devices.swap (found);
+    again = self->probe_again;
+    self->probe_again = false;
+    if ( !again) {
+
+      self->probing = false;
+      g_cond_broadcast (&self->cond);
+    }
+    g_mutex_unlock (&self->mutex);
+  } while (again);
+
+  if (self->probed)
+    self->probed ();
+
+  return NULL;
+}
+
+void
+GST::DeviceCache::wait_for_probe ()
+{
+  while (probing)
+    g_cond_wait (&cond, &mutex);
+}
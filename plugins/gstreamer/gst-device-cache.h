@@ -0,0 +1,110 @@
+/* Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2009 Damien Sandras <dsandras@seconix.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * Ekiga is licensed under the GPL license and as a special exception,
+ * you have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination,
+ * without applying the requirements of the GNU GPL to the OPAL, OpenH323
+ * and PWLIB programs, as long as you do follow the requirements of the
+ * GNU GPL for all the rest of the software thus combined.
+ */
+
+/*
+ *                         gst-device-cache.h  -  description
+ *                         ------------------------------------
+ *   begin                : written in 2014 by the Ekiga developers
+ *   copyright            : (c) 2014 by the Ekiga developers
+ *   description          : Gstreamer device list, probed in the background
+ *
+ */
+
+#ifndef __GST_DEVICE_CACHE_H__
+#define __GST_DEVICE_CACHE_H__
+
+#include <glib.h>
+
+#include <map>
+#include <string>
+
+#include <boost/function.hpp>
+
+namespace GST
+{
+  /* Probing gstreamer elements for their devices puts them in PAUSED,
+   * which opens the hardware and can take a long time. This class keeps the
+   * result of the last probe, and runs the probes in a thread of its own :
+   * the first one when it is created, the next ones when refresh () is
+   * called (ie: when a device was plugged or unplugged).
+   *
+   * Readers only wait when a probe is running, so that they never get
+   * a list older than the last refresh () ; the rest of the time they just
+   * read the cached list.
+   */
+  class DeviceCache
+  {
+  public:
+
+    /* we take a user-readable name, and get the string describing
+     * the actual device */
+    typedef std::map<std::pair<std::string, std::string>, std::string> Devices;
+
+    /* the detect function is called from the probe thread, and should only
+     * fill the map it gets ; the probed function is called from there too,
+     * once the cached list is up to date */
+    DeviceCache (boost::function1<void, Devices&> detect,
+		 boost::function0<void> probed = boost::function0<void> ());
+
+    ~DeviceCache ();
+
+    void refresh ();
+
+    void get (Devices& devices);
+
+    bool has (const std::string& source,
+	      const std::string& device_name);
+
+    /* doesn't wait : true while a probe runs */
+    bool is_probing ();
+
+    /* doesn't wait : while a probe runs, any device is assumed to be there */
+    bool might_have (const std::string& source,
+		     const std::string& device_name);
+
+    /* returns an empty string for an unknown device */
+    std::string lookup (const std::string& source,
+			const std::string& device_name);
+
+  private:
+
+    static gpointer probe_thread (gpointer data);
+
+    void wait_for_probe ();
+
+    boost::function1<void, Devices&> detect;
+    boost::function0<void> probed;
+
+    GMutex mutex;
+    GCond cond;
+    GThread* thread;
+    bool probing;
+    bool probe_again;
+    Devices devices;
+  };
+};
+
+#endif
@@ -34,27 +34,310 @@
  *
  */
 
+#include <ptlib.h>
+
 #include "gst-helper.h"
 
-#include <gst/base/gstadapter.h>
+#include <string.h>
+#include <stddef.h>
+#include <vector>
+
 #include <gst/app/gstappsrc.h>
 #include <gst/app/gstappsink.h>
 #include <gst/app/gstappbuffer.h>
 
+#include "ring-buffer.h"
+
+/* how long a reader or a writer waits for the pipeline before giving up */
+#define GST_HELPER_TIMEOUT (200 * G_TIME_SPAN_MILLISECOND)
+
+/* how many free blocks a pool keeps around */
+#define GST_HELPER_POOL_SIZE 8
+
+/* how many closed pipelines are kept around for reuse, and how long
+ * (they keep their device open meanwhile) */
+#define GST_HELPER_IDLE_PIPELINES 4
+#define GST_HELPER_IDLE_SECONDS 3
+
+/* The outgoing buffers are carved out of a pool of blocks, which come back
+ * to it when gstreamer is done with them. Since this can happen after the
+ * helper is gone, the pool is reference-counted.
+ */
+struct gst_helper_pool
+{
+  gint refcount;
+  GMutex mutex;
+  GSList* blocks;
+  gsize block_size;
+};
+
+struct gst_helper_block
+{
+  gst_helper_pool* pool;
+  gsize size;
+  guint8 data[1];
+};
+
 struct gst_helper
 {
+  gchar* device;
+  gchar* command;
   GstElement* pipeline;
   GstElement* active;
   GstElement* volume;
-  GstAdapter* adapter;
+
+  GMutex mutex;
+  GCond cond;
+  bool closing;
+
+  /* ekiga_sink : the buffers are copied there as soon as they arrive ;
+   * for video, a reader only gets whole buffers, so frames never tear */
+  Ekiga::RingBuffer* ring;
+  bool whole_buffers;
+
+  /* ekiga_src : paced by the need-data/enough-data signals */
+  bool enough_data;
+  gst_helper_pool* pool;
+
+  /* the pipeline latency is queried again when it changes */
+  volatile gint latency_changed;
+  gint latency;
+
+  /* when the helper was (re)opened, until the first sample, and when it
+   * was closed, while it is idle */
+  gint64 opened_at;
+  bool reused;
+  gint64 idle_since;
 };
 
+/* Closed playback pipelines are kept in READY for a few seconds, most
+ * recently used first, so that opening the same device with the same caps
+ * again (sound events, ringing) doesn't need to parse and build a
+ * pipeline, nor to open the device from scratch. Capture pipelines aren't
+ * kept : the camera or microphone would stay claimed.
+ */
+G_LOCK_DEFINE_STATIC (idle_pipelines);
+static GList* idle_pipelines = NULL;
+static guint idle_source = 0;
+static unsigned idle_hits = 0;
+static unsigned idle_misses = 0;
+static unsigned idle_dropped = 0;
+
+static void gst_helper_destroy (gst_helper* self);
+
+/* called with self->mutex held */
+static void
+gst_helper_first_sample (gst_helper* self)
+{
+  if (self->opened_at == 0)
+    return;
+
+  PTRACE(4, "GstHelper\tFirst sample of " << self->device << " after "
+	 << (g_get_monotonic_time () - self->opened_at) / 1000 << " ms, "
+	 << (self->reused ? "reused" : "new") << " pipeline");
+  self->opened_at = 0;
+}
+
+static gboolean
+on_idle_timeout (G_GNUC_UNUSED gpointer data)
+{
+  gint64 limit = g_get_monotonic_time () - GST_HELPER_IDLE_SECONDS * G_TIME_SPAN_SECOND;
+  GList* expired = NULL;
+  GList* iter = NULL;
+  gboolean result = TRUE;
+
+  G_LOCK (idle_pipelines);
+  iter = idle_pipelines;
+  while (iter != NULL) {
+
+    gst_helper* idle = (gst_helper*)iter->data;
+    GList* next = iter->next;
+
+    if (idle->idle_since <= limit) {
+
+      expired = g_list_prepend (expired, idle);
+      idle_pipelines = g_list_delete_link (idle_pipelines, iter);
+      idle_dropped++;
+    }
+    iter = next;
+  }
+  if (idle_pipelines == NULL) {
+
+    idle_source = 0;
+    result = FALSE;
+  }
+  G_UNLOCK (idle_pipelines);
+
+  g_list_free_full (expired, (GDestroyNotify)gst_helper_destroy);
+
+  return result;
+}
+
+static gst_helper_pool*
+gst_helper_pool_new ()
+{
+  gst_helper_pool* pool = g_new0 (gst_helper_pool, 1);
+  pool->refcount = 1;
+  g_mutex_init (&pool->mutex);
+
+  return pool;
+}
+
+static void
+gst_helper_pool_unref (gst_helper_pool* pool)
+{
+  if (g_atomic_int_dec_and_test (&pool->refcount)) {
+
+    g_slist_free_full (pool->blocks, g_free);
+    g_mutex_clear (&pool->mutex);
+    g_free (pool);
+  }
+}
+
+static gst_helper_block*
+gst_helper_pool_acquire (gst_helper_pool* pool,
+			 gsize size)
+{
+  gst_helper_block* block = NULL;
+
+  g_mutex_lock (&pool->mutex);
+  if (size != pool->block_size) {
+
+    g_slist_free_full (pool->blocks, g_free);
+    pool->blocks = NULL;
+    pool->block_size = size;
+  }
+  if (pool->blocks) {
+
+    block = (gst_helper_block*)pool->blocks->data;
+    pool->blocks = g_slist_delete_link (pool->blocks, pool->blocks);
+  }
+  g_mutex_unlock (&pool->mutex);
+
+  if (block == NULL) {
+
+    block = (gst_helper_block*)g_malloc (offsetof (gst_helper_block, data) + size);
+    block->size = size;
+  }
+  g_atomic_int_inc (&pool->refcount);
+  block->pool = pool;
+
+  return block;
+}
+
+static void
+gst_helper_pool_release (gst_helper_block* block)
+{
+  gst_helper_pool* pool = block->pool;
+
+  g_mutex_lock (&pool->mutex);
+  if (block->size == pool->block_size
+      && g_slist_length (pool->blocks) < GST_HELPER_POOL_SIZE) {
+
+    pool->blocks = g_slist_prepend (pool->blocks, block);
+    block = NULL;
+  }
+  g_mutex_unlock (&pool->mutex);
+
+  g_free (block);
+  gst_helper_pool_unref (pool);
+}
+
+static void
+on_new_buffer (GstAppSink* sink,
+	       gst_helper* self)
+{
+  GstBuffer* buffer = gst_app_sink_pull_buffer (sink);
+  unsigned size = 0;
+
+  if (buffer == NULL)
+    return;
+
+  size = GST_BUFFER_SIZE (buffer);
+
+  g_mutex_lock (&self->mutex);
+
+  gst_helper_first_sample (self);
+
+  if (self->ring->capacity () < 4 * size) {
+
+    /* first buffers : make room for a few of them, keeping what we have */
+    std::vector<char> pending (self->ring->readable ());
+    if ( !pending.empty ())
+      self->ring->read (&pending[0], pending.size ());
+    self->ring->resize (4 * size);
+    if ( !pending.empty ())
+      self->ring->write (&pending[0], pending.size ());
+  }
+
+  /* the reader is late : drop the oldest data, like appsink's drop=true ;
+   * the capacity isn't a multiple of the buffer size, so drop whole
+   * buffers to keep the data aligned on them */
+  if (self->ring->writable () < size) {
+
+    unsigned missing = size - self->ring->writable ();
+    self->ring->skip (MIN ((missing + size - 1) / size * size,
+			   self->ring->readable ()));
+  }
+
+  self->ring->write ((const char*)GST_BUFFER_DATA (buffer), size);
+  g_cond_signal (&self->cond);
+
+  g_mutex_unlock (&self->mutex);
+
+  gst_buffer_unref (buffer);
+}
+
+static void
+on_need_data (G_GNUC_UNUSED GstAppSrc* src,
+	      G_GNUC_UNUSED guint length,
+	      gst_helper* self)
+{
+  g_mutex_lock (&self->mutex);
+  gst_helper_first_sample (self);
+  self->enough_data = false;
+  g_cond_signal (&self->cond);
+  g_mutex_unlock (&self->mutex);
+}
+
+static void
+on_enough_data (G_GNUC_UNUSED GstAppSrc* src,
+		gst_helper* self)
+{
+  g_mutex_lock (&self->mutex);
+  self->enough_data = true;
+  g_mutex_unlock (&self->mutex);
+}
+
+static GstBusSyncReply
+on_bus_message (G_GNUC_UNUSED GstBus* bus,
+		GstMessage* message,
+		gst_helper* self)
+{
+  /* this runs in a streaming thread : only note that the latency should
+   * be queried again */
+  if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_LATENCY
+      || GST_MESSAGE_TYPE (message) == GST_MESSAGE_ASYNC_DONE)
+    g_atomic_int_set (&self->latency_changed, 1);
+
+  return GST_BUS_PASS;
+}
+
 static void
 gst_helper_destroy (gst_helper* self)
 {
+  GstBus* bus = NULL;
+
+  g_mutex_lock (&self->mutex);
+  self->closing = true;
+  g_cond_broadcast (&self->cond);
+  g_mutex_unlock (&self->mutex);
+
   gst_element_set_state (self->pipeline, GST_STATE_NULL);
-  gst_object_unref (self->adapter);
-  self->adapter = NULL;
+  bus = gst_pipeline_get_bus (GST_PIPELINE (self->pipeline));
+  gst_bus_set_sync_handler (bus, NULL, NULL);
+  gst_object_unref (bus);
+  g_signal_handlers_disconnect_by_data (self->active, self);
   g_object_unref (self->active);
   self->active = NULL;
   if (self->volume)
@@ -62,21 +345,126 @@ gst_helper_destroy (gst_helper* self)
   self->volume = NULL;
   g_object_unref (self->pipeline);
   self->pipeline = NULL;
+  g_free (self->command);
+  self->command = NULL;
+  g_free (self->device);
+  self->device = NULL;
+  delete self->ring;
+  self->ring = NULL;
+  if (self->pool)
+    gst_helper_pool_unref (self->pool);
+  self->pool = NULL;
+  g_cond_clear (&self->cond);
+  g_mutex_clear (&self->mutex);
   g_free (self);
 }
 
-gst_helper*
-gst_helper_new (const gchar* command)
+static gst_helper*
+gst_helper_build (const gchar* device,
+		  const gchar* command)
 {
   gst_helper* self = g_new0 (gst_helper, 1);
-  self->adapter = gst_adapter_new ();
+  GstBus* bus = NULL;
+
+  g_mutex_init (&self->mutex);
+  g_cond_init (&self->cond);
+  self->device = g_strdup (device);
+  self->command = g_strdup (command);
+  self->ring = new Ekiga::RingBuffer;
+  self->latency = -1;
   self->pipeline = gst_parse_launch (command, NULL);
   self->volume = gst_bin_get_by_name (GST_BIN (self->pipeline), "ekiga_volume");
   self->active = gst_bin_get_by_name (GST_BIN (self->pipeline), "ekiga_sink");
-  if (self->active == NULL) {
+  if (self->active != NULL) {
+
+    GstCaps* caps = NULL;
+
+    g_object_set (G_OBJECT (self->active), "emit-signals", TRUE, NULL);
+    g_object_get (G_OBJECT (self->active), "caps", &caps, NULL);
+    if (caps != NULL) {
+
+      if (gst_caps_get_size (caps) > 0)
+	self->whole_buffers = g_str_has_prefix (gst_structure_get_name (gst_caps_get_structure (caps, 0)),
+						"video/");
+      gst_caps_unref (caps);
+    }
+    g_signal_connect (self->active, "new-buffer",
+		      G_CALLBACK (on_new_buffer), self);
+  } else {
 
     self->active = gst_bin_get_by_name (GST_BIN (self->pipeline), "ekiga_src");
+    self->pool = gst_helper_pool_new ();
+    g_signal_connect (self->active, "need-data",
+		      G_CALLBACK (on_need_data), self);
+    g_signal_connect (self->active, "enough-data",
+		      G_CALLBACK (on_enough_data), self);
+  }
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (self->pipeline));
+  gst_bus_set_sync_handler (bus, (GstBusSyncHandler)on_bus_message, self);
+  gst_object_unref (bus);
+
+  return self;
+}
+
+gst_helper*
+gst_helper_new (const gchar* device,
+		const gchar* command)
+{
+  gst_helper* self = NULL;
+  GList* stale = NULL;
+  GList* iter = NULL;
+  gint64 opened_at = g_get_monotonic_time ();
+
+  G_LOCK (idle_pipelines);
+  iter = idle_pipelines;
+  while (iter != NULL) {
+
+    gst_helper* idle = (gst_helper*)iter->data;
+    GList* next = iter->next;
+
+    if (self == NULL && g_str_equal (idle->command, command)) {
+
+      self = idle;
+      idle_pipelines = g_list_delete_link (idle_pipelines, iter);
+    } else if (g_str_equal (idle->device, device)) {
+
+      /* same device, other caps : it would keep the device busy */
+      stale = g_list_prepend (stale, idle);
+      idle_pipelines = g_list_delete_link (idle_pipelines, iter);
+      idle_dropped++;
+    }
+    iter = next;
+  }
+  if (self)
+    idle_hits++;
+  else
+    idle_misses++;
+  PTRACE(4, "GstHelper\t" << (self ? "Reusing" : "Building") << " a pipeline for " << device
+	 << " (" << idle_hits << " hits, " << idle_misses << " misses so far)");
+  G_UNLOCK (idle_pipelines);
+
+  g_list_free_full (stale, (GDestroyNotify)gst_helper_destroy);
+
+  if (self) {
+
+    g_mutex_lock (&self->mutex);
+    self->closing = false;
+    self->enough_data = false;
+    self->opened_at = opened_at;
+    self->reused = true;
+    g_mutex_unlock (&self->mutex);
+    g_atomic_int_set (&self->latency_changed, 1);
+
+    if (gst_element_set_state (self->pipeline, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE)
+      return self;
+
+    /* the device probably went away meanwhile : start from scratch */
+    gst_helper_destroy (self);
   }
+
+  self = gst_helper_build (device, command);
+  self->opened_at = opened_at;
   (void)gst_element_set_state (self->pipeline, GST_STATE_PLAYING);
 
   return self;
@@ -85,7 +473,71 @@ gst_helper_new (const gchar* command)
 void
 gst_helper_close (gst_helper* self)
 {
-  gst_helper_destroy (self);
+  GList* evicted = NULL;
+
+  g_mutex_lock (&self->mutex);
+  self->closing = true;
+  g_cond_broadcast (&self->cond);
+  g_mutex_unlock (&self->mutex);
+
+  if (self->pool == NULL) {
+
+    gst_helper_destroy (self); // capture : release the device now
+    return;
+  }
+
+  /* READY stops the streaming threads, but keeps the pipeline built */
+  if (gst_element_set_state (self->pipeline, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE) {
+
+    gst_helper_destroy (self);
+    return;
+  }
+
+  g_mutex_lock (&self->mutex);
+  self->ring->reset ();
+  g_mutex_unlock (&self->mutex);
+
+  self->idle_since = g_get_monotonic_time ();
+
+  G_LOCK (idle_pipelines);
+  idle_pipelines = g_list_prepend (idle_pipelines, self);
+  if (g_list_length (idle_pipelines) > GST_HELPER_IDLE_PIPELINES) {
+
+    evicted = g_list_last (idle_pipelines);
+    idle_pipelines = g_list_remove_link (idle_pipelines, evicted);
+    idle_dropped++;
+  }
+  if (idle_source == 0)
+    idle_source = g_timeout_add_seconds (GST_HELPER_IDLE_SECONDS, on_idle_timeout, NULL);
+  G_UNLOCK (idle_pipelines);
+
+  g_list_free_full (evicted, (GDestroyNotify)gst_helper_destroy);
+}
+
+void
+gst_helper_flush_idle ()
+{
+  GList* idle = NULL;
+
+  G_LOCK (idle_pipelines);
+  idle = idle_pipelines;
+  idle_pipelines = NULL;
+  if (idle_source != 0)
+    g_source_remove (idle_source);
+  idle_source = 0;
+  G_UNLOCK (idle_pipelines);
+
+  g_list_free_full (idle, (GDestroyNotify)gst_helper_destroy);
+}
+
+void
+gst_helper_get_idle_stats (gst_helper_idle_stats& stats)
+{
+  G_LOCK (idle_pipelines);
+  stats.hits = idle_hits;
+  stats.misses = idle_misses;
+  stats.dropped = idle_dropped;
+  G_UNLOCK (idle_pipelines);
 }
 
 bool
@@ -94,16 +546,20 @@ gst_helper_get_frame_data (gst_helper* self,
 			   unsigned size,
 			   unsigned& read)
 {
-  GstBuffer* buffer = NULL;
+  gint64 end_time = g_get_monotonic_time () + GST_HELPER_TIMEOUT;
 
-  buffer = gst_app_sink_pull_buffer (GST_APP_SINK (self->active));
-  if (buffer != NULL)
-    gst_adapter_push (self->adapter, buffer);
+  g_mutex_lock (&self->mutex);
 
-  read = MIN(size, gst_adapter_available (self->adapter));
-  gst_adapter_copy (self->adapter, (guint8*)data, 0, read);
-  gst_adapter_flush (self->adapter, read);
-  g_usleep (20 * G_TIME_SPAN_MILLISECOND);
+  while ( !self->closing && self->ring->readable () < size)
+    if ( !g_cond_wait_until (&self->cond, &self->mutex, end_time))
+      break;
+
+  if (self->whole_buffers && self->ring->readable () < size)
+    read = 0; // the caller keeps its previous frame rather than half of one
+  else
+    read = self->ring->read (data, size);
+
+  g_mutex_unlock (&self->mutex);
 
   return true;
 }
@@ -113,17 +569,24 @@ gst_helper_set_frame_data (gst_helper* self,
 			   const char* data,
 			   unsigned size)
 {
-  gchar* tmp = NULL;
+  gint64 end_time = g_get_monotonic_time () + GST_HELPER_TIMEOUT;
+  gst_helper_block* block = NULL;
   GstBuffer* buffer = NULL;
 
   if (self->active) {
 
-    tmp = (gchar*)g_malloc0 (size);
-    memcpy (tmp, data, size);
-    buffer = gst_app_buffer_new (tmp, size,
-				 (GstAppBufferFinalizeFunc)g_free, tmp);
+    /* wait until the pipeline wants more, instead of a fixed sleep */
+    g_mutex_lock (&self->mutex);
+    while ( !self->closing && self->enough_data)
+      if ( !g_cond_wait_until (&self->cond, &self->mutex, end_time))
+	break;
+    g_mutex_unlock (&self->mutex);
+
+    block = gst_helper_pool_acquire (self->pool, size);
+    memcpy (block->data, data, size);
+    buffer = gst_app_buffer_new (block->data, size,
+				 (GstAppBufferFinalizeFunc)gst_helper_pool_release, block);
     gst_app_src_push_buffer (GST_APP_SRC (self->active), buffer);
-    g_usleep (20 * G_TIME_SPAN_MILLISECOND);
   }
 }
 
@@ -153,8 +616,38 @@ void
 gst_helper_set_buffer_size (gst_helper* self,
 			    unsigned size)
 {
-  if (self->active)
+  if (self->active) {
+
     g_object_set (G_OBJECT (self->active),
 		  "blocksize", size,
 		  NULL);
+
+    /* keep no more than a couple of buffers queued in the appsrc */
+    if (self->pool)
+      g_object_set (G_OBJECT (self->active),
+		    "max-bytes", (guint64)(2 * size),
+		    NULL);
+  }
+}
+
+gint
+gst_helper_get_latency (gst_helper* self)
+{
+  GstQuery* query = NULL;
+  gboolean live = FALSE;
+  GstClockTime min_latency = 0;
+  GstClockTime max_latency = 0;
+
+  if (g_atomic_int_compare_and_exchange (&self->latency_changed, 1, 0)) {
+
+    query = gst_query_new_latency ();
+    if (gst_element_query (self->pipeline, query)) {
+
+      gst_query_parse_latency (query, &live, &min_latency, &max_latency);
+      self->latency = GST_TIME_AS_MSECONDS (min_latency);
+    }
+    gst_query_unref (query);
+  }
+
+  return self->latency;
 }
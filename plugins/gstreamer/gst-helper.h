@@ -40,10 +40,20 @@
  * - there must be a way to create a new helper, which can have an optional
  * ekiga_volume element, and a mandatory active element, which is either an
  * ekiga_sink or an ekiga_src ;
- * - it should be possible to ask this helper to just kill itself ;
+ * - it should be possible to ask this helper to just kill itself ; a
+ * playback pipeline is then kept in READY for a few seconds, so that
+ * opening the same device with the same caps again is fast (the device
+ * string says which idle pipelines must be dropped when opening the device
+ * differently) ;
  * - it should be possible to either put data into it, or get data from it ;
  * - the optional volume should be modifyable (-1 means the option is disabled) ;
- * - it should be possible to set the buffer size.
+ * - it should be possible to set the buffer size ;
+ * - it should be possible to know the latency of the pipeline (-1 means
+ * it isn't known yet).
+ *
+ * The data flows through appsink/appsrc signals : get_frame_data only waits
+ * until enough data arrived, and set_frame_data until the pipeline asks for
+ * more, instead of sleeping for a fixed time.
  */
 
 
@@ -51,10 +61,25 @@
 
 struct gst_helper;
 
-gst_helper* gst_helper_new (const gchar* command);
+gst_helper* gst_helper_new (const gchar* device,
+			    const gchar* command);
 
 void gst_helper_close (gst_helper* self);
 
+/* destroys the pipelines kept for reuse */
+void gst_helper_flush_idle ();
+
+/* how well keeping the closed pipelines works, since startup */
+struct gst_helper_idle_stats
+{
+  unsigned hits;    // opened by reusing an idle pipeline
+  unsigned misses;  // opened by building a new pipeline
+  unsigned dropped; // idle pipelines destroyed unused : too old, too
+		    // many, or their device was opened with other caps
+};
+
+void gst_helper_get_idle_stats (gst_helper_idle_stats& stats);
+
 bool gst_helper_get_frame_data (gst_helper* self,
 				char* data,
 				unsigned size,
@@ -71,3 +96,5 @@ gfloat gst_helper_get_volume (gst_helper* self);
 
 void gst_helper_set_buffer_size (gst_helper* self,
 				 unsigned size);
+
+gint gst_helper_get_latency (gst_helper* self);
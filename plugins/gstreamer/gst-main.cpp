@@ -52,7 +52,10 @@ class GStreamerService: public Ekiga::Service
 public:
 
   ~GStreamerService ()
-  { gst_deinit (); }
+  {
+    gst_helper_flush_idle ();
+    gst_deinit ();
+  }
 
   const std::string get_name () const
   { return "gstreamer"; }
@@ -63,9 +66,14 @@ public:
 
 struct GSTSpark: public Ekiga::Spark
 {
-  GSTSpark (): result(false)
+  GSTSpark (): result(false), video(0), audioin(0), audioout(0)
   {}
 
+  /* gst_init_check scans the registry, which is slow : this can run on a
+   * worker thread, and the managers are only given to the cores in
+   * finish_initialization ; there may be no video input core, and then
+   * there's no video input manager either
+   */
   bool try_initialize_more (Ekiga::ServiceCore& core,
 			    int* argc,
 			    char** argv[])
@@ -74,20 +82,29 @@ struct GSTSpark: public Ekiga::Spark
     boost::shared_ptr<Ekiga::AudioOutputCore> audiooutput_core = core.get<Ekiga::AudioOutputCore> ("audiooutput-core");
     boost::shared_ptr<Ekiga::VideoInputCore> videoinput_core = core.get<Ekiga::VideoInputCore> ("videoinput-core");
 
-    if (audioinput_core && audiooutput_core && videoinput_core) {
+    if (audioinput_core && audiooutput_core && !result) {
+
+      /* gst_init_check removes the options it knows from argv, and the
+       * other sparks may read it meanwhile : give it a copy */
+      int gst_argc = *argc;
+      char** gst_argv = g_new0 (char*, gst_argc + 1);
+      bool initialized = false;
 
-      if (gst_init_check (argc, argv, NULL)) {
+      for (int ii = 0; ii < gst_argc; ii++)
+	gst_argv[ii] = (*argv)[ii];
+      initialized = gst_init_check (&gst_argc, &gst_argv, NULL);
+      g_free (gst_argv);
+
+      if (initialized) {
 
-	GST::VideoInputManager* video = new GST::VideoInputManager ();
-	GST::AudioInputManager* audioin = new GST::AudioInputManager ();
-	GST::AudioOutputManager* audioout = new GST::AudioOutputManager ();
 	Ekiga::ServicePtr service (new GStreamerService);
 
 	if (core.add (service)) {
 
-	  audioinput_core->add_manager (*audioin);
-	  audiooutput_core->add_manager (*audioout);
-	  videoinput_core->add_manager (*video);
+	  if (videoinput_core)
+	    video = new GST::VideoInputManager ();
+	  audioin = new GST::AudioInputManager ();
+	  audioout = new GST::AudioOutputManager ();
 	  result = true;
 	}
       } else {
@@ -99,13 +116,51 @@ struct GSTSpark: public Ekiga::Spark
     return result;
   }
 
+  void finish_initialization (Ekiga::ServiceCore& core)
+  {
+    boost::shared_ptr<Ekiga::AudioInputCore> audioinput_core = core.get<Ekiga::AudioInputCore> ("audioinput-core");
+    boost::shared_ptr<Ekiga::AudioOutputCore> audiooutput_core = core.get<Ekiga::AudioOutputCore> ("audiooutput-core");
+    boost::shared_ptr<Ekiga::VideoInputCore> videoinput_core = core.get<Ekiga::VideoInputCore> ("videoinput-core");
+
+    if (audioin && audioout) {
+
+      audioinput_core->add_manager (*audioin);
+      audiooutput_core->add_manager (*audioout);
+      audioin = 0;
+      audioout = 0;
+    }
+
+    if (video && videoinput_core) {
+
+      videoinput_core->add_manager (*video);
+      video = 0;
+    }
+  }
+
   Ekiga::Spark::state get_state () const
   { return result?FULL:BLANK; }
 
   const std::string get_name () const
   { return "GSTREAMER"; }
 
+  void get_provides (std::list<std::string>& names) const
+  { names.push_back ("gstreamer"); }
+
+  void get_requires (std::list<std::string>& names) const
+  {
+    names.push_back ("audioinput-core");
+    names.push_back ("audiooutput-core");
+  }
+
+  bool main_thread_only () const
+  { return false; }
+
   bool result;
+
+  /* until they're given to their cores */
+  GST::VideoInputManager* video;
+  GST::AudioInputManager* audioin;
+  GST::AudioOutputManager* audioout;
 };
 
 extern "C" void
@@ -103,21 +103,23 @@ GST::VideoInputManager::open (unsigned width,
 			      unsigned height,
 			      unsigned fps)
 {
+  std::string device;
   gchar* command = NULL;
 
   if ( !already_detected_devices)
     detect_devices ();
 
+  device = devices_by_name[std::pair<std::string,std::string>(current_state.device.source, current_state.device.name)];
   command = g_strdup_printf ("%s ! appsink max_buffers=2 drop=true"
 			     " caps=video/x-raw-yuv"
 			     ",format=(fourcc)I420"
 			     ",width=%d,height=%d"
 			     ",framerate=(fraction)%d/1"
 			     " name=ekiga_sink",
-			     devices_by_name[std::pair<std::string,std::string>(current_state.device.source, current_state.device.name)].c_str (),
+			     device.c_str (),
 			     width, height, fps);
 
-  worker = gst_helper_new (command);
+  worker = gst_helper_new (device.c_str (), command);
   g_free (command);
 
   Ekiga::VideoInputSettings settings;
@@ -44,6 +44,7 @@
 #include "ekiga-settings.h"
 #include "ekiga-app.h"
 #include "call-core.h"
+#include "runtime.h"
 
 /* Those defines the namespace and path we want to use. */
 #define EKIGA_DBUS_NAMESPACE "org.ekiga.Ekiga"
@@ -74,6 +75,12 @@ static gboolean ekiga_dbus_component_call (EkigaDBusComponent *self,
 static gboolean ekiga_dbus_component_get_user_name (EkigaDBusComponent *self,
                                                     char **name,
                                                     GError **error);
+static gboolean ekiga_dbus_component_set_main_loop_tracing (EkigaDBusComponent *self,
+                                                            gboolean on,
+                                                            GError **error);
+static gboolean ekiga_dbus_component_dump_main_loop_stats (EkigaDBusComponent *self,
+                                                           char **stats,
+                                                           GError **error);
 
 /* get the code to make the GObject accessible through dbus
  * (this is especially where we get dbus_glib_dbus_component_object_info !)
@@ -149,6 +156,30 @@ ekiga_dbus_component_get_user_name (EkigaDBusComponent *self,
   return TRUE;
 }
 
+static gboolean
+ekiga_dbus_component_set_main_loop_tracing (G_GNUC_UNUSED EkigaDBusComponent *self,
+                                            gboolean on,
+                                            G_GNUC_UNUSED GError **error)
+{
+  PTRACE (1, "DBus\tSetMainLoopTracing " << on);
+
+  Ekiga::Runtime::set_main_loop_tracing (on);
+
+  return TRUE;
+}
+
+static gboolean
+ekiga_dbus_component_dump_main_loop_stats (G_GNUC_UNUSED EkigaDBusComponent *self,
+                                           char **stats,
+                                           G_GNUC_UNUSED GError **error)
+{
+  PTRACE (1, "DBus\tDumpMainLoopStats");
+
+  *stats = g_strdup (Ekiga::Runtime::dump_main_loop_stats ().c_str ());
+
+  return TRUE;
+}
+
 
 /**************
  * PUBLIC API *